@@ -0,0 +1,100 @@
+/*!
+ * @file baudSwitch.ino
+ * @brief Measure the time and the bytes lost when sub UART1 changes its band rate at runtime (example: UART1)
+ * @n Experiment phenomenon: connect the pin TX and RX of Sub UART1. For every pair of band rates in the table
+ * @n below, the sketch sends SWITCH_BYTES bytes at the old band rate, changes the band rate, sends SWITCH_BYTES bytes
+ * @n at the new one and reads everything back. It is done once with begin() and once with setBaud(), one CSV line each:
+ * @n Columns: from, to, method, switch_us (time of the begin() or setBaud() call, after flush()), iic_trans
+ * @n (IIC transactions of the call), bytes received, bytes lost, bytes corrupted.
+ * @n begin() resets the sub UART and its FIFOs, so the bytes of the old band rate not read yet are lost,
+ * @n setBaud() keeps them.
+ * @n iic_trans is only counted when DFROBOT_IICSERIAL_STATS is enabled in DFRobot_IICSerial.h, otherwise it is 0.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @url https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+
+#define SWITCH_BYTES        32     //Bytes sent before and after the switch
+#define SWITCH_TIMEOUT_MS   500    //Give up reading after this time, the missing bytes are reported as lost
+
+DFRobot_IICSerial iicSerial1(Wire, /*subUartChannel =*/SUBUART_CHANNEL_1,/*IA1 = */1,/*IA0 = */1);//Construct Sub UART1
+
+const uint32_t switches[][2] = {{9600, 115200}, {9600, 921600}, {115200, 921600}, {921600, 9600}, {57600, 460800}};
+
+void discardInput(){
+  uint8_t buf[SWITCH_BYTES];
+  uint32_t t = millis();
+  while(millis() - t < 20){
+    if(iicSerial1.read(buf, sizeof(buf))){
+      t = millis();
+    }
+  }
+}
+
+void runSwitch(uint32_t from, uint32_t to, bool hot){
+  uint8_t buf[SWITCH_BYTES * 2];
+  uint32_t received = 0, errors = 0;
+  if(iicSerial1.begin(from) != 0){
+    Serial.println("# UART1 init failed, please check the IIC address and wiring");
+    return;
+  }
+  discardInput();
+  for(uint8_t i = 0; i < SWITCH_BYTES * 2; i++){
+    buf[i] = i;
+  }
+  iicSerial1.write(buf, SWITCH_BYTES);
+  //Send the old data completely, so only the switch itself is timed
+  iicSerial1.flush();
+  iicSerial1.resetStats();
+  uint32_t t = micros();
+  if(hot){
+    iicSerial1.setBaud(to);
+  }else{
+    iicSerial1.begin(to);
+  }
+  t = micros() - t;
+  uint32_t trans = iicSerial1.getStats().iicTransactions;
+  iicSerial1.write(buf + SWITCH_BYTES, SWITCH_BYTES);
+  uint32_t start = millis();
+  while((received < SWITCH_BYTES * 2) && (millis() - start < SWITCH_TIMEOUT_MS)){
+    received += iicSerial1.read(buf + received, SWITCH_BYTES * 2 - received);
+  }
+  //The bytes lost by a reset are the first ones, so the rest is compared with the tail of the data
+  uint32_t lost = SWITCH_BYTES * 2 - received;
+  for(uint8_t i = 0; i < received; i++){
+    if(buf[i] != (uint8_t)(lost + i)){
+      errors++;
+    }
+  }
+  Serial.print(from); Serial.print(",");
+  Serial.print(to); Serial.print(",");
+  Serial.print(hot ? "setBaud" : "begin"); Serial.print(",");
+  Serial.print(t); Serial.print(",");
+  Serial.print(trans); Serial.print(",");
+  Serial.print(received); Serial.print(",");
+  Serial.print(lost); Serial.print(",");
+  Serial.println(errors);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while(!Serial);
+  Serial.println("\n+-----------------------------------------------------+");
+  Serial.println("|  Connected UART1's TX pin to RX pin.                |");
+  Serial.println("|  Band rate switch of UART1, results in CSV format   |");
+  Serial.println("+-----------------------------------------------------+");
+  Serial.println("from,to,method,switch_us,iic_trans,bytes,lost,errors");
+  for(uint8_t i = 0; i < sizeof(switches) / sizeof(switches[0]); i++){
+    runSwitch(switches[i][0], switches[i][1], false);
+    runSwitch(switches[i][0], switches[i][1], true);
+  }
+  Serial.println("# done");
+}
+
+void loop() {
+}
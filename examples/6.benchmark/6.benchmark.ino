@@ -0,0 +1,197 @@
+/*!
+ * @file benchmark.ino
+ * @brief Measure throughput, bus usage and receive latency of sub UART1 (example: UART1)
+ * @n Experiment phenomenon: connect the pin TX and RX of Sub UART1. For every IIC bus clock and band rate in the
+ * @n tables below, the sketch runs three tests and prints one CSV line each, so the output of two library
+ * @n versions can be compared directly:
+ * @n byte    : write(uint8_t) and read() one byte at a time
+ * @n bulk    : write(pBuf, size) and read(pBuf, size) in BENCH_CHUNK bytes pieces
+ * @n latency : time from write() of one byte until read() returns it, includes the 10 bits time on the line
+ * @n Columns: bus_hz, baud, mode, bytes received, bytes lost, bytes corrupted, bytes/s,
+ * @n bus_util_pct (time spent inside library calls), p50_us, p99_us, iic_trans(IIC transactions of the test).
+ * @n iic_trans is only counted when DFROBOT_IICSERIAL_STATS is enabled in DFRobot_IICSerial.h, otherwise it is 0.
+ * @n Not every board supports a 1MHz IIC clock, remove it from busClocks if the module is not found.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @url https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+
+#define BENCH_BYTES        512    //Payload bytes of every throughput test
+#define BENCH_CHUNK        32     //Bytes per write()/read() call in the bulk test
+#define BENCH_IN_FLIGHT    128    //Bytes written but not read yet, the loopback must not overrun the receive FIFO
+#define BENCH_LAT_SAMPLES  32     //One byte round trips of every latency test
+#define BENCH_TIMEOUT_MS   3000   //Give up a test after this time, the missing bytes are reported as lost
+
+DFRobot_IICSerial iicSerial1(Wire, /*subUartChannel =*/SUBUART_CHANNEL_1,/*IA1 = */1,/*IA0 = */1);//Construct Sub UART1
+
+const uint32_t busClocks[] = {100000, 400000, 1000000};
+const uint32_t bauds[] = {9600, 57600, 115200, 230400, 460800, 921600};
+
+typedef struct{
+  uint32_t received;
+  uint32_t lost;
+  uint32_t errors;
+  uint32_t elapsedUs;
+  uint32_t busyUs;
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t iicTransactions;
+}sResult_t;
+
+void discardInput(){
+  uint8_t buf[BENCH_CHUNK];
+  uint32_t t = millis();
+  //Wait for the line to go idle, then throw away whatever is left from the previous test
+  while(millis() - t < 20){
+    if(iicSerial1.read(buf, sizeof(buf))){
+      t = millis();
+    }
+  }
+}
+
+void runThroughput(bool bulk, sResult_t *pResult){
+  uint8_t buf[BENCH_CHUNK];
+  uint32_t sent = 0, received = 0, errors = 0, busy = 0, t = 0;
+  size_t n = 0;
+  iicSerial1.resetStats();
+  uint32_t start = micros(), startMs = millis();
+  while((received < BENCH_BYTES) && (millis() - startMs < BENCH_TIMEOUT_MS)){
+    if((sent < BENCH_BYTES) && (sent - received < BENCH_IN_FLIGHT)){
+      t = micros();
+      if(bulk){
+        n = BENCH_IN_FLIGHT - (sent - received);
+        if(n > BENCH_BYTES - sent){
+          n = BENCH_BYTES - sent;
+        }
+        if(n > BENCH_CHUNK){
+          n = BENCH_CHUNK;
+        }
+        for(size_t i = 0; i < n; i++){
+          buf[i] = (uint8_t)(sent + i);
+        }
+        sent += iicSerial1.write(buf, n);
+      }else{
+        sent += iicSerial1.write((uint8_t)sent);
+      }
+      busy += micros() - t;
+    }
+    t = micros();
+    if(bulk){
+      n = iicSerial1.read(buf, sizeof(buf));
+    }else{
+      int c = iicSerial1.read();
+      n = 0;
+      if(c >= 0){
+        buf[0] = (uint8_t)c;
+        n = 1;
+      }
+    }
+    busy += micros() - t;
+    for(size_t i = 0; i < n; i++){
+      if(buf[i] != (uint8_t)(received + i)){
+        errors++;
+      }
+    }
+    received += n;
+  }
+  pResult->elapsedUs = micros() - start;
+  pResult->busyUs = busy;
+  pResult->received = received;
+  pResult->lost = BENCH_BYTES - received;
+  pResult->errors = errors;
+  pResult->p50Us = 0;
+  pResult->p99Us = 0;
+  pResult->iicTransactions = iicSerial1.getStats().iicTransactions;
+}
+
+void runLatency(sResult_t *pResult){
+  uint32_t samples[BENCH_LAT_SAMPLES];
+  uint32_t lost = 0, busy = 0, start = micros();
+  iicSerial1.resetStats();
+  for(uint8_t k = 0; k < BENCH_LAT_SAMPLES; k++){
+    uint32_t t = micros();
+    int c = -1;
+    iicSerial1.write(k);
+    while(((c = iicSerial1.read()) < 0) && (micros() - t < 1000UL * BENCH_TIMEOUT_MS / BENCH_LAT_SAMPLES));
+    samples[k] = micros() - t;
+    busy += samples[k];
+    if(c != k){
+      lost++;
+    }
+  }
+  //Insertion sort, the sample count is small
+  for(uint8_t i = 1; i < BENCH_LAT_SAMPLES; i++){
+    uint32_t v = samples[i];
+    uint8_t j = i;
+    while((j > 0) && (samples[j - 1] > v)){
+      samples[j] = samples[j - 1];
+      j--;
+    }
+    samples[j] = v;
+  }
+  pResult->elapsedUs = micros() - start;
+  pResult->busyUs = busy;
+  pResult->received = BENCH_LAT_SAMPLES - lost;
+  pResult->lost = lost;
+  pResult->errors = 0;
+  pResult->p50Us = samples[BENCH_LAT_SAMPLES / 2];
+  pResult->p99Us = samples[(BENCH_LAT_SAMPLES * 99) / 100];
+  pResult->iicTransactions = iicSerial1.getStats().iicTransactions;
+}
+
+void printResult(uint32_t busClock, uint32_t baud, const char *mode, sResult_t *pResult){
+  uint32_t rate = 0, util = 0;
+  if(pResult->elapsedUs){
+    rate = (uint32_t)((uint64_t)pResult->received * 1000000UL / pResult->elapsedUs);
+    util = (uint32_t)((uint64_t)pResult->busyUs * 100 / pResult->elapsedUs);
+  }
+  Serial.print(busClock); Serial.print(",");
+  Serial.print(baud); Serial.print(",");
+  Serial.print(mode); Serial.print(",");
+  Serial.print(pResult->received); Serial.print(",");
+  Serial.print(pResult->lost); Serial.print(",");
+  Serial.print(pResult->errors); Serial.print(",");
+  Serial.print(rate); Serial.print(",");
+  Serial.print(util); Serial.print(",");
+  Serial.print(pResult->p50Us); Serial.print(",");
+  Serial.print(pResult->p99Us); Serial.print(",");
+  Serial.println(pResult->iicTransactions);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while(!Serial);
+  Serial.println("\n+-----------------------------------------------------+");
+  Serial.println("|  Connected UART1's TX pin to RX pin.                |");
+  Serial.println("|  Benchmark of UART1, results in CSV format          |");
+  Serial.println("+-----------------------------------------------------+");
+  Serial.println("bus_hz,baud,mode,bytes,lost,errors,bytes_per_s,bus_util_pct,p50_us,p99_us,iic_trans");
+  sResult_t result;
+  for(uint8_t i = 0; i < sizeof(busClocks) / sizeof(busClocks[0]); i++){
+    for(uint8_t j = 0; j < sizeof(bauds) / sizeof(bauds[0]); j++){
+      if(iicSerial1.begin(bauds[j]) != 0){
+        Serial.println("# UART1 init failed, please check the IIC address and wiring");
+        continue;
+      }
+      Wire.setClock(busClocks[i]);//begin() initializes the IIC bus again, so the clock is set afterwards
+      discardInput();
+      runThroughput(false, &result);
+      printResult(busClocks[i], bauds[j], "byte", &result);
+      discardInput();
+      runThroughput(true, &result);
+      printResult(busClocks[i], bauds[j], "bulk", &result);
+      discardInput();
+      runLatency(&result);
+      printResult(busClocks[i], bauds[j], "latency", &result);
+    }
+  }
+  Serial.println("# done");
+}
+
+void loop() {
+}
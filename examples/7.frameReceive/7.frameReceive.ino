@@ -0,0 +1,51 @@
+/*!
+ * @file frameReceive.ino
+ * @brief Receive whole frames instead of single bytes (example: UART2, connect UART2's RX and TX together)
+ * @n UART2 transmits a few lines terminated by '\n', DFRobot_IICSerialFrame collects them and calls onFrame()
+ * @n once per line. Change setDelimiter() to setLengthPrefix() for binary protocols with a length byte, or to
+ * @n setIdleGap() for protocols that separate frames by a pause on the line such as Modbus RTU.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @url https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+
+DFRobot_IICSerial iicSerial2(Wire, /*subUartChannel =*/SUBUART_CHANNEL_2, /*IA1 = */1,/*IA0 = */1);//Construct Sub UART2
+
+uint8_t frameBuf[64];//The longest frame that can be received, longer frames are dropped
+DFRobot_IICSerialFrame frame(iicSerial2, frameBuf, sizeof(frameBuf));
+
+/*Called by frame.poll() for every complete line, pFrame includes the '\n'*/
+void onFrame(DFRobot_IICSerialBase *pPort, const uint8_t *pFrame, size_t size){
+  Serial.print("Frame(");
+  Serial.print(size);
+  Serial.print(" bytes): ");
+  Serial.write(pFrame, size);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while(iicSerial2.begin(/*baud = */115200) != 0){
+      Serial.println("UART init failed, please check if the connection is correct?");
+      delay(10);
+  }
+  frame.setDelimiter('\n');
+  //frame.setLengthPrefix(/*offset = */1, /*extra = */2);//e.g. STX, length, payload, CRC16
+  //frame.setIdleGap();
+  frame.setCallback(onFrame);
+  Serial.println("\n+-----------------------------------------------------+");
+  Serial.println("|  connected UART2's TX pin to RX pin.                |");
+  Serial.println("|  Every line UART2 receives is printed as one frame. |");
+  Serial.println("+-----------------------------------------------------+");
+  iicSerial2.print("first line\nsecond ");
+  iicSerial2.print("line\n");
+  iicSerial2.println("third line");
+}
+
+void loop() {
+  frame.poll();
+}
@@ -0,0 +1,82 @@
+/*!
+ * @file modbusMaster.ino
+ * @brief Poll a Modbus RTU slave on each sub UART at the same time and print the transactions per second of every port
+ * @n Experiment phenomenon: connect a RS-485 transceiver to each sub UART, with DE and /RE tied to DE_PIN1/DE_PIN2,
+ * @n and one slave with address SLAVE_ADDR behind each of them. Both masters keep a read holding registers request
+ * @n outstanding all the time, so the two buses work in parallel instead of one after the other.
+ * @n Connect the IRQ pin of the module to IRQ_PIN to detect the end of the answers through the receive FIFO
+ * @n timeout interrupt, or remove attachInterruptPin() to poll.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @url https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerialModbus.h>
+
+#define SLAVE_ADDR   1
+#define FIRST_REG    0
+#define REG_COUNT    4
+#define DE_PIN1      4
+#define DE_PIN2      5
+#define IRQ_PIN      2
+
+DFRobot_IICSerial iicSerial1(Wire, /*subUartChannel =*/SUBUART_CHANNEL_1, /*IA1 = */1,/*IA0 = */1);//Construct Sub UART1
+DFRobot_IICSerial iicSerial2(Wire, /*subUartChannel =*/SUBUART_CHANNEL_2, /*IA1 = */1,/*IA0 = */1);//Construct Sub UART2
+DFRobot_IICSerialModbus master1(iicSerial1);
+DFRobot_IICSerialModbus master2(iicSerial2);
+
+uint32_t okCount[2], errCount[2];
+uint32_t lastMs;
+
+/*Count the result of the finished request and send the next one right away*/
+void service(DFRobot_IICSerialModbus &master, uint8_t index){
+  DFRobot_IICSerialModbus::eModbusResult_t result = master.poll();
+  if(result == DFRobot_IICSerialModbus::eModbusBusy){
+    return;
+  }
+  if(result == DFRobot_IICSerialModbus::eModbusOK){
+    okCount[index]++;
+  }else if(result != DFRobot_IICSerialModbus::eModbusIdle){
+    errCount[index]++;
+  }
+  master.readHoldingRegisters(SLAVE_ADDR, FIRST_REG, REG_COUNT);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while(iicSerial1.begin(/*baud = */115200, /*format = */IICSerial_8N1) != 0){
+      Serial.println("UART1 init failed, please check if the connection is correct?");
+      delay(10);
+  }
+  while(iicSerial2.begin(/*baud = */115200, /*format = */IICSerial_8N1) != 0){
+      Serial.println("UART2 init failed, please check if the connection is correct?");
+      delay(10);
+  }
+  iicSerial1.enableRS485(DE_PIN1);
+  iicSerial2.enableRS485(DE_PIN2);
+  iicSerial1.attachInterruptPin(IRQ_PIN);
+  master1.setTimeout(100);
+  master2.setTimeout(100);
+  Serial.println("port,ok_per_s,errors_per_s");
+  lastMs = millis();
+}
+
+void loop() {
+  //Drain both receive FIFOs in one pass, then let every master look at its answer
+  DFRobot_IICSerialChip::pollAll();
+  service(master1, 0);
+  service(master2, 1);
+  if(millis() - lastMs >= 1000){
+    lastMs = millis();
+    for(uint8_t i = 0; i < 2; i++){
+      Serial.print(i + 1); Serial.print(",");
+      Serial.print(okCount[i]); Serial.print(",");
+      Serial.println(errCount[i]);
+      okCount[i] = 0;
+      errCount[i] = 0;
+    }
+  }
+}
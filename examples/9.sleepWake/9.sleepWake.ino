@@ -0,0 +1,124 @@
+/*!
+ * @file sleepWake.ino
+ * @brief Measure the wake-up latency and the bytes lost when a sleeping sub UART receives data (example: UART1)
+ * @n Experiment phenomenon: connect the pin TX of Sub UART2 to the pin RX of Sub UART1. For every band rate in the
+ * @n table below, UART2 sends WAKE_SAMPLES bursts of WAKE_BYTES bytes to UART1, half of them with UART1 awake and
+ * @n half with UART1 put to sleep WAKE_SETTLE_MS before. One CSV line is printed per band rate:
+ * @n Columns: baud, awake_us (time from write() until UART1 read the first byte while awake, worst sample),
+ * @n asleep_us (the same while asleep), wake_latency_us (asleep_us - awake_us), bytes received while asleep,
+ * @n bytes lost, bytes corrupted, rx_wakeups.
+ * @n Bytes lost at the start of a burst are reported as lost, not as corrupted. An idle period passed to
+ * @n setAutoSleep() is safe for a peer that sends without a preamble when lost is 0 at its band rate, otherwise
+ * @n the peer has to send a wake-up byte first and wait wake_latency_us.
+ * @n rx_wakeups is only counted when DFROBOT_IICSERIAL_STATS is enabled in DFRobot_IICSerial.h, otherwise it is 0.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @url https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+
+#define WAKE_BYTES        16     //Bytes of every burst
+#define WAKE_SAMPLES      8      //Bursts of every band rate, half awake and half asleep
+#define WAKE_SETTLE_MS    20     //Time for UART1 to fall asleep before the burst
+#define WAKE_TIMEOUT_MS   200    //Give up a burst after this time, the missing bytes are reported as lost
+
+DFRobot_IICSerial iicSerial1(Wire, /*subUartChannel =*/SUBUART_CHANNEL_1,/*IA1 = */1,/*IA0 = */1);//Construct Sub UART1
+DFRobot_IICSerial iicSerial2(Wire, /*subUartChannel =*/SUBUART_CHANNEL_2,/*IA1 = */1,/*IA0 = */1);//Construct Sub UART2
+
+const uint32_t bauds[] = {2400, 9600, 19200, 57600, 115200, 230400, 460800, 921600};
+
+typedef struct{
+  uint32_t firstUs;
+  uint32_t received;
+  uint32_t lost;
+  uint32_t errors;
+}sResult_t;
+
+void discardInput(){
+  uint8_t buf[WAKE_BYTES];
+  uint32_t t = millis();
+  while(millis() - t < 20){
+    if(iicSerial1.read(buf, sizeof(buf))){
+      t = millis();
+    }
+  }
+}
+
+void runBurst(uint8_t seq, sResult_t *pResult){
+  uint8_t buf[WAKE_BYTES];
+  uint32_t received = 0, first = 0;
+  for(uint8_t i = 0; i < WAKE_BYTES; i++){
+    buf[i] = (uint8_t)(seq * WAKE_BYTES + i);
+  }
+  uint32_t t = micros();
+  iicSerial2.write(buf, WAKE_BYTES);
+  //read() wakes UART1 up in software as soon as the first byte has arrived
+  while((received < WAKE_BYTES) && (micros() - t < 1000UL * WAKE_TIMEOUT_MS)){
+    size_t n = iicSerial1.read(buf + received, WAKE_BYTES - received);
+    if(n && (received == 0)){
+      first = micros() - t;
+    }
+    received += n;
+  }
+  //Bytes lost while UART1 wakes up are missing at the start, so the rest is compared with the tail of the burst
+  uint8_t lost = WAKE_BYTES - received;
+  for(uint8_t i = 0; i < received; i++){
+    if(buf[i] != (uint8_t)(seq * WAKE_BYTES + lost + i)){
+      pResult->errors++;
+    }
+  }
+  if(first > pResult->firstUs){
+    pResult->firstUs = first;
+  }
+  pResult->received += received;
+  pResult->lost += lost;
+}
+
+void setup() {
+  Serial.begin(115200);
+  while(!Serial);
+  Serial.println("\n+-----------------------------------------------------+");
+  Serial.println("|  Connected UART2's TX pin to UART1's RX pin.        |");
+  Serial.println("|  Wake-up test of UART1, results in CSV format       |");
+  Serial.println("+-----------------------------------------------------+");
+  Serial.println("baud,awake_us,asleep_us,wake_latency_us,bytes,lost,errors,rx_wakeups");
+  for(uint8_t j = 0; j < sizeof(bauds) / sizeof(bauds[0]); j++){
+    if((iicSerial1.begin(bauds[j]) != 0) || (iicSerial2.begin(bauds[j]) != 0)){
+      Serial.println("# UART init failed, please check the IIC address and wiring");
+      continue;
+    }
+    sResult_t awake, asleep;
+    memset(&awake, 0, sizeof(awake));
+    memset(&asleep, 0, sizeof(asleep));
+    discardInput();
+    iicSerial1.resetStats();
+    for(uint8_t k = 0; k < WAKE_SAMPLES; k++){
+      if(k & 1){
+        iicSerial1.sleep();
+        delay(WAKE_SETTLE_MS);
+        runBurst(k, &asleep);
+      }else{
+        iicSerial1.wakeup();
+        delay(WAKE_SETTLE_MS);
+        runBurst(k, &awake);
+      }
+      discardInput();
+    }
+    Serial.print(bauds[j]); Serial.print(",");
+    Serial.print(awake.firstUs); Serial.print(",");
+    Serial.print(asleep.firstUs); Serial.print(",");
+    Serial.print((asleep.firstUs > awake.firstUs) ? (asleep.firstUs - awake.firstUs) : 0); Serial.print(",");
+    Serial.print(asleep.received); Serial.print(",");
+    Serial.print(asleep.lost); Serial.print(",");
+    Serial.print(asleep.errors); Serial.print(",");
+    Serial.println(iicSerial1.getStats().rxWakeups);
+  }
+  Serial.println("# done");
+}
+
+void loop() {
+}
@@ -0,0 +1,85 @@
+/*!
+ * @file bench_modbus.cpp
+ * @brief Host version of examples/8.modbusMaster: a master on both sub UARTs of every module, each with one slave
+ * @n that answers at once, and a read holding registers request always outstanding. One
+ * @n DFRobot_IICSerialChip::pollAll() per loop, in polling mode and with the IRQ outputs of all modules on one pin.
+ * @n Prints one CSV line per port with the requests per second, and the IIC transactions per request of all ports.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include "HostTest.h"
+#include "ModbusSlave.h"
+
+#define PORTS        (WK2132_SIM_CHIP_MAX * 2)
+#define SLAVE_ADDR   1
+#define REG_COUNT    4
+#define DURATION_US  1000000
+
+static void run(uint32_t baud, bool irq){
+  WK2132Sim::reset();
+  DFRobot_IICSerial *ports[PORTS];
+  DFRobot_IICSerialModbus *masters[PORTS];
+  ModbusSlave *slaves[PORTS];
+  for(uint8_t i = 0; i < PORTS; i++){
+      uint8_t chip = i / 2;
+      ports[i] = new DFRobot_IICSerial(Wire, (i & 1) ? SUBUART_CHANNEL_2 : SUBUART_CHANNEL_1, chip >> 1, chip & 1);
+      CHECK_EQ(ports[i]->begin(baud), 0);
+      masters[i] = new DFRobot_IICSerialModbus(*ports[i]);
+      masters[i]->setTimeout(100);
+      slaves[i] = new ModbusSlave(chip, i & 1, SLAVE_ADDR);
+      if(irq && (i & 1)){
+          CHECK_EQ(ports[i]->attachInterruptPin(WK2132_SIM_IRQ_PIN), 0);
+      }
+  }
+  Wire.setClock(400000);
+
+  uint32_t ok[PORTS] = {0}, errors[PORTS] = {0};
+  uint32_t trans = simTransactions();
+  uint64_t start = WK2132Sim::now();
+  while(WK2132Sim::now() - start < DURATION_US){
+      DFRobot_IICSerialChip::pollAll();
+      for(uint8_t i = 0; i < PORTS; i++){
+          slaves[i]->poll();
+          DFRobot_IICSerialModbus::eModbusResult_t result = masters[i]->poll();
+          if(result == DFRobot_IICSerialModbus::eModbusBusy){
+              continue;
+          }
+          if(result == DFRobot_IICSerialModbus::eModbusOK){
+              ok[i]++;
+          }else if(result != DFRobot_IICSerialModbus::eModbusIdle){
+              errors[i]++;
+          }
+          CHECK_EQ(masters[i]->readHoldingRegisters(SLAVE_ADDR, 0, REG_COUNT), 0);
+      }
+      //The rest of the loop
+      WK2132Sim::advance(10);
+  }
+  uint32_t elapsedUs = (uint32_t)(WK2132Sim::now() - start);
+  uint32_t total = 0;
+  for(uint8_t i = 0; i < PORTS; i++){
+      total += ok[i] + errors[i];
+  }
+  for(uint8_t i = 0; i < PORTS; i++){
+      printf("400000,%u,%s,%u,%u,%u,%.1f\n", baud, irq ? "interrupt" : "polling", i + 1,
+             (uint32_t)((uint64_t)ok[i] * 1000000 / elapsedUs), errors[i], (double)(simTransactions() - trans) / total);
+      CHECK_EQ(errors[i], 0);
+      CHECK(ok[i] > 0);
+  }
+  for(uint8_t i = 0; i < PORTS; i++){
+      delete masters[i];
+      delete slaves[i];
+      delete ports[i];
+  }
+}
+
+int main(){
+  const uint32_t bauds[] = {9600, 115200};
+  printf("iic_hz,band_rate,mode,port,ok_per_s,errors,iic_trans_per_request\n");
+  for(size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++){
+      run(bauds[i], false);
+      run(bauds[i], true);
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*!
+ * @file bench_pollall.cpp
+ * @brief Four modules with both sub UARTs receiving at the same band rate, serviced only by
+ * @n DFRobot_IICSerialChip::pollAll(). Prints one CSV line per IIC clock and band rate with the aggregate
+ * @n throughput, the bus utilization and the worst receive FIFO margin(256 minus the highest fill level any FIFO
+ * @n reached).
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+#define PORTS        (WK2132_SIM_CHIP_MAX * 2)
+#define DURATION_US  1000000
+
+/**
+ * @brief Port that lets the loop take the data pollAll() moved into the receive buffer without touching the bus
+ */
+class BenchPort : public DFRobot_IICSerialPort<1024>{
+public:
+  BenchPort(uint8_t ch, uint8_t ia1, uint8_t ia0):DFRobot_IICSerialPort<1024>(Wire, ch, ia1, ia0){}
+  using DFRobot_IICSerialBase::rxBufferSpan;
+};
+
+typedef struct{
+  uint32_t bytesPerSec;
+  uint32_t transPerKB;
+  uint32_t busUtil;
+  uint32_t minMargin;
+  uint32_t overruns;
+} sResult_t;
+
+static uint8_t pattern(size_t port, size_t i){
+  return (uint8_t)(i * 7 + port * 29 + 3);
+}
+
+static sResult_t run(uint32_t busHz, uint32_t baud){
+  WK2132Sim::reset();
+  BenchPort *ports[PORTS];
+  for(uint8_t i = 0; i < PORTS; i++){
+      uint8_t chip = i / 2;
+      ports[i] = new BenchPort((i & 1) ? SUBUART_CHANNEL_2 : SUBUART_CHANNEL_1, chip >> 1, chip & 1);
+      CHECK_EQ(ports[i]->begin(baud), 0);
+  }
+  Wire.setClock(busHz);
+
+  //Every peer sends for DURATION_US at the full line rate
+  size_t size = (size_t)((uint64_t)baud * DURATION_US / 10 / 1000000);
+  uint8_t *data = new uint8_t[size];
+  for(uint8_t i = 0; i < PORTS; i++){
+      for(size_t j = 0; j < size; j++){
+          data[j] = pattern(i, j);
+      }
+      WK2132Sim::send(i / 2, i & 1, data, size);
+  }
+  delete[] data;
+
+  WK2132Sim::sCounters_t c0 = WK2132Sim::getCounters();
+  uint64_t start = WK2132Sim::now();
+  size_t received[PORTS] = {0};
+  size_t total = 0;
+  while(total < size * PORTS){
+      //Once a peer is done, its FIFO can only drain, so stop when nothing is left on the way
+      bool busy = false;
+      for(uint8_t i = 0; i < PORTS; i++){
+          busy = busy || WK2132Sim::rxCount(i / 2, i & 1) || WK2132Sim::lineBusy(i / 2, i & 1);
+      }
+      if(!busy){
+          break;
+      }
+      //Bytes lost in a full FIFO shift the rest of the stream, so it is only compared before the first overrun
+      bool intact = (WK2132Sim::getCounters().rxOverruns == c0.rxOverruns);
+      DFRobot_IICSerialChip::pollAll();
+      for(uint8_t i = 0; i < PORTS; i++){
+          const uint8_t *p;
+          size_t n;
+          while((n = ports[i]->rxBufferSpan(&p)) != 0){
+              for(size_t j = 0; intact && (j < n); j++){
+                  CHECK_EQ(p[j], pattern(i, received[i] + j));
+              }
+              ports[i]->consume(n);
+              received[i] += n;
+              total += n;
+          }
+      }
+      CHECK(WK2132Sim::now() - start < 10 * DURATION_US);
+  }
+  WK2132Sim::sCounters_t c1 = WK2132Sim::getCounters();
+  uint64_t elapsedUs = WK2132Sim::now() - start;
+
+  sResult_t r;
+  r.bytesPerSec = (uint32_t)((uint64_t)total * 1000000 / elapsedUs);
+  r.transPerKB = (uint32_t)((uint64_t)(c1.transactions - c0.transactions) * 1024 / (total ? total : 1));
+  r.busUtil = (uint32_t)((c1.busNs - c0.busNs) / 10 / elapsedUs);
+  r.minMargin = (uint32_t)(WK2132_SIM_FIFO_SIZE - c1.rxPeak);
+  r.overruns = c1.rxOverruns - c0.rxOverruns;
+  CHECK_EQ(total + r.overruns, size * PORTS);
+  for(uint8_t i = 0; i < PORTS; i++){
+      delete ports[i];
+  }
+  return r;
+}
+
+int main(){
+  const uint32_t clocks[] = {100000, 400000, 1000000};
+  //Highest band rate all eight ports have to sustain without an overrun at each IIC clock
+  const uint32_t sustained[] = {9600, 38400, 115200};
+  const uint32_t bauds[] = {9600, 19200, 38400, 57600, 115200};
+  printf("iic_hz,band_rate,ports,offered_bytes_per_s,delivered_bytes_per_s,iic_trans_per_kb,bus_util_pct,"
+         "min_fifo_margin,rx_overruns\n");
+  for(size_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++){
+      for(size_t j = 0; j < sizeof(bauds) / sizeof(bauds[0]); j++){
+          sResult_t r = run(clocks[i], bauds[j]);
+          printf("%u,%u,%u,%u,%u,%u,%u,%u,%u\n", clocks[i], bauds[j], PORTS, PORTS * bauds[j] / 10,
+                 r.bytesPerSec, r.transPerKB, r.busUtil, r.minMargin, r.overruns);
+          if(bauds[j] <= sustained[i]){
+              CHECK_EQ(r.overruns, 0);
+          }
+      }
+  }
+  return 0;
+}
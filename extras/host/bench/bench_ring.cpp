@@ -0,0 +1,142 @@
+/*!
+ * @file bench_ring.cpp
+ * @brief CPU time per byte taken out of the receive buffer: the masked ring of DFRobot_IICSerialPort against the
+ * @n modulo ring of the old DFRobot_IICSerial, once with the size as a constant(as SERIAL_RX_BUFFER_SIZE was) and
+ * @n once as a member(as a ring sized per port would need). All of them are read through Stream. Prints CSV, the
+ * @n times depend on the host, so only the data is checked.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <chrono>
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+#define RING_SIZE  256
+#define ROUNDS     4000
+
+/**
+ * @brief The receive buffer of the old driver: head/tail wrapped with '%' on every byte
+ */
+template<uint16_t SIZE>
+class ModuloRing : public Stream{
+public:
+  ModuloRing():_size(SIZE){}
+  bool push(uint8_t val){
+      uint16_t j = (uint16_t)(_head + 1) % SIZE;
+      if(j == _tail){
+          return false;
+      }
+      _buf[_head] = val;
+      _head = j;
+      return true;
+  }
+  virtual int available(){return ((unsigned int)(SIZE + _head - _tail)) % SIZE;}
+  virtual int peek(){return (_head == _tail) ? -1 : _buf[_tail];}
+  virtual int read(){
+      if(_head == _tail){
+          return -1;
+      }
+      unsigned char c = _buf[_tail];
+      _tail = (uint16_t)(_tail + 1) % SIZE;
+      return c;
+  }
+  virtual size_t write(uint8_t){return 0;}
+
+protected:
+  volatile uint16_t _head = 0;
+  volatile uint16_t _tail = 0;
+  volatile uint16_t _size;
+  unsigned char _buf[SIZE];
+};
+
+/**
+ * @brief The same ring with the size read from a member, the compiler can not turn '%' into a mask
+ */
+template<uint16_t SIZE>
+class RuntimeModuloRing : public ModuloRing<SIZE>{
+public:
+  bool push(uint8_t val){
+      uint16_t j = (uint16_t)(this->_head + 1) % this->_size;
+      if(j == this->_tail){
+          return false;
+      }
+      this->_buf[this->_head] = val;
+      this->_head = j;
+      return true;
+  }
+  virtual int read(){
+      if(this->_head == this->_tail){
+          return -1;
+      }
+      unsigned char c = this->_buf[this->_tail];
+      this->_tail = (uint16_t)(this->_tail + 1) % this->_size;
+      return c;
+  }
+};
+
+static uint8_t data[RING_SIZE - 1];
+
+/**
+ * @brief Take len bytes out through read() and check them
+ * @return Return the time in nanoseconds
+ */
+static uint64_t timeRead(Stream &s, size_t len){
+  uint8_t buf[RING_SIZE];
+  auto t0 = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < len; i++){
+      buf[i] = (uint8_t)s.read();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  CHECK(memcmp(buf, data, len) == 0);
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+template<typename T>
+static double moduloNsPerByte(){
+  static T ring;
+  uint64_t ns = 0;
+  for(int r = 0; r < ROUNDS; r++){
+      for(size_t i = 0; i < sizeof(data); i++){
+          CHECK(ring.push(data[i]));
+      }
+      ns += timeRead(ring, sizeof(data));
+  }
+  return (double)ns / ROUNDS / sizeof(data);
+}
+
+int main(){
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 13 + 1);
+  }
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<RING_SIZE> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(115200), 0);
+
+  //peek() moves the whole FIFO into the ring, only the reads that follow are timed
+  uint64_t maskedNs = 0, bulkNs = 0;
+  for(int r = 0; r < ROUNDS; r++){
+      WK2132Sim::inject(3, 0, data, sizeof(data));
+      CHECK_EQ(uart.peek(), data[0]);
+      maskedNs += timeRead(uart, sizeof(data));
+  }
+  for(int r = 0; r < ROUNDS; r++){
+      uint8_t buf[sizeof(data)];
+      WK2132Sim::inject(3, 0, data, sizeof(data));
+      CHECK_EQ(uart.peek(), data[0]);
+      auto t0 = std::chrono::steady_clock::now();
+      size_t n = uart.read(buf, sizeof(buf));
+      auto t1 = std::chrono::steady_clock::now();
+      CHECK_EQ(n, sizeof(data));
+      CHECK(memcmp(buf, data, n) == 0);
+      bulkNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+  }
+
+  printf("ring,size,access,ns_per_byte\n");
+  printf("masked,%u,read(),%.2f\n", RING_SIZE, (double)maskedNs / ROUNDS / sizeof(data));
+  printf("masked,%u,read(pBuf),%.2f\n", RING_SIZE, (double)bulkNs / ROUNDS / sizeof(data));
+  printf("modulo_const,%u,read(),%.2f\n", RING_SIZE, moduloNsPerByte<ModuloRing<RING_SIZE> >());
+  printf("modulo_runtime,%u,read(),%.2f\n", RING_SIZE, moduloNsPerByte<RuntimeModuloRing<RING_SIZE> >());
+  return 0;
+}
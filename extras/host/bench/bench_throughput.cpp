@@ -0,0 +1,149 @@
+/*!
+ * @file bench_throughput.cpp
+ * @brief Host version of examples/6.benchmark: sub UART1 of module 3 looped back, for every IIC clock and band rate
+ * @n byte    : write(uint8_t) and read() one byte at a time
+ * @n bulk    : write(pBuf, size) and read(pBuf, size) in BENCH_CHUNK bytes pieces
+ * @n latency : time from the stop bit of a byte sent by the other end until read() returns it
+ * @n Prints one CSV line per test. bus_util_pct is the time the simulated IIC bus was busy, the same columns as
+ * @n the sketch otherwise, so the output of two library versions can be diffed.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <algorithm>
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+#define BENCH_BYTES        2048   //Payload bytes of every throughput test
+#define BENCH_CHUNK        32     //Bytes per write()/read() call in the bulk test
+#define BENCH_IN_FLIGHT    128    //Bytes written but not read yet, the loopback must not overrun the receive FIFO
+#define BENCH_LAT_SAMPLES  100    //Bytes of every latency test
+#define BENCH_TIMEOUT_US   10000000
+
+typedef struct{
+  uint32_t received;
+  uint32_t lost;
+  uint32_t errors;
+  uint64_t elapsedUs;
+  uint64_t busNs;
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t iicTransactions;
+} sResult_t;
+
+static void runThroughput(DFRobot_IICSerialBase &uart, bool bulk, sResult_t *pResult){
+  uint8_t buf[BENCH_CHUNK];
+  uint32_t sent = 0, received = 0, errors = 0;
+  size_t n = 0;
+  uart.resetStats();
+  WK2132Sim::sCounters_t c0 = WK2132Sim::getCounters();
+  uint64_t start = WK2132Sim::now();
+  while((received < BENCH_BYTES) && (WK2132Sim::now() - start < BENCH_TIMEOUT_US)){
+      if((sent < BENCH_BYTES) && (sent - received < BENCH_IN_FLIGHT)){
+          if(bulk){
+              n = std::min<size_t>(BENCH_BYTES - sent, BENCH_IN_FLIGHT - (sent - received));
+              if(n > BENCH_CHUNK){
+                  n = BENCH_CHUNK;
+              }
+              for(size_t i = 0; i < n; i++){
+                  buf[i] = (uint8_t)(sent + i);
+              }
+              sent += uart.write(buf, n);
+          }else{
+              sent += uart.write((uint8_t)sent);
+          }
+      }
+      if(bulk){
+          n = uart.read(buf, sizeof(buf));
+      }else{
+          int c = uart.read();
+          n = 0;
+          if(c >= 0){
+              buf[0] = (uint8_t)c;
+              n = 1;
+          }
+      }
+      for(size_t i = 0; i < n; i++){
+          if(buf[i] != (uint8_t)(received + i)){
+              errors++;
+          }
+      }
+      received += n;
+  }
+  pResult->elapsedUs = WK2132Sim::now() - start;
+  pResult->busNs = WK2132Sim::getCounters().busNs - c0.busNs;
+  pResult->received = received;
+  pResult->lost = BENCH_BYTES - received;
+  pResult->errors = errors;
+  pResult->p50Us = 0;
+  pResult->p99Us = 0;
+  pResult->iicTransactions = uart.getStats().iicTransactions;
+}
+
+/**
+ * @brief The other end sends one byte at a time, the loop polls read() until it is there. The byte is complete
+ * @n one character time after send().
+ */
+static void runLatency(DFRobot_IICSerialBase &uart, sResult_t *pResult){
+  uint32_t samples[BENCH_LAT_SAMPLES];
+  uint32_t lost = 0;
+  uint32_t charUs = uart.getCharTime();
+  uart.resetStats();
+  WK2132Sim::sCounters_t c0 = WK2132Sim::getCounters();
+  uint64_t start = WK2132Sim::now();
+  for(uint8_t k = 0; k < BENCH_LAT_SAMPLES; k++){
+      WK2132Sim::send(3, 0, &k, 1);
+      uint64_t t = WK2132Sim::now();
+      int c = -1;
+      while(((c = uart.read()) < 0) && (WK2132Sim::now() - t < BENCH_TIMEOUT_US / BENCH_LAT_SAMPLES));
+      uint64_t arrived = t + charUs;
+      samples[k] = (uint32_t)((WK2132Sim::now() > arrived) ? (WK2132Sim::now() - arrived) : 0);
+      if(c != k){
+          lost++;
+      }
+  }
+  std::sort(samples, samples + BENCH_LAT_SAMPLES);
+  pResult->elapsedUs = WK2132Sim::now() - start;
+  pResult->busNs = WK2132Sim::getCounters().busNs - c0.busNs;
+  pResult->received = BENCH_LAT_SAMPLES - lost;
+  pResult->lost = lost;
+  pResult->errors = 0;
+  pResult->p50Us = samples[BENCH_LAT_SAMPLES / 2];
+  pResult->p99Us = samples[(BENCH_LAT_SAMPLES * 99) / 100];
+  pResult->iicTransactions = uart.getStats().iicTransactions;
+}
+
+static void printResult(uint32_t busClock, uint32_t baud, const char *mode, const sResult_t &r){
+  uint32_t rate = (uint32_t)((uint64_t)r.received * 1000000 / r.elapsedUs);
+  uint32_t util = (uint32_t)(r.busNs / 10 / r.elapsedUs);
+  printf("%u,%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%.3f\n", busClock, baud, mode, r.received, r.lost, r.errors, rate, util,
+         r.p50Us, r.p99Us, r.iicTransactions, r.received ? (double)r.iicTransactions / r.received : 0.0);
+}
+
+int main(){
+  const uint32_t busClocks[] = {100000, 400000, 1000000};
+  const uint32_t bauds[] = {9600, 57600, 115200, 230400, 460800, 921600};
+  printf("bus_hz,baud,mode,bytes,lost,errors,bytes_per_s,bus_util_pct,p50_us,p99_us,iic_trans,iic_trans_per_byte\n");
+  for(size_t i = 0; i < sizeof(busClocks) / sizeof(busClocks[0]); i++){
+      for(size_t j = 0; j < sizeof(bauds) / sizeof(bauds[0]); j++){
+          WK2132Sim::reset();
+          DFRobot_IICSerialPort<1024> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+          CHECK_EQ(uart.begin(bauds[j]), 0);
+          Wire.setClock(busClocks[i]);
+          WK2132Sim::loopback(3, 0);
+          sResult_t byte, bulk, latency;
+          runThroughput(uart, false, &byte);
+          printResult(busClocks[i], bauds[j], "byte", byte);
+          runThroughput(uart, true, &bulk);
+          printResult(busClocks[i], bauds[j], "bulk", bulk);
+          WK2132Sim::connect(3, 0, -1, 0);
+          runLatency(uart, &latency);
+          printResult(busClocks[i], bauds[j], "latency", latency);
+
+          CHECK_EQ(byte.lost + byte.errors + bulk.lost + bulk.errors + latency.lost, 0);
+          CHECK(bulk.iicTransactions <= byte.iicTransactions);
+      }
+  }
+  return 0;
+}
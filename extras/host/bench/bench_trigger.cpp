@@ -0,0 +1,108 @@
+/*!
+ * @file bench_trigger.cpp
+ * @brief Serviced interrupts and IIC transactions per KB, and the latency of a short message, for several receive and
+ * @n transmit FIFO trigger levels in interrupt mode. Prints one CSV line per setting.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+#define BAUD       115200
+#define STREAM     4096
+#define MESSAGE    10
+
+static uint8_t data[STREAM];
+
+/**
+ * @brief The other end sends STREAM bytes, the loop reads what the interrupts moved in every 50us
+ */
+static void rxStream(DFRobot_IICSerialBase &uart, uint32_t *pIrq, uint32_t *pTrans){
+  WK2132Sim::sCounters_t c0 = WK2132Sim::getCounters();
+  WK2132Sim::send(3, 0, data, sizeof(data));
+  uint8_t buf[128];
+  size_t n = 0;
+  uint64_t start = WK2132Sim::now();
+  while(n < sizeof(data)){
+      size_t k = uart.read(buf, sizeof(buf));
+      CHECK(memcmp(buf, data + n, k) == 0);
+      n += k;
+      CHECK(WK2132Sim::now() - start < 2000000);
+      WK2132Sim::advance(50);
+  }
+  WK2132Sim::sCounters_t c1 = WK2132Sim::getCounters();
+  CHECK_EQ(c1.rxOverruns, c0.rxOverruns);
+  *pIrq = c1.gifrReads - c0.gifrReads;
+  *pTrans = c1.transactions - c0.transactions;
+}
+
+/**
+ * @brief Time from the stop bit of the last byte of a short message until all of it is available
+ */
+static uint32_t rxLatency(DFRobot_IICSerialBase &uart){
+  WK2132Sim::send(3, 0, data, MESSAGE);
+  CHECK(waitFor([]{ return !WK2132Sim::lineBusy(3, 0); }, 10000));
+  uint64_t arrived = WK2132Sim::now();
+  CHECK(waitFor([&]{ return uart.available() >= MESSAGE; }, 20000));
+  uint32_t latency = (uint32_t)(WK2132Sim::now() - arrived);
+  uint8_t buf[MESSAGE];
+  CHECK_EQ(uart.read(buf, MESSAGE), MESSAGE);
+  return latency;
+}
+
+/**
+ * @brief Write STREAM bytes through the ring, the TX trigger interrupt refills the FIFO
+ */
+static void txStream(DFRobot_IICSerialBase &uart, uint32_t *pIrq, uint32_t *pTrans){
+  WK2132Sim::sCounters_t c0 = WK2132Sim::getCounters();
+  size_t sent = 0;
+  while(sent < sizeof(data)){
+      sent += uart.write(data + sent, sizeof(data) - sent);
+      uart.poll();
+      WK2132Sim::advance(50);
+  }
+  CHECK(waitFor([&]{ return uart.isTxComplete(); }, 1000000));
+  WK2132Sim::sCounters_t c1 = WK2132Sim::getCounters();
+  CHECK_EQ(WK2132Sim::takeTx(3, 0).size(), sizeof(data));
+  *pIrq = c1.gifrReads - c0.gifrReads;
+  *pTrans = c1.transactions - c0.transactions;
+}
+
+int main(){
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 31 + 5);
+  }
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<512, 64> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(BAUD), 0);
+  Wire.setClock(400000);
+  CHECK_EQ(uart.attachInterruptPin(WK2132_SIM_IRQ_PIN), 0);
+  uart.available();
+  uart.setTxDeferred(true);
+
+  const uint8_t levels[] = {1, 8, 32, 64, 128, 192};
+  uint32_t irqPerKB[sizeof(levels)];
+  printf("direction,trigger,irq_per_kb,iic_trans_per_kb,latency_us\n");
+  for(size_t i = 0; i < sizeof(levels); i++){
+      uint32_t irq = 0, trans = 0;
+      uart.setFIFOTriggerLevel(levels[i], 0);
+      rxStream(uart, &irq, &trans);
+      uint32_t latency = rxLatency(uart);
+      irqPerKB[i] = irq * 1024 / STREAM;
+      printf("rx,%u,%u,%u,%u\n", levels[i], irqPerKB[i], trans * 1024 / STREAM, latency);
+  }
+  for(size_t i = 0; i < sizeof(levels); i++){
+      uint32_t irq = 0, trans = 0;
+      uart.setFIFOTriggerLevel(0, levels[i]);
+      txStream(uart, &irq, &trans);
+      printf("tx,%u,%u,%u,\n", levels[i], irq * 1024 / STREAM, trans * 1024 / STREAM);
+  }
+  //A higher receive trigger never costs more interrupts
+  for(size_t i = 1; i < sizeof(levels); i++){
+      CHECK(irqPerKB[i] <= irqPerKB[i - 1]);
+  }
+  CHECK(irqPerKB[1] > 4 * irqPerKB[3]);
+  return 0;
+}
@@ -0,0 +1,122 @@
+/*!
+ * @file Arduino.cpp
+ * @brief Host replacement of the Arduino core functions the library and the examples use
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <Arduino.h>
+#include <stdio.h>
+#include "WK2132Sim.h"
+
+#define MOCK_PIN_MAX 64
+
+HardwareSerial Serial;
+
+static uint8_t pinLevel[MOCK_PIN_MAX];
+
+unsigned long millis(void){
+  WK2132Sim::advance(1);
+  return (unsigned long)(WK2132Sim::now() / 1000);
+}
+
+unsigned long micros(void){
+  WK2132Sim::advance(1);
+  return (unsigned long)WK2132Sim::now();
+}
+
+void delay(unsigned long ms){
+  while(ms--){
+      WK2132Sim::advance(1000);
+  }
+}
+
+void delayMicroseconds(unsigned int us){
+  WK2132Sim::advance(us);
+}
+
+void yield(void){}
+
+void interrupts(void){}
+
+void noInterrupts(void){}
+
+void pinMode(uint8_t pin, uint8_t mode){
+  if((pin < MOCK_PIN_MAX) && (mode != OUTPUT)){
+      pinLevel[pin] = HIGH;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val){
+  if(pin < MOCK_PIN_MAX){
+      pinLevel[pin] = val ? HIGH : LOW;
+  }
+}
+
+int digitalRead(uint8_t pin){
+  if(pin == WK2132_SIM_IRQ_PIN){
+      return WK2132Sim::irqLevel();
+  }
+  return (pin < MOCK_PIN_MAX) ? pinLevel[pin] : LOW;
+}
+
+int digitalPinToInterrupt(uint8_t pin){
+  return pin;
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode){
+  (void)mode;
+  WK2132Sim::attachIrq(interruptNum, userFunc);
+}
+
+void detachInterrupt(uint8_t interruptNum){
+  WK2132Sim::attachIrq(interruptNum, NULL);
+}
+
+size_t Print::write(const uint8_t *pBuf, size_t size){
+  size_t n = 0;
+  while(size--){
+      if(write(*pBuf++) == 0){
+          break;
+      }
+      n++;
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base){
+  if((base == DEC) && (n < 0)){
+      return print('-') + print((unsigned long)(-n), base);
+  }
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base){
+  char buf[8 * sizeof(long) + 1];
+  char *p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  if(base < 2){
+      base = 10;
+  }
+  do{
+      char c = n % base;
+      n /= base;
+      *--p = (c < 10) ? (c + '0') : (c + 'A' - 10);
+  }while(n);
+  return write(p);
+}
+
+size_t Print::print(double n, int digits){
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+size_t HardwareSerial::write(uint8_t c){
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *pBuf, size_t size){
+  return fwrite(pBuf, 1, size, stdout);
+}
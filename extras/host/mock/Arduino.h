@@ -0,0 +1,84 @@
+/*!
+ * @file Arduino.h
+ * @brief Host replacement of the Arduino core, just enough to build the library on Linux against WK2132Sim.
+ * @n Time is simulated: millis()/micros() read the clock of WK2132Sim and every call moves it on by 1us, so a
+ * @n polling loop always makes progress.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define ARDUINO 10813
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+void interrupts(void);
+void noInterrupts(void);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+#include "Print.h"
+#include "Stream.h"
+
+/**
+ * @brief Serial of the sketch, prints to stdout
+ */
+class HardwareSerial : public Stream{
+public:
+  void begin(unsigned long baud){(void)baud;}
+  void end(){}
+  virtual size_t write(uint8_t c);
+  virtual size_t write(const uint8_t *pBuf, size_t size);
+  using Print::write;
+  virtual int available(){return 0;}
+  virtual int read(){return -1;}
+  virtual int peek(){return -1;}
+  operator bool(){return true;}
+};
+
+extern HardwareSerial Serial;
+
+#endif
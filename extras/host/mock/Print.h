@@ -0,0 +1,49 @@
+/*!
+ * @file Print.h
+ * @brief Host replacement of the Arduino Print class
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_PRINT_H
+#define __HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef DEC
+#define DEC 10
+#endif
+
+class __FlashStringHelper;
+
+class Print{
+public:
+  virtual ~Print(){}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *pBuf, size_t size);
+  size_t write(const char *str){return (str == NULL) ? 0 : write((const uint8_t *)str, strlen(str));}
+  size_t write(const char *pBuf, size_t size){return write((const uint8_t *)pBuf, size);}
+  virtual int availableForWrite(){return 0;}
+  virtual void flush(){}
+
+  size_t print(const __FlashStringHelper *str){return write((const char *)str);}
+  size_t print(const char *str){return write(str);}
+  size_t print(char c){return write((uint8_t)c);}
+  size_t print(unsigned char n, int base = DEC){return print((unsigned long)n, base);}
+  size_t print(int n, int base = DEC){return print((long)n, base);}
+  size_t print(unsigned int n, int base = DEC){return print((unsigned long)n, base);}
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(long long n, int base = DEC){return print((long)n, base);}
+  size_t print(unsigned long long n, int base = DEC){return print((unsigned long)n, base);}
+  size_t print(double n, int digits = 2);
+
+  size_t println(){return write("\r\n");}
+  template <typename T> size_t println(T val){size_t n = print(val); return n + println();}
+  template <typename T> size_t println(T val, int mod){size_t n = print(val, mod); return n + println();}
+};
+
+#endif
@@ -0,0 +1,27 @@
+/*!
+ * @file Stream.h
+ * @brief Host replacement of the Arduino Stream class
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_STREAM_H
+#define __HOST_STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout){_timeout = timeout;}
+  unsigned long getTimeout(){return _timeout;}
+
+protected:
+  unsigned long _timeout = 1000;
+};
+
+#endif
@@ -0,0 +1,651 @@
+/*!
+ * @file WK2132Sim.cpp
+ * @brief Host model of the WK2132, see WK2132Sim.h
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include "WK2132Sim.h"
+#include <deque>
+#include <mutex>
+
+#define SIM_GENA   0x00
+#define SIM_GRST   0x01
+#define SIM_SPAGE  0x03
+#define SIM_GIER   0x10
+#define SIM_GIFR   0x11
+
+#define SIM_SCR    0x04
+#define SIM_LCR    0x05
+#define SIM_FCR    0x06
+#define SIM_SIER   0x07
+#define SIM_SIFR   0x08
+#define SIM_TFCNT  0x09
+#define SIM_RFCNT  0x0A
+#define SIM_FSR    0x0B
+#define SIM_LSR    0x0C
+#define SIM_FDAT   0x0D
+
+#define SIM_BAUD1  0x04
+#define SIM_BAUD0  0x05
+#define SIM_PRES   0x06
+#define SIM_RFTL   0x07
+#define SIM_TFTL   0x08
+
+#define SIM_LSR_OE 0x08
+
+/**
+ * @brief One sub UART
+ */
+typedef struct{
+    uint8_t page;
+    uint8_t p0[16];
+    uint8_t p1[16];
+    std::deque<uint8_t> rx;
+    std::deque<uint8_t> rxErr;     //< LSR value of every byte in rx
+    std::deque<uint8_t> tx;
+    std::deque<uint16_t> line;     //< Bytes sent by the other end, line error in the high byte
+    bool txShifting;
+    uint8_t txByte;
+    uint64_t txLeftNs;
+    bool rxShifting;
+    uint16_t rxWord;
+    uint64_t rxLeftNs;
+    bool overrun;                  //< The next byte is marked with OE
+    uint64_t rxLastNs;             //< When the last byte entered rx
+    bool hold;
+    int toChip;
+    uint8_t toCh;
+    std::vector<uint8_t> out;
+} sChannel_t;
+
+typedef struct{
+    bool present;
+    uint8_t gena;
+    uint8_t gier;
+    uint8_t regAddr[2];            //< Register address written last on each sub UART address
+    sChannel_t ch[2];
+} sChip_t;
+
+static std::recursive_mutex simMutex;
+static sChip_t simChips[WK2132_SIM_CHIP_MAX];
+static uint64_t simNowNs = 0;
+static uint32_t simBusHz = 100000;
+static uint32_t simFosc = 14745600;
+static uint32_t simFailCount = 0;
+static WK2132Sim::sCounters_t simCounters;
+static void (*simIrqHandler)(void) = NULL;
+static bool simIrqLow = false;
+static bool simIrqFire = false;
+
+static void powerOnChannel(sChannel_t &c){
+  c.page = 0;
+  for(uint8_t i = 0; i < 16; i++){
+      c.p0[i] = 0;
+      c.p1[i] = 0;
+  }
+  c.rx.clear();
+  c.rxErr.clear();
+  c.tx.clear();
+  c.txShifting = false;
+  c.rxShifting = false;
+  c.overrun = false;
+  c.rxLastNs = simNowNs;
+}
+
+static uint64_t charNs(const sChannel_t &c){
+  uint64_t divisor = (((uint64_t)c.p1[SIM_BAUD1] << 8) | c.p1[SIM_BAUD0]) * 10 + c.p1[SIM_PRES];
+  uint64_t baud = ((uint64_t)simFosc * 10 + (divisor + 10) * 8) / ((divisor + 10) * 16);
+  uint8_t lcr = c.p0[SIM_LCR];
+  uint64_t bits = 10 + ((lcr & 0x08) ? 1 : 0) + (lcr & 0x01);
+  return (bits * 1000000000ULL + baud - 1) / baud;
+}
+
+static size_t triggerLevel(uint8_t level, uint8_t fcrBits){
+  static const uint8_t fixed[4] = {8, 16, 24, 28};
+  return level ? level : fixed[fcrBits & 0x03];
+}
+
+static bool clockOn(uint8_t chip, uint8_t ch){
+  return (simChips[chip].gena & (1 << ch)) != 0;
+}
+
+static void rxPush(uint8_t chip, uint8_t ch, uint8_t val, uint8_t err, uint64_t t){
+  sChannel_t &c = simChips[chip].ch[ch];
+  if(!clockOn(chip, ch) || !(c.p0[SIM_SCR] & 0x01)){
+      return;
+  }
+  if(c.rx.size() >= WK2132_SIM_FIFO_SIZE){
+      c.overrun = true;
+      simCounters.rxOverruns++;
+      return;
+  }
+  if(c.overrun){
+      err |= SIM_LSR_OE;
+      c.overrun = false;
+  }
+  c.rx.push_back(val);
+  c.rxErr.push_back(err);
+  c.rxLastNs = t;
+  if(c.rx.size() > simCounters.rxPeak){
+      simCounters.rxPeak = (uint32_t)c.rx.size();
+  }
+}
+
+static void stepChannel(uint8_t chip, uint8_t ch, uint64_t base, uint64_t dt){
+  sChannel_t &c = simChips[chip].ch[ch];
+  if(!clockOn(chip, ch)){
+      return;
+  }
+  uint64_t left = dt;
+  while((c.p0[SIM_SCR] & 0x02) && !c.hold){
+      if(c.txShifting){
+          if(left < c.txLeftNs){
+              c.txLeftNs -= left;
+              break;
+          }
+          left -= c.txLeftNs;
+          c.txShifting = false;
+          if(c.toChip >= 0){
+              rxPush((uint8_t)c.toChip, c.toCh, c.txByte, 0, base + dt - left);
+          }else{
+              c.out.push_back(c.txByte);
+          }
+      }
+      if(c.tx.empty()){
+          break;
+      }
+      c.txByte = c.tx.front();
+      c.tx.pop_front();
+      c.txShifting = true;
+      c.txLeftNs = charNs(c);
+  }
+  left = dt;
+  while(true){
+      if(c.rxShifting){
+          if(left < c.rxLeftNs){
+              c.rxLeftNs -= left;
+              break;
+          }
+          left -= c.rxLeftNs;
+          c.rxShifting = false;
+          rxPush(chip, ch, (uint8_t)c.rxWord, (uint8_t)(c.rxWord >> 8), base + dt - left);
+      }
+      if(c.line.empty()){
+          break;
+      }
+      c.rxWord = c.line.front();
+      c.line.pop_front();
+      c.rxShifting = true;
+      c.rxLeftNs = charNs(c);
+  }
+}
+
+static uint8_t sifr(uint8_t chip, uint8_t ch){
+  const sChannel_t &c = simChips[chip].ch[ch];
+  uint8_t flags = 0;
+  if(c.rx.size() >= triggerLevel(c.p1[SIM_RFTL], c.p0[SIM_FCR] >> 4)){
+      flags |= 0x01;
+  }
+  if(!c.rx.empty() && (simNowNs - c.rxLastNs >= 4 * charNs(c))){
+      flags |= 0x02;
+  }
+  if(c.tx.size() <= triggerLevel(c.p1[SIM_TFTL], c.p0[SIM_FCR] >> 6)){
+      flags |= 0x04;
+  }
+  if(c.tx.empty()){
+      flags |= 0x08;
+  }
+  for(size_t i = 0; i < c.rxErr.size(); i++){
+      if(c.rxErr[i]){
+          flags |= 0x80;
+          break;
+      }
+  }
+  return flags & c.p0[SIM_SIER];
+}
+
+static uint8_t fsr(const sChannel_t &c){
+  uint8_t val = 0;
+  if(c.txShifting){
+      val |= 0x01;
+  }
+  if(c.tx.size() >= WK2132_SIM_FIFO_SIZE){
+      val |= 0x02;
+  }
+  if(!c.tx.empty()){
+      val |= 0x04;
+  }
+  if(!c.rx.empty()){
+      val |= 0x08;
+  }
+  for(size_t i = 0; i < c.rxErr.size(); i++){
+      uint8_t err = c.rxErr[i];
+      if(err & 0x02){
+          val |= 0x10;
+      }
+      if(err & 0x04){
+          val |= 0x20;
+      }
+      if(err & 0x01){
+          val |= 0x40;
+      }
+      if(err & SIM_LSR_OE){
+          val |= 0x80;
+      }
+  }
+  return val;
+}
+
+static void updateIrq(){
+  bool low = false;
+  for(uint8_t k = 0; k < WK2132_SIM_CHIP_MAX; k++){
+      for(uint8_t i = 0; i < 2; i++){
+          if(simChips[k].present && (simChips[k].gier & (1 << i)) && sifr(k, i)){
+              low = true;
+          }
+      }
+  }
+  if(low && !simIrqLow){
+      simCounters.irqEdges++;
+      simIrqFire = true;
+  }
+  simIrqLow = low;
+}
+
+static void advanceNs(uint64_t dt){
+  uint64_t base = simNowNs;
+  for(uint8_t k = 0; k < WK2132_SIM_CHIP_MAX; k++){
+      for(uint8_t i = 0; i < 2; i++){
+          stepChannel(k, i, base, dt);
+      }
+  }
+  simNowNs = base + dt;
+  updateIrq();
+}
+
+/**
+ * @brief Call the IRQ handler for an edge found under the lock. It runs without the lock, like an interrupt
+ * @n that may come at any time.
+ */
+static void fireIrq(){
+  void (*handler)(void) = NULL;
+  {
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    if(simIrqFire){
+        handler = simIrqHandler;
+        simIrqFire = false;
+    }
+  }
+  if(handler != NULL){
+      handler();
+  }
+}
+
+static uint8_t readRegister(uint8_t chip, uint8_t ch, uint8_t reg, bool consume){
+  sChip_t &k = simChips[chip];
+  sChannel_t &c = k.ch[ch];
+  switch(reg){
+      case SIM_GENA:
+          return k.gena | 0x80;
+      case SIM_GRST:
+          return 0;
+      case SIM_GIER:
+          return k.gier;
+      case SIM_GIFR:{
+          uint8_t val = 0;
+          if(consume){
+              simCounters.gifrReads++;
+          }
+          for(uint8_t i = 0; i < 2; i++){
+              if(sifr(chip, i)){
+                  val |= 1 << i;
+              }
+          }
+          return val;
+      }
+      case SIM_SPAGE:
+          return c.page;
+      default:
+          break;
+  }
+  if(reg >= 16){
+      return 0;
+  }
+  if(c.page == 1){
+      return c.p1[reg];
+  }
+  switch(reg){
+      case SIM_SIFR:
+          return sifr(chip, ch);
+      case SIM_TFCNT:
+          return (uint8_t)c.tx.size();
+      case SIM_RFCNT:
+          return (uint8_t)c.rx.size();
+      case SIM_FSR:
+          return fsr(c);
+      case SIM_LSR:
+          return c.rxErr.empty() ? 0 : c.rxErr.front();
+      case SIM_FDAT:{
+          if(c.rx.empty()){
+              return 0;
+          }
+          uint8_t val = c.rx.front();
+          if(consume){
+              c.rx.pop_front();
+              c.rxErr.pop_front();
+          }
+          return val;
+      }
+      default:
+          return c.p0[reg];
+  }
+}
+
+static void writeRegister(uint8_t chip, uint8_t ch, uint8_t reg, uint8_t val){
+  sChip_t &k = simChips[chip];
+  sChannel_t &c = k.ch[ch];
+  switch(reg){
+      case SIM_GENA:
+          k.gena = val & 0x03;
+          return;
+      case SIM_GRST:
+          for(uint8_t i = 0; i < 2; i++){
+              if(val & (1 << i)){
+                  powerOnChannel(k.ch[i]);
+              }
+          }
+          return;
+      case SIM_GIER:
+          k.gier = val & 0x03;
+          return;
+      case SIM_GIFR:
+          return;
+      case SIM_SPAGE:
+          c.page = val & 0x01;
+          return;
+      default:
+          break;
+  }
+  if(reg >= 16){
+      return;
+  }
+  if(c.page == 1){
+      c.p1[reg] = val;
+      return;
+  }
+  switch(reg){
+      case SIM_FDAT:
+          if(c.tx.size() >= WK2132_SIM_FIFO_SIZE){
+              simCounters.txOverruns++;
+          }else{
+              c.tx.push_back(val);
+          }
+          return;
+      case SIM_FCR:
+          if(val & 0x01){
+              c.rx.clear();
+              c.rxErr.clear();
+              c.overrun = false;
+          }
+          if(val & 0x02){
+              c.tx.clear();
+          }
+          c.p0[reg] = val & ~0x03;
+          return;
+      case SIM_SIFR:
+      case SIM_TFCNT:
+      case SIM_RFCNT:
+      case SIM_FSR:
+      case SIM_LSR:
+          return;
+      default:
+          c.p0[reg] = val;
+          return;
+  }
+}
+
+/**
+ * @brief Find the module and sub UART of an address: 0 IA1 IA0 1 0 C1 C0 type
+ * @return Return false if nobody acknowledges the address
+ */
+static bool decodeAddr(uint8_t addr, uint8_t *pChip, uint8_t *pCh){
+  uint8_t pre = addr >> 3;
+  if((pre & 0x03) != 0x02){
+      return false;
+  }
+  *pChip = (pre >> 2) & 0x03;
+  *pCh = (addr >> 1) & 0x03;
+  return (*pCh < 2) && simChips[*pChip].present;
+}
+
+/**
+ * @brief Start, address, data bytes with their ACK bits and stop
+ */
+static uint64_t transactionNs(size_t size){
+  return ((uint64_t)(9 * (1 + size) + 2) * 1000000000ULL + simBusHz - 1) / simBusHz;
+}
+
+/**
+ * @brief Let the bus time of a transaction pass and check that it is acknowledged
+ * @return Return false for a NACK
+ */
+static bool beginTransaction(uint8_t addr, size_t size, uint8_t *pChip, uint8_t *pCh){
+  uint64_t t = transactionNs(size);
+  simCounters.transactions++;
+  simCounters.busNs += t;
+  advanceNs(t);
+  if(simFailCount){
+      simFailCount--;
+      simCounters.nacks++;
+      return false;
+  }
+  if(!decodeAddr(addr, pChip, pCh)){
+      simCounters.nacks++;
+      return false;
+  }
+  return true;
+}
+
+void WK2132Sim::reset(){
+  {
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    simNowNs = 0;
+    simBusHz = 100000;
+    simFosc = 14745600;
+    simFailCount = 0;
+    simCounters = sCounters_t();
+    simIrqLow = false;
+    simIrqFire = false;
+    for(uint8_t k = 0; k < WK2132_SIM_CHIP_MAX; k++){
+        simChips[k].present = true;
+        simChips[k].gena = 0;
+        simChips[k].gier = 0;
+        for(uint8_t i = 0; i < 2; i++){
+            sChannel_t &c = simChips[k].ch[i];
+            powerOnChannel(c);
+            c.line.clear();
+            c.out.clear();
+            c.hold = false;
+            c.toChip = -1;
+            c.toCh = 0;
+            simChips[k].regAddr[i] = 0;
+        }
+    }
+  }
+}
+
+uint64_t WK2132Sim::now(){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  return simNowNs / 1000;
+}
+
+void WK2132Sim::advance(uint32_t us){
+  {
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    advanceNs((uint64_t)us * 1000);
+  }
+  fireIrq();
+}
+
+void WK2132Sim::setBusClock(uint32_t hz){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  if(hz){
+      simBusHz = hz;
+  }
+}
+
+void WK2132Sim::setCrystalFrequency(uint32_t hz){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  if(hz){
+      simFosc = hz;
+  }
+}
+
+void WK2132Sim::setPresent(uint8_t chip, bool present){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  simChips[chip & 0x03].present = present;
+}
+
+void WK2132Sim::failNext(uint32_t count){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  simFailCount = count;
+}
+
+void WK2132Sim::connect(uint8_t chip, uint8_t ch, int toChip, uint8_t toCh){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  sChannel_t &c = simChips[chip & 0x03].ch[ch & 0x01];
+  c.toChip = (toChip < 0) ? -1 : (toChip & 0x03);
+  c.toCh = toCh & 0x01;
+}
+
+void WK2132Sim::holdTx(uint8_t chip, uint8_t ch, bool hold){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  simChips[chip & 0x03].ch[ch & 0x01].hold = hold;
+}
+
+void WK2132Sim::send(uint8_t chip, uint8_t ch, const void *pBuf, size_t size, uint8_t lineErr){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  sChannel_t &c = simChips[chip & 0x03].ch[ch & 0x01];
+  const uint8_t *pData = (const uint8_t *)pBuf;
+  for(size_t i = 0; i < size; i++){
+      c.line.push_back(pData[i] | ((uint16_t)lineErr << 8));
+  }
+}
+
+void WK2132Sim::inject(uint8_t chip, uint8_t ch, const void *pBuf, size_t size, uint8_t lineErr){
+  {
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    const uint8_t *pData = (const uint8_t *)pBuf;
+    for(size_t i = 0; i < size; i++){
+        rxPush(chip & 0x03, ch & 0x01, pData[i], lineErr, simNowNs);
+    }
+    updateIrq();
+  }
+  fireIrq();
+}
+
+std::vector<uint8_t> WK2132Sim::takeTx(uint8_t chip, uint8_t ch){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  std::vector<uint8_t> out;
+  out.swap(simChips[chip & 0x03].ch[ch & 0x01].out);
+  return out;
+}
+
+bool WK2132Sim::lineBusy(uint8_t chip, uint8_t ch){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  const sChannel_t &c = simChips[chip & 0x03].ch[ch & 0x01];
+  return c.rxShifting || !c.line.empty();
+}
+
+size_t WK2132Sim::rxCount(uint8_t chip, uint8_t ch){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  return simChips[chip & 0x03].ch[ch & 0x01].rx.size();
+}
+
+size_t WK2132Sim::txCount(uint8_t chip, uint8_t ch){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  return simChips[chip & 0x03].ch[ch & 0x01].tx.size();
+}
+
+uint8_t WK2132Sim::reg(uint8_t chip, uint8_t ch, uint8_t page, uint8_t reg){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  sChannel_t &c = simChips[chip & 0x03].ch[ch & 0x01];
+  uint8_t current = c.page;
+  c.page = page & 0x01;
+  uint8_t val = readRegister(chip & 0x03, ch & 0x01, reg, false);
+  c.page = current;
+  return val;
+}
+
+int WK2132Sim::irqLevel(){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  updateIrq();
+  return simIrqLow ? 0 : 1;
+}
+
+WK2132Sim::sCounters_t WK2132Sim::getCounters(){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  return simCounters;
+}
+
+uint8_t WK2132Sim::i2cWrite(uint8_t addr, const uint8_t *pBuf, size_t size){
+  uint8_t ret = 0;
+  {
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    uint8_t chip = 0, ch = 0;
+    if(!beginTransaction(addr, size, &chip, &ch)){
+        ret = 2;
+    }else if(addr & 0x01){
+        sChannel_t &c = simChips[chip].ch[ch];
+        for(size_t i = 0; i < size; i++){
+            if(c.tx.size() >= WK2132_SIM_FIFO_SIZE){
+                simCounters.txOverruns++;
+            }else{
+                c.tx.push_back(pBuf[i]);
+            }
+        }
+    }else if(size){
+        simChips[chip].regAddr[ch] = pBuf[0];
+        for(size_t i = 1; i < size; i++){
+            writeRegister(chip, ch, pBuf[0], pBuf[i]);
+        }
+    }
+    updateIrq();
+  }
+  fireIrq();
+  return ret;
+}
+
+size_t WK2132Sim::i2cRead(uint8_t addr, uint8_t *pBuf, size_t size){
+  size_t num = 0;
+  {
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    uint8_t chip = 0, ch = 0;
+    if(beginTransaction(addr, size, &chip, &ch)){
+        sChannel_t &c = simChips[chip].ch[ch];
+        for(num = 0; num < size; num++){
+            if(!(addr & 0x01)){
+                pBuf[num] = readRegister(chip, ch, simChips[chip].regAddr[ch], true);
+            }else if(c.rx.empty()){
+                pBuf[num] = 0;
+            }else{
+                pBuf[num] = c.rx.front();
+                c.rx.pop_front();
+                c.rxErr.pop_front();
+            }
+        }
+    }
+    updateIrq();
+  }
+  fireIrq();
+  return num;
+}
+
+void WK2132Sim::attachIrq(uint8_t pin, void (*handler)(void)){
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  if(pin == WK2132_SIM_IRQ_PIN){
+      simIrqHandler = handler;
+  }
+}
@@ -0,0 +1,224 @@
+/*!
+ * @file WK2132Sim.h
+ * @brief Host model of up to four WK2132 modules on one simulated IIC bus, used by the mock TwoWire.
+ * @n
+ * @n Every sub UART has the page 0/page 1 registers, 256 bytes receive and transmit FIFOs, and a transmitter and
+ * @n a receiver that move one character per character time of the configured band rate and data format. The
+ * @n registers behave as the driver relies on:
+ * @n   GENA/GRST/GIER/GIFR, SPAGE, SCR/LCR/FCR/SIER/SIFR/TFCNT/RFCNT/FSR/LSR/FDAT, BAUD1/BAUD0/PRES/RFTL/TFTL
+ * @n   RFCNT and TFCNT read 0 for both an empty and a full(256 bytes) FIFO, FSR RDAT/TFULL tell them apart
+ * @n   bit 0 of the IIC address selects the FIFO object, a FIFO read of an empty FIFO returns 0
+ * @n   SIFR flags are masked by SIER, the IRQ output is low while a sub UART enabled in GIER has a flag set
+ * @n
+ * @n Time is simulated in nanoseconds. It moves on with every IIC transaction by the time the bytes take on the
+ * @n bus at the clock set by TwoWire::setClock(), with delay()/delayMicroseconds(), by 1us per millis()/micros()
+ * @n call and through advance(). The IRQ handler attached to the IRQ pin is called on every falling edge. All
+ * @n functions may be called from several threads.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __WK2132_SIM_H
+#define __WK2132_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define WK2132_SIM_CHIP_MAX   4     //< IA1/IA0 select one of 4 modules, the index is IA1 * 2 + IA0
+#define WK2132_SIM_FIFO_SIZE  256
+#define WK2132_SIM_IRQ_PIN    2     //< The IRQ outputs of all modules are wired to this pin
+
+class WK2132Sim{
+public:
+  /**
+   * @struct sCounters_t
+   * @brief What happened on the bus and on the lines since reset()
+   */
+  typedef struct{
+      uint32_t transactions; /**< IIC transactions, acknowledged or not */
+      uint32_t nacks;        /**< Transactions not acknowledged */
+      uint64_t busNs;        /**< Time the bus was busy */
+      uint32_t irqEdges;     /**< Falling edges of the IRQ output */
+      uint32_t gifrReads;    /**< GIFR reads, the driver reads it once per interrupt it services */
+      uint32_t rxOverruns;   /**< Bytes lost because a receive FIFO was full */
+      uint32_t txOverruns;   /**< Bytes lost because a transmit FIFO was full */
+      uint32_t rxPeak;       /**< Highest fill level any receive FIFO reached */
+  } sCounters_t;
+
+  /**
+   * @fn reset
+   * @brief Power on every module again, clear the lines, counters and the clock, bus clock 100kHz
+   */
+  static void reset();
+
+  /**
+   * @fn now
+   * @brief Get the simulated time
+   * @return Return microseconds since reset()
+   */
+  static uint64_t now();
+
+  /**
+   * @fn advance
+   * @brief Let time pass, the transmitters and receivers move data meanwhile
+   * @param us Microseconds
+   */
+  static void advance(uint32_t us);
+
+  /**
+   * @fn setBusClock
+   * @brief Set the IIC clock, called by TwoWire::setClock()
+   * @param hz Clock in Hz
+   */
+  static void setBusClock(uint32_t hz);
+
+  /**
+   * @fn setCrystalFrequency
+   * @brief Set the crystal of every module(default 14.7456MHz)
+   * @param hz Frequency in Hz
+   */
+  static void setCrystalFrequency(uint32_t hz);
+
+  /**
+   * @fn setPresent
+   * @brief Plug or unplug a module, an absent module does not acknowledge its addresses(all present by default)
+   * @param chip Module index, IA1 * 2 + IA0
+   * @param present true: acknowledge, false: NACK
+   */
+  static void setPresent(uint8_t chip, bool present);
+
+  /**
+   * @fn failNext
+   * @brief Let the next transactions fail with a NACK of the address, whatever the address
+   * @param count Number of transactions
+   */
+  static void failNext(uint32_t count);
+
+  /**
+   * @fn connect
+   * @brief Wire the TX pin of a sub UART to the RX pin of another one or of itself(loopback). Bytes shifted out
+   * @n of an unconnected TX pin are kept for takeTx().
+   * @param chip Module of the transmitter
+   * @param ch Sub UART of the transmitter, 0 or 1
+   * @param toChip Module of the receiver, -1 to disconnect
+   * @param toCh Sub UART of the receiver
+   */
+  static void connect(uint8_t chip, uint8_t ch, int toChip, uint8_t toCh);
+  static void loopback(uint8_t chip, uint8_t ch){connect(chip, ch, chip, ch);}
+
+  /**
+   * @fn holdTx
+   * @brief Stop or restart the transmitter, e.g. to make flush() time out
+   * @param chip Module index
+   * @param ch Sub UART, 0 or 1
+   * @param hold true: stop shifting, false: shift normally
+   */
+  static void holdTx(uint8_t chip, uint8_t ch, bool hold);
+
+  /**
+   * @fn send
+   * @brief Queue bytes sent by the other end of the RX line, they arrive one character time after another
+   * @param chip Module index
+   * @param ch Sub UART, 0 or 1
+   * @param pBuf Data
+   * @param size Length of the data
+   * @param lineErr Line error of every byte, DFROBOT_IICSERIAL_LINE_ERR_BI/PE/FE as found in LSR
+   */
+  static void send(uint8_t chip, uint8_t ch, const void *pBuf, size_t size, uint8_t lineErr = 0);
+
+  /**
+   * @fn inject
+   * @brief Put bytes in the receive FIFO at once, as if they had arrived earlier
+   * @param chip Module index
+   * @param ch Sub UART, 0 or 1
+   * @param pBuf Data
+   * @param size Length of the data
+   * @param lineErr Line error of every byte
+   */
+  static void inject(uint8_t chip, uint8_t ch, const void *pBuf, size_t size, uint8_t lineErr = 0);
+
+  /**
+   * @fn takeTx
+   * @brief Take the bytes shifted out of an unconnected TX pin
+   * @param chip Module index
+   * @param ch Sub UART, 0 or 1
+   * @return Return the bytes in the order they were sent
+   */
+  static std::vector<uint8_t> takeTx(uint8_t chip, uint8_t ch);
+
+  /**
+   * @fn lineBusy
+   * @brief Check whether bytes queued by send() are still on the way
+   * @return Return true if a byte is still to arrive
+   */
+  static bool lineBusy(uint8_t chip, uint8_t ch);
+
+  /**
+   * @fn rxCount
+   * @brief Get the real fill level of a receive FIFO, 0~256
+   */
+  static size_t rxCount(uint8_t chip, uint8_t ch);
+
+  /**
+   * @fn txCount
+   * @brief Get the real fill level of a transmit FIFO, 0~256
+   */
+  static size_t txCount(uint8_t chip, uint8_t ch);
+
+  /**
+   * @fn reg
+   * @brief Read a register without side effects
+   * @param chip Module index
+   * @param ch Sub UART, 0 or 1
+   * @param page 0 or 1, ignored for the global registers
+   * @param reg Register address
+   * @return Return the register value
+   */
+  static uint8_t reg(uint8_t chip, uint8_t ch, uint8_t page, uint8_t reg);
+
+  /**
+   * @fn irqLevel
+   * @brief Get the level of the IRQ output shared by all modules
+   * @return Return LOW while an interrupt is pending, otherwise HIGH
+   */
+  static int irqLevel();
+
+  /**
+   * @fn getCounters
+   * @brief Get the bus and line counters
+   * @return Return the counters since reset()
+   */
+  static sCounters_t getCounters();
+
+  /**
+   * @fn i2cWrite
+   * @brief One write transaction, used by TwoWire
+   * @param addr 7-bits IIC address
+   * @param pBuf Data
+   * @param size Length of the data
+   * @return Return 0 if acknowledged, 2 if the address was not acknowledged
+   */
+  static uint8_t i2cWrite(uint8_t addr, const uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn i2cRead
+   * @brief One read transaction, used by TwoWire
+   * @param addr 7-bits IIC address
+   * @param pBuf Store buffer for the data
+   * @param size Length of the data
+   * @return Return the number of bytes read, 0 if the address was not acknowledged
+   */
+  static size_t i2cRead(uint8_t addr, uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn attachIrq
+   * @brief Set the handler called on a falling edge of the IRQ pin, used by attachInterrupt()
+   * @param pin Pin of the handler, only WK2132_SIM_IRQ_PIN is wired to the modules
+   * @param handler The handler, NULL to detach
+   */
+  static void attachIrq(uint8_t pin, void (*handler)(void));
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*!
+ * @file Wire.cpp
+ * @brief Host replacement of TwoWire, every transaction goes to WK2132Sim
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <Wire.h>
+#include "WK2132Sim.h"
+
+TwoWire Wire;
+
+void TwoWire::setClock(uint32_t clock){
+  WK2132Sim::setBusClock(clock);
+}
+
+void TwoWire::beginTransmission(uint8_t address){
+  _txAddr = address;
+  _txLen = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop){
+  (void)sendStop;
+  uint8_t ret = WK2132Sim::i2cWrite(_txAddr, _txBuf, _txLen);
+  _txLen = 0;
+  return ret;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity){
+  if(quantity > BUFFER_LENGTH){
+      quantity = BUFFER_LENGTH;
+  }
+  _rxLen = WK2132Sim::i2cRead(address, _rxBuf, quantity);
+  _rxPos = 0;
+  return (uint8_t)_rxLen;
+}
+
+size_t TwoWire::write(uint8_t data){
+  if(_txLen >= BUFFER_LENGTH){
+      return 0;
+  }
+  _txBuf[_txLen++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *pBuf, size_t size){
+  size_t n = 0;
+  while((n < size) && write(pBuf[n])){
+      n++;
+  }
+  return n;
+}
+
+int TwoWire::available(){
+  return (int)(_rxLen - _rxPos);
+}
+
+int TwoWire::read(){
+  return (_rxPos < _rxLen) ? _rxBuf[_rxPos++] : -1;
+}
+
+int TwoWire::peek(){
+  return (_rxPos < _rxLen) ? _rxBuf[_rxPos] : -1;
+}
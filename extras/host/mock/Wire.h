@@ -0,0 +1,46 @@
+/*!
+ * @file Wire.h
+ * @brief Host replacement of TwoWire. Every TwoWire object is a master on the simulated bus of WK2132Sim, with
+ * @n the 32 byte transmit and receive buffers of the AVR core.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_WIRE_H
+#define __HOST_WIRE_H
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire : public Stream{
+public:
+  void begin(){}
+  void end(){}
+  void setClock(uint32_t clock);
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address){beginTransmission((uint8_t)address);}
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  uint8_t requestFrom(int address, int quantity){return requestFrom((uint8_t)address, (uint8_t)quantity);}
+
+  virtual size_t write(uint8_t data);
+  virtual size_t write(const uint8_t *pBuf, size_t size);
+  using Print::write;
+  virtual int available();
+  virtual int read();
+  virtual int peek();
+
+private:
+  uint8_t _txAddr = 0;
+  uint8_t _txBuf[BUFFER_LENGTH];
+  size_t _txLen = 0;
+  uint8_t _rxBuf[BUFFER_LENGTH];
+  size_t _rxLen = 0;
+  size_t _rxPos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,54 @@
+/*!
+ * @file HostTest.h
+ * @brief Checks shared by the host tests, a failed check prints where and exits with 1 so ctest reports it
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_TEST_H
+#define __HOST_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "WK2132Sim.h"
+
+#define CHECK(cond) do{ \
+    if(!(cond)){ \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+  }while(0)
+
+#define CHECK_EQ(a, b) do{ \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if(_a != _b){ \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        exit(1); \
+    } \
+  }while(0)
+
+/**
+ * @brief Let simulated time pass until the condition holds
+ * @return Return false if it still does not hold after timeoutUs
+ */
+template <typename T>
+static bool waitFor(T cond, uint32_t timeoutUs){
+  uint64_t start = WK2132Sim::now();
+  while(!cond()){
+      if(WK2132Sim::now() - start > timeoutUs){
+          return false;
+      }
+      WK2132Sim::advance(10);
+  }
+  return true;
+}
+
+/**
+ * @brief IIC transactions counted by the model, to compare with DFROBOT_IICSERIAL_STATS
+ */
+static inline uint32_t simTransactions(){
+  return WK2132Sim::getCounters().transactions;
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*!
+ * @file ModbusSlave.h
+ * @brief Modbus RTU slave at the other end of a sub UART of the model. It answers read holding registers(0x03)
+ * @n requests with register n holding the value n, for the Modbus master tests and benchmarks.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_MODBUS_SLAVE_H
+#define __HOST_MODBUS_SLAVE_H
+
+#include <vector>
+#include <DFRobot_IICSerialModbus.h>
+#include "WK2132Sim.h"
+
+class ModbusSlave{
+public:
+  ModbusSlave(uint8_t chip, uint8_t ch, uint8_t addr):_chip(chip), _ch(ch), _addr(addr){}
+
+  /**
+   * @fn poll
+   * @brief Take what the master sent and answer once a request of 8 bytes is complete
+   */
+  void poll(){
+      std::vector<uint8_t> data = WK2132Sim::takeTx(_chip, _ch);
+      _request.insert(_request.end(), data.begin(), data.end());
+      if(_request.size() < 8){
+          return;
+      }
+      const uint8_t *p = _request.data();
+      if((_request.size() == 8) && (p[0] == _addr) && (p[1] == MODBUS_READ_HOLDING_REGISTERS) &&
+         (DFRobot_IICSerialModbus::crc16(p, 8) == 0) && !silent){
+          uint16_t first = (p[2] << 8) | p[3];
+          uint16_t count = (p[4] << 8) | p[5];
+          std::vector<uint8_t> answer = {_addr, MODBUS_READ_HOLDING_REGISTERS, (uint8_t)(count * 2)};
+          for(uint16_t i = 0; i < count; i++){
+              answer.push_back((uint8_t)((first + i) >> 8));
+              answer.push_back((uint8_t)(first + i));
+          }
+          uint16_t crc = DFRobot_IICSerialModbus::crc16(answer.data(), answer.size());
+          if(badCrc){
+              crc ^= 0x0001;
+          }
+          answer.push_back((uint8_t)crc);
+          answer.push_back((uint8_t)(crc >> 8));
+          WK2132Sim::send(_chip, _ch, answer.data(), answer.size());
+          answers++;
+      }
+      _request.clear();
+  }
+
+  /**
+   * @fn clear
+   * @brief Forget what the master sent so far
+   */
+  void clear(){
+      WK2132Sim::takeTx(_chip, _ch);
+      _request.clear();
+  }
+
+  bool silent = false;   //< Do not answer
+  bool badCrc = false;   //< Answer with a wrong CRC
+  uint32_t answers = 0;
+
+private:
+  uint8_t _chip;
+  uint8_t _ch;
+  uint8_t _addr;
+  std::vector<uint8_t> _request;
+};
+
+#endif
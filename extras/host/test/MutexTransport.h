@@ -0,0 +1,59 @@
+/*!
+ * @file MutexTransport.h
+ * @brief Transport of Wire with a host mutex, as lock()/unlock() would be overridden for an RTOS. For the tests
+ * @n built with DFROBOT_IICSERIAL_THREAD_SAFE. It also records the longest simulated time the lock was held, which
+ * @n is how long another task may have had to wait for the bus.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __HOST_MUTEX_TRANSPORT_H
+#define __HOST_MUTEX_TRANSPORT_H
+
+#include <mutex>
+#include <DFRobot_IICSerial.h>
+#include "WK2132Sim.h"
+
+class MutexTransport : public DFRobot_IICSerialTransport{
+public:
+  MutexTransport():_pBus(DFRobot_IICSerialWireTransport::get(&Wire)){}
+  virtual void begin(){_pBus->begin();}
+  virtual uint8_t write(uint8_t addr, const uint8_t *pBuf, size_t size){return _pBus->write(addr, pBuf, size);}
+  virtual size_t read(uint8_t addr, uint8_t *pBuf, size_t size){return _pBus->read(addr, pBuf, size);}
+  virtual void lock(){
+      _mutex.lock();
+      if(_depth++ == 0){
+          _lockedUs = WK2132Sim::now();
+      }
+  }
+  virtual void unlock(){
+      if((--_depth == 0) && (WK2132Sim::now() - _lockedUs > _maxHeldUs)){
+          _maxHeldUs = WK2132Sim::now() - _lockedUs;
+      }
+      _mutex.unlock();
+  }
+
+  /**
+   * @fn getMaxHeld
+   * @brief Get the longest time between the outermost lock() and its unlock() since resetMaxHeld()
+   * @return Return the time in simulated microseconds
+   */
+  uint64_t getMaxHeld(){
+      std::lock_guard<std::recursive_mutex> guard(_mutex);
+      return _maxHeldUs;
+  }
+  void resetMaxHeld(){
+      std::lock_guard<std::recursive_mutex> guard(_mutex);
+      _maxHeldUs = 0;
+  }
+
+private:
+  DFRobot_IICSerialTransport *_pBus;
+  std::recursive_mutex _mutex;
+  uint32_t _depth = 0;
+  uint64_t _lockedUs = 0;
+  uint64_t _maxHeldUs = 0;
+};
+
+#endif
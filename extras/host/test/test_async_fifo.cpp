@@ -0,0 +1,54 @@
+/*!
+ * @file test_async_fifo.cpp
+ * @brief pollAsync() with a full FIFO in each direction: RFCNT and TFCNT read 0 for a null and a full FIFO alike, a
+ * @n full receive FIFO must still be drained and a full transmit FIFO must not be taken for an empty one
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include <vector>
+#include "HostTest.h"
+
+static uint8_t data[1024];
+
+static void checkRx(DFRobot_IICSerialPort<1024, 32> &uart, size_t size){
+  WK2132Sim::inject(3, 0, data, size);
+  for(uint8_t i = 0; i < 50; i++){
+      uart.pollAsync();
+  }
+  CHECK_EQ(WK2132Sim::rxCount(3, 0), 0);
+  for(size_t i = 0; i < size; i++){
+      CHECK_EQ(uart.read(), data[i]);
+  }
+}
+
+int main(){
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 5 + 3);
+  }
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<1024, 32> rx(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(rx.begin(115200), 0);
+  Wire.setClock(400000);
+  //A full receive FIFO, then one more than a trigger level
+  checkRx(rx, 256);
+  checkRx(rx, 255);
+  checkRx(rx, 256);
+  CHECK_EQ(WK2132Sim::getCounters().rxOverruns, 0);
+
+  //The transmit FIFO stays full for most of the time at 9600, while pollAsync() checks it again and again
+  DFRobot_IICSerialPort<32, 1024> tx(Wire, SUBUART_CHANNEL_2, 1, 1);
+  CHECK_EQ(tx.begin(9600), 0);
+  tx.setTxDeferred(true);
+  CHECK_EQ(tx.write(data, 1000), 1000);
+  CHECK(waitFor([&]{
+      return !tx.pollAsync() && (tx.availableForWrite() == 1023) && tx.isTxComplete();
+  }, 2000000));
+  std::vector<uint8_t> line = WK2132Sim::takeTx(3, 1);
+  printf("%u bytes sent, %u transmit FIFO overruns\n", (uint32_t)line.size(), WK2132Sim::getCounters().txOverruns);
+  CHECK_EQ(WK2132Sim::getCounters().txOverruns, 0);
+  CHECK(line == std::vector<uint8_t>(data, data + 1000));
+  return 0;
+}
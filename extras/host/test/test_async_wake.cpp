@@ -0,0 +1,74 @@
+/*!
+ * @file test_async_wake.cpp
+ * @brief pollAsync() on a sub UART in auto sleep: the callback of the receive FIFO burst does no register write,
+ * @n the wakeup from sleep follows with the next pollAsync()
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+#define SIM_PAGE0_SCR      0x04
+#define SIM_SCR_SLEEPEN    0x04
+
+/*Transport of Wire that counts register writes made while a transfer is being submitted, that is from its callback*/
+class WatchTransport : public DFRobot_IICSerialTransport{
+public:
+  WatchTransport():_pBus(DFRobot_IICSerialWireTransport::get(&Wire)){}
+  virtual void begin(){_pBus->begin();}
+  virtual uint8_t write(uint8_t addr, const uint8_t *pBuf, size_t size){
+      //A register address alone is the first half of a read
+      if((_depth > 0) && (size > 1)){
+          callbackWrites++;
+      }
+      return _pBus->write(addr, pBuf, size);
+  }
+  virtual size_t read(uint8_t addr, uint8_t *pBuf, size_t size){return _pBus->read(addr, pBuf, size);}
+  virtual int submit(sTransfer_t *pTransfer){
+      _depth++;
+      int ret = DFRobot_IICSerialTransport::submit(pTransfer);
+      _depth--;
+      return ret;
+  }
+  uint32_t callbackWrites = 0;
+
+private:
+  DFRobot_IICSerialTransport *_pBus;
+  uint32_t _depth = 0;
+};
+
+int main(){
+  uint8_t data[16];
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(0x40 + i);
+  }
+  WK2132Sim::reset();
+  WatchTransport bus;
+  DFRobot_IICSerialPort<64> uart(bus, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(115200), 0);
+  Wire.setClock(400000);
+  uart.setAutoSleep(5);
+  CHECK(waitFor([&]{
+      uart.pollAsync();
+      return uart.isSleeping();
+  }, 100000));
+  CHECK(WK2132Sim::reg(3, 0, 0, SIM_PAGE0_SCR) & SIM_SCR_SLEEPEN);
+
+  WK2132Sim::send(3, 0, data, sizeof(data));
+  CHECK(waitFor([&]{
+      uart.pollAsync();
+      return !uart.isSleeping();
+  }, 100000));
+  CHECK_EQ(bus.callbackWrites, 0);
+  CHECK_EQ(WK2132Sim::reg(3, 0, 0, SIM_PAGE0_SCR) & SIM_SCR_SLEEPEN, 0);
+  CHECK(waitFor([&]{
+      uart.pollAsync();
+      return uart.available() == (int)sizeof(data);
+  }, 100000));
+  for(size_t i = 0; i < sizeof(data); i++){
+      CHECK_EQ(uart.read(), data[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+/*!
+ * @file test_begin.cpp
+ * @brief IIC transactions of begin() with the shadowed configuration registers, and the register values the
+ * @n model ends up with
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+int main(){
+  WK2132Sim::reset();
+  DFRobot_IICSerial uart1(Wire, SUBUART_CHANNEL_1, 1, 1);
+  DFRobot_IICSerial uart2(Wire, SUBUART_CHANNEL_2, 1, 1);
+
+  uint32_t t0 = simTransactions();
+  CHECK_EQ(uart1.begin(115200), 0);
+  uint32_t first = simTransactions() - t0;
+  //Accesses to the global registers are counted on sub UART1
+  CHECK_EQ(uart1.getStats().iicTransactions, first);
+
+  t0 = simTransactions();
+  CHECK_EQ(uart2.begin(9600, IICSerial_8N2), 0);
+  uint32_t second = simTransactions() - t0;
+
+  t0 = simTransactions();
+  CHECK_EQ(uart1.begin(115200), 0);
+  uint32_t again = simTransactions() - t0;
+
+  t0 = simTransactions();
+  CHECK_EQ(uart1.begin(921600, IICSerial_8E1), 0);
+  uint32_t other = simTransactions() - t0;
+  printf("begin() transactions: first sub UART %u, second %u, same setting again %u, new setting %u\n", first, second, again, other);
+  CHECK(first <= 20);
+  CHECK(second <= 20);
+  CHECK(again <= 16);
+  CHECK(other <= 16);
+
+  //What the shadow skipped has to be in the chip all the same
+  CHECK_EQ(WK2132Sim::reg(3, 0, 0, 0x00) & 0x03, 0x03);
+  CHECK_EQ(WK2132Sim::reg(3, 0, 0, 0x10) & 0x03, 0x03);
+  for(uint8_t ch = 0; ch < 2; ch++){
+      CHECK_EQ(WK2132Sim::reg(3, ch, 0, 0x03), 0);
+      CHECK_EQ(WK2132Sim::reg(3, ch, 0, 0x04) & 0x03, 0x03);
+      CHECK_EQ(WK2132Sim::reg(3, ch, 0, 0x06) & 0x0C, 0x0C);
+      CHECK_EQ(WK2132Sim::reg(3, ch, 0, 0x07) & 0x8F, 0x8F);
+  }
+  CHECK_EQ(WK2132Sim::reg(3, 0, 0, 0x05) & 0x0F, IICSerial_8E1);
+  CHECK_EQ(WK2132Sim::reg(3, 0, 1, 0x05), 0);
+  CHECK_EQ(WK2132Sim::reg(3, 1, 0, 0x05) & 0x0F, IICSerial_8N2);
+  CHECK_EQ(WK2132Sim::reg(3, 1, 1, 0x05), 95);
+
+  //Both sub UARTs work after the other one was set up again
+  WK2132Sim::loopback(3, 0);
+  WK2132Sim::loopback(3, 1);
+  uart1.write('a');
+  uart2.write('b');
+  CHECK(waitFor([&]{ return (uart1.available() > 0) && (uart2.available() > 0); }, 5000));
+  CHECK_EQ(uart1.read(), 'a');
+  CHECK_EQ(uart2.read(), 'b');
+  printf("ok\n");
+  return 0;
+}
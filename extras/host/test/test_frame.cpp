@@ -0,0 +1,50 @@
+/*!
+ * @file test_frame.cpp
+ * @brief DFRobot_IICSerialFrame in length prefix mode: a frame dropped for a line error is still skipped by the
+ * @n length in its own header, so the frame after it is received whole
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include <vector>
+#include "HostTest.h"
+
+static std::vector<std::vector<uint8_t> > frames;
+
+static void onFrame(DFRobot_IICSerialBase *pPort, const uint8_t *pFrame, size_t size){
+  (void)pPort;
+  frames.push_back(std::vector<uint8_t>(pFrame, pFrame + size));
+}
+
+int main(){
+  //Header 0xAA and a length byte, then the payload
+  const uint8_t first[] = {0xAA, 10, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  const uint8_t broken[] = {0xAA, 3, 0x31, 0x32, 0x33};
+  const uint8_t last[] = {0xAA, 2, 0x41, 0x42};
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<64> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(115200), 0);
+  uart.setRxErrorTracking(true);
+  uint8_t buf[32];
+  DFRobot_IICSerialFrame frame(uart, buf, sizeof(buf));
+  frame.setLengthPrefix(1);
+  frame.setCallback(onFrame);
+
+  WK2132Sim::inject(3, 0, first, sizeof(first));
+  //A parity error on the header byte, before the length byte arrives
+  WK2132Sim::inject(3, 0, broken, 1, DFROBOT_IICSERIAL_LINE_ERR_PE);
+  WK2132Sim::inject(3, 0, broken + 1, sizeof(broken) - 1);
+  WK2132Sim::inject(3, 0, last, sizeof(last));
+  CHECK(waitFor([&]{
+      frame.poll();
+      return frames.size() >= 2;
+  }, 100000));
+
+  CHECK_EQ(frames.size(), 2);
+  CHECK(frames[0] == std::vector<uint8_t>(first, first + sizeof(first)));
+  CHECK(frames[1] == std::vector<uint8_t>(last, last + sizeof(last)));
+  CHECK_EQ(frame.getDropped(), 1);
+  return 0;
+}
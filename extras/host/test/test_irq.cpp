@@ -0,0 +1,91 @@
+/*!
+ * @file test_irq.cpp
+ * @brief Interrupt mode on the IRQ output of the model: no bus traffic while idle, receive latency, and the
+ * @n transactions of a stream against polling mode
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+static uint8_t data[2048];
+
+/**
+ * @brief The other end sends data, a loop reads what has arrived every 100us
+ * @return Return the IIC transactions
+ */
+static uint32_t stream(DFRobot_IICSerialBase &uart){
+  WK2132Sim::send(3, 0, data, sizeof(data));
+  uart.resetStats();
+  uint8_t buf[64];
+  size_t n = 0;
+  uint64_t start = WK2132Sim::now();
+  while(n < sizeof(data)){
+      size_t k = uart.read(buf, sizeof(buf));
+      CHECK(memcmp(buf, data + n, k) == 0);
+      n += k;
+      CHECK(WK2132Sim::now() - start < 1000000);
+      WK2132Sim::advance(100);
+  }
+  CHECK_EQ(WK2132Sim::getCounters().rxOverruns, 0);
+  return uart.getStats().iicTransactions;
+}
+
+int main(){
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 13 + 1);
+  }
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<512, 64> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(115200), 0);
+  Wire.setClock(400000);
+  uint32_t polled = stream(uart);
+
+  CHECK_EQ(uart.attachInterruptPin(WK2132_SIM_IRQ_PIN), 0);
+  //The first call services the interrupt flag set by attachInterruptPin()
+  uart.available();
+
+  //Idle line: the IRQ output stays high, so nothing touches the bus
+  uart.resetStats();
+  uint32_t t0 = simTransactions();
+  for(int i = 0; i < 1000; i++){
+      CHECK_EQ(uart.available(), 0);
+      CHECK_EQ(uart.read(), -1);
+      uart.poll();
+  }
+  CHECK_EQ(simTransactions() - t0, 0);
+  CHECK_EQ(uart.getStats().iicTransactions, 0);
+
+  //One byte is below the receive trigger, the RX timeout interrupt reports it
+  WK2132Sim::send(3, 0, "x", 1);
+  CHECK(waitFor([]{ return !WK2132Sim::lineBusy(3, 0); }, 1000));
+  uint64_t arrived = WK2132Sim::now();
+  CHECK(waitFor([&]{ return uart.available() > 0; }, 5000));
+  uint64_t latency = WK2132Sim::now() - arrived;
+  printf("RX latency of 1 byte @115200: %lu us\n", (unsigned long)latency);
+  CHECK(latency < 1000);
+  CHECK_EQ(uart.read(), 'x');
+  CHECK(WK2132Sim::getCounters().irqEdges >= 1);
+
+  //The same stream, the interrupt comes every 8 bytes(FCR default trigger)
+  uint32_t irq = stream(uart);
+  printf("2KB @115200 read every 100us: %u transactions polled, %u with IRQ\n", polled, irq);
+  CHECK(irq < polled);
+
+  //Transmit: the TX trigger interrupt refills the FIFO from the 64 bytes ring
+  uart.setTxDeferred(true);
+  size_t sent = 0;
+  while(sent < sizeof(data)){
+      sent += uart.write(data + sent, sizeof(data) - sent);
+      uart.poll();
+      WK2132Sim::advance(100);
+  }
+  CHECK(waitFor([&]{ return uart.isTxComplete(); }, 300000));
+  std::vector<uint8_t> out = WK2132Sim::takeTx(3, 0);
+  CHECK_EQ(out.size(), sizeof(data));
+  CHECK(memcmp(out.data(), data, sizeof(data)) == 0);
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*!
+ * @file test_linux_transport.cpp
+ * @brief DFRobot_IICSerialLinuxTransport: the I2C_RDWR messages it builds are run against the model instead of a
+ * @n /dev/i2c-N adapter. A register read is one combined transfer, the FIFO is moved in blocks of up to 256 bytes,
+ * @n and a missing adapter fails every transaction.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerialLinux.h>
+#include "HostTest.h"
+
+/*The ioctl replaced by the model, one message after the other*/
+class SimLinuxTransport : public DFRobot_IICSerialLinuxTransport{
+public:
+  SimLinuxTransport():DFRobot_IICSerialLinuxTransport("/dev/null"){}
+  uint32_t transfers = 0;
+  uint32_t combined = 0;
+  size_t longest = 0;
+
+protected:
+  virtual int transfer(struct i2c_msg *pMsgs, uint32_t num){
+      transfers++;
+      if((num == 2) && !(pMsgs[0].flags & I2C_M_RD) && (pMsgs[1].flags & I2C_M_RD)){
+          combined++;
+      }
+      for(uint32_t i = 0; i < num; i++){
+          if(pMsgs[i].len > longest){
+              longest = pMsgs[i].len;
+          }
+          if(pMsgs[i].flags & I2C_M_RD){
+              if(WK2132Sim::i2cRead(pMsgs[i].addr, pMsgs[i].buf, pMsgs[i].len) != pMsgs[i].len){
+                  return -1;
+              }
+          }else if(WK2132Sim::i2cWrite(pMsgs[i].addr, pMsgs[i].buf, pMsgs[i].len) != 0){
+              return -1;
+          }
+      }
+      return (int)num;
+  }
+};
+
+int main(){
+  uint8_t data[600], buf[600];
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 11 + 1);
+  }
+  WK2132Sim::reset();
+  WK2132Sim::setBusClock(400000);
+  SimLinuxTransport bus;
+  DFRobot_IICSerialPort<1024, 1024> uart(bus, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(115200), 0);
+  CHECK(bus.isOpen());
+  CHECK(bus.combined > 0);
+  WK2132Sim::loopback(3, 0);
+
+  size_t sent = 0, got = 0;
+  CHECK(waitFor([&]{
+      //No more in flight than the receive FIFO holds
+      if(sent - got < 128){
+          size_t n = sizeof(data) - sent;
+          sent += uart.write(data + sent, (n > 128) ? 128 : n);
+      }
+      got += uart.read(buf + got, sizeof(buf) - got);
+      return got == sizeof(data);
+  }, 2000000));
+  CHECK(memcmp(buf, data, sizeof(data)) == 0);
+  printf("%u ioctls, %u combined register reads, longest message %u bytes\n", bus.transfers, bus.combined,
+         (uint32_t)bus.longest);
+  CHECK(bus.longest > 32);
+  CHECK(bus.longest <= 256);
+
+  //pollAsync() moves the data through submit() on the same transport
+  WK2132Sim::inject(3, 0, data, 256);
+  for(uint8_t i = 0; i < 10; i++){
+      uart.pollAsync();
+  }
+  CHECK_EQ(WK2132Sim::rxCount(3, 0), 0);
+  CHECK_EQ(uart.read(buf, sizeof(buf)), 256);
+  CHECK(memcmp(buf, data, 256) == 0);
+
+  //No adapter: begin() of the port fails
+  DFRobot_IICSerialLinuxTransport missing("/nonexistent/i2c-9");
+  DFRobot_IICSerialPort<64> none(missing, SUBUART_CHANNEL_1, 0, 0);
+  CHECK(none.begin(115200) != 0);
+  CHECK(!missing.isOpen());
+  CHECK(missing.write(0x10, data, 1) != 0);
+  CHECK_EQ(missing.read(0x10, buf, 1), 0);
+  return 0;
+}
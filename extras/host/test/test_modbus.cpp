@@ -0,0 +1,66 @@
+/*!
+ * @file test_modbus.cpp
+ * @brief DFRobot_IICSerialModbus against a slave on the model: a valid answer, a wrong CRC, no answer, and a
+ * @n request the sub UART can not take because its transmit buffer stays full
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include "HostTest.h"
+#include "ModbusSlave.h"
+
+static DFRobot_IICSerialModbus::eModbusResult_t waitResult(DFRobot_IICSerialModbus &master, ModbusSlave &slave){
+  CHECK(waitFor([&]{
+      slave.poll();
+      return master.poll() != DFRobot_IICSerialModbus::eModbusBusy;
+  }, 2000000));
+  return master.getResult();
+}
+
+int main(){
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<256, 16> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(115200), 0);
+  Wire.setClock(400000);
+  DFRobot_IICSerialModbus master(uart);
+  master.setTimeout(50);
+  ModbusSlave slave(3, 0, 1);
+  CHECK_EQ(master.getResult(), DFRobot_IICSerialModbus::eModbusIdle);
+
+  CHECK_EQ(master.readHoldingRegisters(1, 0x10, 4), 0);
+  CHECK_EQ(master.getResult(), DFRobot_IICSerialModbus::eModbusBusy);
+  CHECK_EQ(master.readHoldingRegisters(1, 0x10, 4), -1);
+  CHECK_EQ(waitResult(master, slave), DFRobot_IICSerialModbus::eModbusOK);
+  for(uint8_t i = 0; i < 4; i++){
+      CHECK_EQ(master.getRegister(i), 0x10 + i);
+  }
+
+  slave.badCrc = true;
+  CHECK_EQ(master.readHoldingRegisters(1, 0, 2), 0);
+  CHECK_EQ(waitResult(master, slave), DFRobot_IICSerialModbus::eModbusCRCError);
+  slave.badCrc = false;
+
+  slave.silent = true;
+  CHECK_EQ(master.readHoldingRegisters(1, 0, 2), 0);
+  CHECK_EQ(waitResult(master, slave), DFRobot_IICSerialModbus::eModbusTimeout);
+  slave.silent = false;
+
+  //A stopped transmitter: the FIFO and the transmit buffer fill up, the request does not fit any more
+  uint8_t junk[256 + 15];
+  memset(junk, 0, sizeof(junk));
+  WK2132Sim::holdTx(3, 0, true);
+  CHECK_EQ(uart.write(junk, sizeof(junk)), sizeof(junk));
+  CHECK_EQ(master.readHoldingRegisters(1, 0, 2), -1);
+  CHECK_EQ(master.getResult(), DFRobot_IICSerialModbus::eModbusIdle);
+  CHECK_EQ(master.poll(), DFRobot_IICSerialModbus::eModbusIdle);
+
+  //Once the line moves again the next request goes through
+  WK2132Sim::holdTx(3, 0, false);
+  uart.flush();
+  slave.clear();
+  CHECK_EQ(master.readHoldingRegisters(1, 0x20, 1), 0);
+  CHECK_EQ(waitResult(master, slave), DFRobot_IICSerialModbus::eModbusOK);
+  CHECK_EQ(master.getRegister(0), 0x20);
+  return 0;
+}
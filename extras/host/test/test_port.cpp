@@ -0,0 +1,58 @@
+/*!
+ * @file test_port.cpp
+ * @brief Drives two sub UARTs of one module through the library, and checks that DFROBOT_IICSERIAL_STATS counts
+ * @n the same IIC transactions as the model sees
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include <string.h>
+#include <string>
+#include "HostTest.h"
+
+int main(){
+  WK2132Sim::reset();
+  DFRobot_IICSerial uart1(Wire, SUBUART_CHANNEL_1, 1, 1);
+  DFRobot_IICSerial uart2(Wire, SUBUART_CHANNEL_2, 1, 1);
+  CHECK_EQ(uart1.begin(115200), 0);
+  CHECK_EQ(uart2.begin(9600, IICSerial_8E1), 0);
+  CHECK(uart1.getChip() == uart2.getChip());
+  CHECK_EQ(WK2132Sim::reg(3, 0, 1, 0x05), 7);
+  CHECK_EQ(WK2132Sim::reg(3, 1, 1, 0x05), 95);
+  CHECK_EQ(WK2132Sim::reg(3, 1, 0, 0x05) & 0x0F, IICSerial_8E1);
+
+  uart1.resetStats();
+  uart2.resetStats();
+  uint32_t t0 = simTransactions();
+  WK2132Sim::loopback(3, 0);
+  const char *msg = "The quick brown fox jumps over the lazy dog";
+  size_t len = strlen(msg);
+  CHECK_EQ(uart1.write((const uint8_t *)msg, len), len);
+  char buf[64] = {0};
+  size_t n = 0;
+  CHECK(waitFor([&]{ n += uart1.read(buf + n, sizeof(buf) - 1 - n); return n >= len; }, 100000));
+  CHECK(strcmp(buf, msg) == 0);
+  DFRobot_IICSerialBase::sStats_t stats = uart1.getStats();
+  CHECK_EQ(stats.txBytes, len);
+  CHECK_EQ(stats.rxBytes, len);
+  CHECK_EQ(stats.iicErrors, 0);
+  CHECK_EQ(stats.iicTransactions, simTransactions() - t0);
+
+  //The other sub UART sends to nowhere, the bytes leave its TX pin
+  t0 = simTransactions();
+  uart2.print("abc");
+  uart2.flush();
+  std::vector<uint8_t> tx = WK2132Sim::takeTx(3, 1);
+  CHECK(std::string(tx.begin(), tx.end()) == "abc");
+  CHECK_EQ(uart2.getStats().iicTransactions, simTransactions() - t0);
+  CHECK_EQ(uart2.read(), -1);
+
+  //A missing module is reported
+  WK2132Sim::setPresent(0, false);
+  DFRobot_IICSerial absent(Wire, SUBUART_CHANNEL_1, 0, 0);
+  CHECK(absent.begin(9600) != 0);
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,57 @@
+/*!
+ * @file test_reconfigure.cpp
+ * @brief setBaud() of a sub UART with data still to send: the data leaves with the old band rate, and the bus lock
+ * @n is not held while flush() waits, so the other sub UART and other tasks are not held up
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include "HostTest.h"
+#include "MutexTransport.h"
+
+#define SIM_PAGE1_BAUD1  0x04
+#define SIM_PAGE1_BAUD0  0x05
+#define SIM_PAGE1_PRES   0x06
+
+static uint32_t baudRegs(){
+  return ((uint32_t)WK2132Sim::reg(3, 0, 1, SIM_PAGE1_BAUD1) << 16) | (WK2132Sim::reg(3, 0, 1, SIM_PAGE1_BAUD0) << 8) |
+         WK2132Sim::reg(3, 0, 1, SIM_PAGE1_PRES);
+}
+
+int main(){
+  uint8_t data[200];
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 3 + 1);
+  }
+  WK2132Sim::reset();
+  MutexTransport bus;
+  DFRobot_IICSerialPort<256> uart(bus, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(9600), 0);
+  Wire.setClock(400000);
+  uint32_t regs9600 = baudRegs();
+
+  //About 210ms on the line at 9600
+  CHECK_EQ(uart.write(data, sizeof(data)), sizeof(data));
+  bus.resetMaxHeld();
+  uint64_t start = WK2132Sim::now();
+  CHECK_EQ(uart.setBaud(19200), 0);
+  uint64_t elapsed = WK2132Sim::now() - start;
+  printf("setBaud(): %llu us, bus lock held for at most %llu us\n", (unsigned long long)elapsed,
+         (unsigned long long)bus.getMaxHeld());
+  CHECK(elapsed >= sizeof(data) * 1000);
+  CHECK(bus.getMaxHeld() < 2000);
+
+  //All the data left with the old band rate before the registers were switched
+  CHECK_EQ(WK2132Sim::takeTx(3, 0).size(), sizeof(data));
+  CHECK_EQ(uart.getCharTime(), 521);
+  CHECK(baudRegs() != regs9600);
+  CHECK_EQ(uart.setBaud(9600), 0);
+  CHECK_EQ(baudRegs(), regs9600);
+
+  //Nothing to send and nothing changed: no flush, no register write
+  uint32_t trans = simTransactions();
+  CHECK_EQ(uart.setBaud(9600), 0);
+  CHECK(simTransactions() - trans <= 2);
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*!
+ * @file test_rs485_gap.cpp
+ * @brief RS-485 mode: write() right after a frame waits for the inter-frame gap before DE is driven again, but
+ * @n without the bus lock, so the other sub UART and other tasks are not held up meanwhile
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include "HostTest.h"
+#include "MutexTransport.h"
+
+#define DE_PIN  5
+
+int main(){
+  const uint8_t frame[8] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02, 0xC4, 0x0B};
+  WK2132Sim::reset();
+  MutexTransport bus;
+  DFRobot_IICSerialPort<64> uart(bus, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(9600), 0);
+  Wire.setClock(400000);
+  uart.enableRS485(DE_PIN);
+  CHECK_EQ(digitalRead(DE_PIN), LOW);
+
+  CHECK_EQ(uart.write(frame, sizeof(frame)), sizeof(frame));
+  CHECK_EQ(digitalRead(DE_PIN), HIGH);
+  uart.flush();
+  CHECK_EQ(digitalRead(DE_PIN), LOW);
+  CHECK_EQ(WK2132Sim::takeTx(3, 0).size(), sizeof(frame));
+
+  //The next frame right away: write() waits for 3.5 character times of idle line
+  uint32_t gap = uart.getInterFrameGap();
+  bus.resetMaxHeld();
+  uint64_t start = WK2132Sim::now();
+  CHECK_EQ(uart.write(frame, sizeof(frame)), sizeof(frame));
+  uint64_t elapsed = WK2132Sim::now() - start;
+  printf("gap %u us, write() %llu us, bus lock held for at most %llu us\n", gap, (unsigned long long)elapsed,
+         (unsigned long long)bus.getMaxHeld());
+  CHECK_EQ(digitalRead(DE_PIN), HIGH);
+  CHECK(elapsed + 100 >= gap);
+  CHECK(bus.getMaxHeld() < gap / 4);
+  uart.flush();
+  CHECK_EQ(WK2132Sim::takeTx(3, 0).size(), sizeof(frame));
+  return 0;
+}
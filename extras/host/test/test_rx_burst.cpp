@@ -0,0 +1,99 @@
+/*!
+ * @file test_rx_burst.cpp
+ * @brief Receive FIFO drained in bursts through the FIFO object: payload bytes per IIC transaction, counted by
+ * @n DFROBOT_IICSERIAL_STATS, against the per-byte RFCNT + FDAT reads of the driver before
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include "HostTest.h"
+
+#define ADDR_REG  (0x10 | (1 << 6) | (1 << 5))
+
+static uint8_t data[4096];
+
+/**
+ * @brief available() read RFCNT, then read() read FDAT, for every byte
+ */
+static uint32_t perByteTransactions(size_t size){
+  WK2132Sim::inject(3, 0, data, size);
+  uint32_t t0 = simTransactions();
+  for(size_t i = 0; i < size; i++){
+      uint8_t regs[2] = {0x0A, 0x0D};
+      for(uint8_t r = 0; r < 2; r++){
+          Wire.beginTransmission(ADDR_REG);
+          Wire.write(regs[r]);
+          Wire.endTransmission();
+          Wire.requestFrom(ADDR_REG, 1);
+          CHECK(Wire.read() >= 0);
+      }
+  }
+  return simTransactions() - t0;
+}
+
+int main(){
+  for(size_t i = 0; i < sizeof(data); i++){
+      data[i] = (uint8_t)(i * 7);
+  }
+  WK2132Sim::reset();
+  DFRobot_IICSerialPort<1024> uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(921600), 0);
+
+  uint32_t base = perByteTransactions(256);
+  printf("per byte FDAT: 256 bytes, %u transactions, %.2f bytes/transaction\n", base, 256.0 / base);
+
+  //A full FIFO reads RFCNT = 0, FSR tells it from an empty one and a second RFCNT from a byte that just arrived,
+  //then 8 bursts of 32 bytes
+  WK2132Sim::inject(3, 0, data, 256);
+  uart.resetStats();
+  uint8_t buf[256];
+  CHECK_EQ(uart.read(buf, sizeof(buf)), 256);
+  CHECK(memcmp(buf, data, 256) == 0);
+  DFRobot_IICSerialBase::sStats_t stats = uart.getStats();
+  printf("read(pBuf, 256): %u transactions, %.2f bytes/transaction\n", stats.iicTransactions, 256.0 / stats.iicTransactions);
+  CHECK(stats.iicTransactions <= 14);
+
+  //read() one byte at a time refills the ring in bursts as well
+  WK2132Sim::inject(3, 0, data, 256);
+  uart.resetStats();
+  for(int i = 0; i < 256; i++){
+      CHECK_EQ(uart.read(), data[i]);
+  }
+  stats = uart.getStats();
+  printf("read() x 256: %u transactions, %.2f bytes/transaction\n", stats.iicTransactions, 256.0 / stats.iicTransactions);
+  CHECK(256.0 / stats.iicTransactions >= 18);
+  CHECK(stats.iicTransactions * 50 < base);
+
+  //Streaming: the other end sends 4KB at 115200 band, a loop on a 400kHz bus takes what has arrived every 2ms
+  CHECK_EQ(uart.begin(115200), 0);
+  Wire.setClock(400000);
+  for(uint8_t bulk = 0; bulk < 2; bulk++){
+      WK2132Sim::send(3, 0, data, sizeof(data));
+      uart.resetStats();
+      uint64_t start = WK2132Sim::now();
+      size_t n = 0;
+      while(n < sizeof(data)){
+          if(bulk){
+              size_t k = uart.read(buf, sizeof(buf));
+              CHECK(memcmp(buf, data + n, k) == 0);
+              n += k;
+          }else{
+              for(int k = uart.available(); k > 0; k--){
+                  CHECK_EQ(uart.read(), data[n]);
+                  n++;
+              }
+          }
+          CHECK(WK2132Sim::now() - start < 1000000);
+          WK2132Sim::advance(2000);
+      }
+      stats = uart.getStats();
+      printf("stream 4KB @115200 %s: %u transactions, %.2f bytes/transaction, %u overruns\n", bulk ? "read(pBuf, size)" : "available()/read()",
+             stats.iicTransactions, (double)sizeof(data) / stats.iicTransactions, WK2132Sim::getCounters().rxOverruns);
+      CHECK((double)sizeof(data) / stats.iicTransactions > 4);
+      CHECK_EQ(WK2132Sim::getCounters().rxOverruns, 0);
+  }
+  printf("ok\n");
+  return 0;
+}
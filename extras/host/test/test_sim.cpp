@@ -0,0 +1,154 @@
+/*!
+ * @file test_sim.cpp
+ * @brief Checks the WK2132 model through the mock TwoWire alone, the other tests rely on it
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostTest.h"
+
+#define CHIP      3                                //< IA1 = 1, IA0 = 1
+#define ADDR_REG  (0x10 | (1 << 6) | (1 << 5))     //< Sub UART1 register object
+#define ADDR_FIFO (ADDR_REG | 0x01)                //< Sub UART1 FIFO object
+
+static void writeReg(uint8_t reg, uint8_t val){
+  Wire.beginTransmission(ADDR_REG);
+  Wire.write(reg);
+  Wire.write(val);
+  CHECK_EQ(Wire.endTransmission(), 0);
+}
+
+static uint8_t readReg(uint8_t reg){
+  Wire.beginTransmission(ADDR_REG);
+  Wire.write(reg);
+  CHECK_EQ(Wire.endTransmission(), 0);
+  CHECK_EQ(Wire.requestFrom(ADDR_REG, 1), 1);
+  return Wire.read();
+}
+
+static int irqCalls = 0;
+static void onIrq(){
+  irqCalls++;
+}
+
+int main(){
+  WK2132Sim::reset();
+  Wire.begin();
+  //GENA clock, SCR rxEn/txEn, page 1 left at BAUD = 0: 921600
+  writeReg(0x00, 0x01);
+  writeReg(0x04, 0x03);
+  CHECK_EQ(readReg(0x00) & 0x81, 0x81);
+
+  //Empty and full FIFOs both read a count of 0, FSR tells them apart
+  CHECK_EQ(readReg(0x0A), 0);
+  CHECK_EQ(readReg(0x0B) & 0x08, 0);
+  uint8_t data[256];
+  for(int i = 0; i < 256; i++){
+      data[i] = (uint8_t)i;
+  }
+  WK2132Sim::inject(CHIP, 0, data, 256);
+  CHECK_EQ(readReg(0x0A), 0);
+  CHECK_EQ(readReg(0x0B) & 0x08, 0x08);
+  WK2132Sim::inject(CHIP, 0, data, 1);
+  CHECK_EQ(WK2132Sim::getCounters().rxOverruns, 1);
+
+  //The FIFO object reads the data in order, 32 bytes at most per transaction like the AVR Wire buffer
+  CHECK_EQ(Wire.requestFrom(ADDR_FIFO, 40), 32);
+  for(int i = 0; i < 32; i++){
+      CHECK_EQ(Wire.read(), i);
+  }
+  CHECK_EQ(readReg(0x0A), 224);
+  CHECK_EQ(readReg(0x0D), 32);
+  writeReg(0x06, 0x01);
+  CHECK_EQ(readReg(0x0A), 0);
+  CHECK_EQ(Wire.requestFrom(ADDR_FIFO, 1), 1);
+  CHECK_EQ(Wire.read(), 0);
+
+  //Transmit FIFO full: TFCNT 0, TFULL set
+  WK2132Sim::holdTx(CHIP, 0, true);
+  for(int i = 0; i < 8; i++){
+      Wire.beginTransmission(ADDR_FIFO);
+      CHECK_EQ(Wire.write(data + i * 32, 32), 32);
+      CHECK_EQ(Wire.endTransmission(), 0);
+  }
+  CHECK_EQ(readReg(0x09), 0);
+  CHECK_EQ(readReg(0x0B) & 0x06, 0x06);
+  CHECK_EQ(WK2132Sim::txCount(CHIP, 0), 256);
+
+  //The transmitter moves one byte per character time: 10 bits at 9600 band, divisor 95.0
+  WK2132Sim::holdTx(CHIP, 0, false);
+  writeReg(0x03, 0x01);
+  writeReg(0x04, 0x00);
+  writeReg(0x05, 95);
+  writeReg(0x06, 0);
+  writeReg(0x03, 0x00);
+  WK2132Sim::takeTx(CHIP, 0);
+  size_t before = WK2132Sim::txCount(CHIP, 0);
+  WK2132Sim::advance(10 * 1042);
+  size_t sent = before - WK2132Sim::txCount(CHIP, 0);
+  CHECK(sent >= 9 && sent <= 11);
+  size_t out = WK2132Sim::takeTx(CHIP, 0).size();
+  CHECK(out + 1 >= sent && out <= sent + 1);
+  CHECK(readReg(0x0B) & 0x01);
+  writeReg(0x06, 0x02);
+  CHECK(waitFor([]{ return (readReg(0x0B) & 0x05) == 0; }, 2000));
+
+  //Loopback at the same band rate
+  WK2132Sim::loopback(CHIP, 0);
+  Wire.beginTransmission(ADDR_FIFO);
+  Wire.write((const uint8_t *)"hello", 5);
+  CHECK_EQ(Wire.endTransmission(), 0);
+  CHECK(waitFor([]{ return WK2132Sim::rxCount(CHIP, 0) == 5; }, 6 * 1042));
+
+  //Receive trigger of 4 bytes through RFTL, the IRQ output follows SIER and GIER
+  writeReg(0x06, 0x01);
+  writeReg(0x03, 0x01);
+  writeReg(0x07, 4);
+  writeReg(0x03, 0x00);
+  writeReg(0x07, 0x01);
+  pinMode(WK2132_SIM_IRQ_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(WK2132_SIM_IRQ_PIN), onIrq, FALLING);
+  WK2132Sim::inject(CHIP, 0, data, 3);
+  CHECK_EQ(digitalRead(WK2132_SIM_IRQ_PIN), HIGH);
+  writeReg(0x10, 0x01);
+  WK2132Sim::inject(CHIP, 0, data, 1);
+  CHECK_EQ(digitalRead(WK2132_SIM_IRQ_PIN), LOW);
+  CHECK_EQ(irqCalls, 1);
+  CHECK_EQ(readReg(0x11), 0x01);
+  CHECK_EQ(readReg(0x08), 0x01);
+  CHECK_EQ(Wire.requestFrom(ADDR_FIFO, 4), 4);
+  CHECK_EQ(digitalRead(WK2132_SIM_IRQ_PIN), HIGH);
+
+  //Line errors show in LSR per byte and in FSR for the whole FIFO
+  WK2132Sim::inject(CHIP, 0, "ab", 2);
+  WK2132Sim::inject(CHIP, 0, "c", 1, 0x02);
+  CHECK_EQ(readReg(0x0B) & 0x10, 0x10);
+  CHECK_EQ(readReg(0x0C), 0);
+  readReg(0x0D);
+  readReg(0x0D);
+  CHECK_EQ(readReg(0x0C), 0x02);
+
+  //Absent modules and injected failures are not acknowledged
+  WK2132Sim::setPresent(CHIP, false);
+  Wire.beginTransmission(ADDR_REG);
+  CHECK_EQ(Wire.endTransmission(), 2);
+  WK2132Sim::setPresent(CHIP, true);
+  WK2132Sim::failNext(1);
+  Wire.beginTransmission(ADDR_REG);
+  CHECK_EQ(Wire.endTransmission(), 2);
+  Wire.beginTransmission(ADDR_REG);
+  CHECK_EQ(Wire.endTransmission(), 0);
+  CHECK_EQ(WK2132Sim::getCounters().nacks, 2);
+
+  //A 1 byte transaction at 100kHz: start, 2 bytes with ACK, stop
+  uint64_t busNs = WK2132Sim::getCounters().busNs;
+  Wire.beginTransmission(ADDR_REG);
+  Wire.write(0x0A);
+  Wire.endTransmission();
+  CHECK_EQ(WK2132Sim::getCounters().busNs - busNs, 200000);
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*!
+ * @file test_thread_stress.cpp
+ * @brief DFROBOT_IICSERIAL_THREAD_SAFE: both sub UARTs of module 3 in loopback, each with a writer and a reader
+ * @n thread, while another thread runs DFRobot_IICSerialChip::pollAll(). Once in polling mode and once in interrupt
+ * @n mode, every byte has to arrive once and in order. Configure with -DIICSERIAL_TSAN=ON to run it under
+ * @n ThreadSanitizer.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <atomic>
+#include <thread>
+#include "HostTest.h"
+#include "MutexTransport.h"
+
+#define STREAM     20000
+#define IN_FLIGHT  200     //Bytes written but not read yet, below the 256 bytes of the receive FIFO
+
+typedef struct{
+  DFRobot_IICSerialBase *pPort;
+  uint8_t seed;
+  bool bulk;             //read(pBuf, size) and write(pBuf, size), otherwise one byte at a time
+  std::atomic<uint32_t> received;
+  std::atomic<uint32_t> errors;
+} sStream_t;
+
+static uint8_t pattern(const sStream_t &s, uint32_t i){
+  return (uint8_t)(i * s.seed + (i >> 8));
+}
+
+static void writer(sStream_t *pStream){
+  uint8_t buf[37];
+  uint32_t sent = 0;
+  while(sent < STREAM){
+      uint32_t inFlight = sent - pStream->received.load();
+      if(inFlight >= IN_FLIGHT){
+          std::this_thread::yield();
+          continue;
+      }
+      size_t n = pStream->bulk ? (1 + sent % sizeof(buf)) : 1;
+      if(n > IN_FLIGHT - inFlight){
+          n = IN_FLIGHT - inFlight;
+      }
+      if(n > STREAM - sent){
+          n = STREAM - sent;
+      }
+      for(size_t i = 0; i < n; i++){
+          buf[i] = pattern(*pStream, sent + i);
+      }
+      sent += (n == 1) ? pStream->pPort->write(buf[0]) : pStream->pPort->write(buf, n);
+  }
+}
+
+static void reader(sStream_t *pStream){
+  uint8_t buf[64];
+  uint32_t i = 0;
+  while(i < STREAM){
+      size_t n = 0;
+      if(pStream->bulk){
+          n = pStream->pPort->read(buf, sizeof(buf));
+      }else{
+          int c = pStream->pPort->read();
+          if(c >= 0){
+              buf[0] = (uint8_t)c;
+              n = 1;
+          }
+      }
+      for(size_t k = 0; k < n; k++){
+          if(buf[k] != pattern(*pStream, i + k)){
+              pStream->errors++;
+          }
+      }
+      i += n;
+      pStream->received.store(i);
+  }
+}
+
+/**
+ * @brief Run both streams with the service thread, a clock thread lets time pass while no thread is on the bus
+ */
+static void run(const char *mode, DFRobot_IICSerialBase &a, DFRobot_IICSerialBase &b){
+  sStream_t streams[2];
+  streams[0].pPort = &a;
+  streams[0].seed = 7;
+  streams[0].bulk = false;
+  streams[1].pPort = &b;
+  streams[1].seed = 13;
+  streams[1].bulk = true;
+  for(int i = 0; i < 2; i++){
+      streams[i].received = 0;
+      streams[i].errors = 0;
+  }
+  uint32_t overruns = WK2132Sim::getCounters().rxOverruns;
+  std::atomic<bool> done(false);
+  std::thread service([&]{
+      while(!done){
+          DFRobot_IICSerialChip::pollAll();
+      }
+  });
+  std::thread clock([&]{
+      while(!done){
+          WK2132Sim::advance(10);
+          std::this_thread::yield();
+      }
+  });
+  std::thread threads[4] = {std::thread(writer, &streams[0]), std::thread(reader, &streams[0]),
+                            std::thread(writer, &streams[1]), std::thread(reader, &streams[1])};
+  for(int i = 0; i < 4; i++){
+      threads[i].join();
+  }
+  done = true;
+  service.join();
+  clock.join();
+  for(int i = 0; i < 2; i++){
+      printf("%s %s: %u bytes, %u errors\n", mode, streams[i].bulk ? "bulk" : "byte", streams[i].received.load(),
+             streams[i].errors.load());
+      CHECK_EQ(streams[i].received.load(), STREAM);
+      CHECK_EQ(streams[i].errors.load(), 0);
+  }
+  CHECK_EQ(WK2132Sim::getCounters().rxOverruns, overruns);
+}
+
+int main(){
+  WK2132Sim::reset();
+  MutexTransport bus;
+  DFRobot_IICSerialPort<128> a(bus, SUBUART_CHANNEL_1, 1, 1);
+  DFRobot_IICSerialPort<128> b(bus, SUBUART_CHANNEL_2, 1, 1);
+  CHECK_EQ(a.begin(115200), 0);
+  CHECK_EQ(b.begin(115200), 0);
+  Wire.setClock(400000);
+  WK2132Sim::loopback(3, 0);
+  WK2132Sim::loopback(3, 1);
+
+  run("polling", a, b);
+  CHECK_EQ(a.attachInterruptPin(WK2132_SIM_IRQ_PIN), 0);
+  run("interrupt", a, b);
+  return 0;
+}
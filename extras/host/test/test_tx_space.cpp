@@ -0,0 +1,50 @@
+/*!
+ * @file test_tx_space.cpp
+ * @brief Free space of the transmit FIFO: TFCNT reads 0 for a full FIFO, and a character that leaves before FSR
+ * @n is read clears TFULL. write() must not take that for an empty FIFO and overrun the transmit FIFO.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerial.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "HostTest.h"
+
+static uint8_t data[300];
+
+/**
+ * @brief Write random sized blocks, then check that every byte write() accepted left the TX pin once and in order
+ */
+static void run(uint32_t busHz, uint32_t baud, size_t blocks, bool randomSize){
+  WK2132Sim::reset();
+  DFRobot_IICSerial uart(Wire, SUBUART_CHANNEL_1, 1, 1);
+  CHECK_EQ(uart.begin(baud), 0);
+  Wire.setClock(busHz);
+  std::vector<uint8_t> sent;
+  for(size_t i = 0; i < blocks; i++){
+      size_t size = randomSize ? (size_t)(rand() % sizeof(data)) + 1 : sizeof(data);
+      for(size_t j = 0; j < size; j++){
+          data[j] = (uint8_t)(sent.size() + j);
+      }
+      size_t n = uart.write(data, size);
+      sent.insert(sent.end(), data, data + n);
+  }
+  uart.flush();
+  std::vector<uint8_t> line = WK2132Sim::takeTx(3, 0);
+  printf("%u Hz, %u baud: %u bytes accepted, %u sent, %u transmit FIFO overruns\n", busHz, baud,
+         (uint32_t)sent.size(), (uint32_t)line.size(), WK2132Sim::getCounters().txOverruns);
+  CHECK_EQ(WK2132Sim::getCounters().txOverruns, 0);
+  CHECK(line == sent);
+}
+
+int main(){
+  srand(1);
+  //Two blocks larger than the FIFO: the second one starts while the FIFO is full
+  run(400000, 9600, 2, false);
+  run(1000000, 115200, 500, true);
+  run(400000, 115200, 500, true);
+  return 0;
+}
@@ -2,29 +2,103 @@ from __future__ import print_function
 
 '''!
  @file DFRobot_IIC_Serial.py
- @brief Define the basic structure of class DFRobot_IIC_Serial 
+ @brief Define the basic structure of class DFRobot_IIC_Serial
  @n This is a library for IIC to UART module, the maximum rate is 1Mbps
  @n The band rate, word length, and check format of every sub UART can be set independently
  @n The module can provide at most 2Mbps communication rate
  @n Each sub UART is able to receive/transmit independent 256 bytes FIFO hardware cache
  @n Users can configure FIFO interrupt by programming.
- 
+ @n Data is moved in FIFO address block transfers, and every register access is one I2C_RDWR combined transfer
+ @n on /dev/i2c-N, see DFRobot_IIC_Serial_Bus.
+
  @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
  @license     The MIT License (MIT)
  @author [Arya](xue.peng@dfrobot.com)
- @version  V1.0
+ @version  V1.1
  @date  2021-05-07
  @https://github.com/DFRobot/DFRobot_IIC_Serial
 '''
 import sys
+import os
 import time
-import smbus
-import RPi.GPIO as GPIO
+import fcntl
+import ctypes
+
+from serial.serialutil import to_bytes
+
+## ioctl request of the Linux i2c-dev driver to run several messages as one combined transfer
+I2C_RDWR = 0x0707
+## Flag of a read message
+I2C_M_RD = 0x0001
+
+class i2c_msg(ctypes.Structure):
+  _fields_ = [('addr', ctypes.c_uint16), ('flags', ctypes.c_uint16), ('len', ctypes.c_uint16), ('buf', ctypes.POINTER(ctypes.c_uint8))]
+
+class i2c_rdwr_ioctl_data(ctypes.Structure):
+  _fields_ = [('msgs', ctypes.POINTER(i2c_msg)), ('nmsgs', ctypes.c_uint32)]
+
+def _monotonic():
+  return time.monotonic() if hasattr(time, 'monotonic') else time.time()
+
+class DFRobot_IIC_Serial_Bus(object):
+  '''!
+    @brief Linux IIC bus /dev/i2c-N. Every transfer() is one I2C_RDWR ioctl, the messages are joined by repeated
+    @n starts, so reading a register, or several registers of several modules, costs one system call.
+    @n Any object with the same transfer() method and transactions counter can be passed to DFRobot_IIC_Serial
+    @n instead, e.g. a simulated bus.
+  '''
+  _buses = {}
+
+  def __init__(self, bus = 1):
+    '''!
+      @brief Constructor
+      @param bus IIC bus number, 1 for /dev/i2c-1
+    '''
+    self._fd = os.open('/dev/i2c-%d' % bus, os.O_RDWR)
+    ## Number of transfer() calls, i.e. IIC transactions including their repeated starts
+    self.transactions = 0
+
+  @classmethod
+  def get(cls, bus = 1):
+    '''!
+      @brief Get the shared object of a bus, every sub UART on the bus uses the same file descriptor
+      @param bus IIC bus number
+      @return Return the bus object
+    '''
+    if bus not in cls._buses:
+      cls._buses[bus] = cls(bus)
+    return cls._buses[bus]
 
-from serial.serialutil import SerialBase, SerialException, to_bytes, \
-    portNotOpenError, writeTimeoutError, Timeout
+  def transfer(self, msgs):
+    '''!
+      @brief Run the messages as one combined transfer
+      @param msgs list of (addr, data) to write data, or (addr, size) to read size bytes, addr is the 7 bits address
+      @return Return a list with one bytearray per read message
+      @exception IOError the device did not acknowledge
+    '''
+    n = len(msgs)
+    msg = (i2c_msg * n)()
+    bufs = []
+    reads = []
+    for i in range(n):
+      addr, data = msgs[i]
+      if hasattr(data, '__len__'):
+        data = bytearray(data)
+        buf = (ctypes.c_uint8 * len(data)).from_buffer(data)
+        msg[i].flags = 0
+      else:
+        buf = (ctypes.c_uint8 * data)()
+        msg[i].flags = I2C_M_RD
+        reads.append(buf)
+      bufs.append(buf)
+      msg[i].addr = addr
+      msg[i].len = len(buf)
+      msg[i].buf = ctypes.cast(buf, ctypes.POINTER(ctypes.c_uint8))
+    fcntl.ioctl(self._fd, I2C_RDWR, i2c_rdwr_ioctl_data(msg, n))
+    self.transactions += 1
+    return [bytearray(buf) for buf in reads]
 
-class DFRobot_IIC_Serial:
+class DFRobot_IIC_Serial(object):
   ## Global control register, control sub UART clock 
   REG_WK2132_GENA = 0x00  
   ## Global sub UART reset register, reset a sub UART independently through software
@@ -76,7 +150,10 @@ class DFRobot_IIC_Serial:
   ## The 4th and 3rd bits of IIC address are fixed, value 1 and 0 respectively   
   DFROBOT_IICSERIAL_IIC_ADDR_FIXED      = 0x10   
   
-  SERIAL_RX_BUFFER_SIZE = 32
+  ## Size of the receive and transmit FIFO of every sub UART
+  FIFO_SIZE = 256
+  ## Size of the software receive buffer, the receive FIFO is moved into it in one block
+  SERIAL_RX_BUFFER_SIZE = 256
   DFROBOT_IICSERIAL_IIC_BUFFER_SIZE = 64
   
   DFROBOT_IICSERIAL_ERR_OK           =    0
@@ -106,7 +183,6 @@ class DFRobot_IIC_Serial:
   eNormalMode = 0
   eNormal = 0
   
-  _rx_buffer = [0]*SERIAL_RX_BUFFER_SIZE
   '''
     # LCR description of WK2132 sub UART configuration register:
     # -------------------------------------------------------------------------
@@ -154,35 +230,42 @@ class DFRobot_IIC_Serial:
   ## last operate status, users can use this variable to determine the result of a function call.
   last_operate_status = STA_OK
   
-  def __init__(self, sub_uart_channel, IA1 = 1, IA0 =1):
+  def __init__(self, sub_uart_channel, IA1 = 1, IA0 =1, bus = 1):
     '''!
       @brief Constructor
       @param sub_uart_channel sub UART channel, WK2132 has two sub UARTs: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
-      @param IA1:  corresponds with IA1 Level(0 or 1) of DIP switch on the module, and is used for configuring 
+      @param IA1:  corresponds with IA1 Level(0 or 1) of DIP switch on the module, and is used for configuring
       @n the IIC address of the 6th bit value(default: 1).
       @param  IA0:  corresponds with IA0 Level(0 or 1) of DIP switch on the module, and is used for configuring
       @n IIC address of the 5th bit value(default: 1).
-      @n IIC address configuration: 
+      @n IIC address configuration:
       @n 7   6   5   4   3   2   1   0
       @n 0  IA1 IA0  1   0  C1  C0  0/1
-      @n IIC address only has 7 bits, while there are 8 bits for one byte, so the extra one bit will be filled as 0. 
+      @n IIC address only has 7 bits, while there are 8 bits for one byte, so the extra one bit will be filled as 0.
       @n The 6th bit corresponds with IA1 Level of DIP switch, can be configured manually.
-      @n The 5th bit corresponds with IA0 Level of DIP switch, can be configured manually. 
+      @n The 5th bit corresponds with IA0 Level of DIP switch, can be configured manually.
       @n The 4th and 3rd bits are fixed, value 1 and 0 respectively.
-      @n The values of the 2nd and 1st bits are the sub UART channels, 00 for sub UART 1, 01 for sub UART 2. 
+      @n The values of the 2nd and 1st bits are the sub UART channels, 00 for sub UART 1, 01 for sub UART 2.
       @n The 0 bit represents the operation object: 0 for register, 1 for FIFO cache.
+      @param bus: IIC bus number(default: 1 for /dev/i2c-1), or a bus object with a transfer() method, see
+      @n DFRobot_IIC_Serial_Bus
     '''
     self._addr = (IA1 << 6) | (IA0 << 5) | self.DFROBOT_IICSERIAL_IIC_ADDR_FIXED
     self._sub_serial_channel = sub_uart_channel
-    self._rx_buffer_head = 0
-    self._rx_buffer_tail = 0
-    self._bus = smbus.SMBus(1)
-    #GPIO.setmode(GPIO.BCM)
-    #GPIO.setwarnings(False)
+    self._rx_buffer = bytearray()
+    self._page = None
+    self._shadow = {}
+    self._char_time = 10.0 / 115200
+    ## Seconds write() waits for space in the transmit FIFO before it gives up, 0 to never wait
+    self.write_timeout = 1.0
+    if hasattr(bus, 'transfer'):
+      self._bus = bus
+    else:
+      self._bus = DFRobot_IIC_Serial_Bus.get(bus)
 
   def begin(self, baud, format = IIC_Serial_8N1):
     '''!
-      @brief Init function, set sub UART band rate, data format 
+      @brief Init function, set sub UART band rate, data format
       @param baud: baud rate, it support: 9600, 57600, 115200, 2400, 4800, 7200,
       @n     14400, 19200, 28800,38400, 76800, 153600, 230400, 460800, 307200, 921600
       @param format: Data format, it support:
@@ -192,13 +275,34 @@ class DFRobot_IIC_Serial:
       @return Return 0 if it sucess, otherwise return non-zero
     '''
     return self._begin(baud, format, self.eNormalMode, self.eNormal)
-  
+
+  def set_baud(self, baud, format = None):
+    '''!
+      @brief Change the band rate of a running sub UART, e.g. after a speed negotiation, without begin().
+      @n The sub UART is not reset: data written before is sent with the old band rate first(flush()), received
+      @n data stays in the receive FIFO and the software receive buffer. SCR, SPAGE, BAUD1/BAUD0/PRES and LCR are
+      @n written in one combined transfer, registers that keep their value are skipped. A byte arriving during
+      @n that transfer may be lost, so switch while the peer is silent.
+      @param baud: band rate, see begin()
+      @param format: data format, see begin(), None keeps the current one
+      @return Return 0 if it sucess, otherwise return non-zero
+    '''
+    return self._reconfigure(baud, format)
+
+  def set_format(self, format):
+    '''!
+      @brief Change the data format of a running sub UART, only LCR is written, see set_baud()
+      @param format: data format, see begin()
+      @return Return 0 if it sucess, otherwise return non-zero
+    '''
+    return self._reconfigure(None, format)
+
   def end(self):
     '''!
       @brief Release sub UART to clean up all registers in Sub UART. Call function begin() again to make it work.
     '''
     self._sub_serial_global_reg_enable(self._sub_serial_channel, 1)
-  
+
   def printf(self, *args, **kargs):
     '''!
       @brief The Prints the values to a stream, usage is the same as print function.
@@ -222,122 +326,189 @@ class DFRobot_IIC_Serial:
   def available(self):
     '''!
       @brief Get the number of bytes in receive buffer, it should be the total number of bytes in FIFO
-      @n receive buffer(256B) and self-defined _rx_buffer(31B).
+      @n receive buffer(256B) and the software receive buffer. RFCNT and FSR are read in one combined transfer.
       @return Return the number of bytes in receive buffer
     '''
-    l = self._read_bytes(self.REG_WK2132_RFCNT, 1)
-    index = 0
-    if len(l) != 1:
-      print("READ BYTE SIZE ERROR!")
-      return 0
-    index = int(l[0])
-    if index == 0:
-      fsr = self._read_fifo_state_reg()
-      if (fsr & self.sFsrReg_rDat) > 0:
-        index = 256
-    
-    return (index + (self.SERIAL_RX_BUFFER_SIZE + self._rx_buffer_head - self._rx_buffer_tail)% self.SERIAL_RX_BUFFER_SIZE)
-    
+    return self._fifo_count(self.REG_WK2132_RFCNT)[0] + len(self._rx_buffer)
+
   def peek(self):
     '''!
       @brief Return the data of 1 byte without deleting the data in the receive buffer
       @return Return the readings
     '''
-    num = self.available() - ((self.SERIAL_RX_BUFFER_SIZE + self._rx_buffer_head - self._rx_buffer_tail) % self.SERIAL_RX_BUFFER_SIZE)
-    i = 0
-    while i < num:
-      j = (self._rx_buffer_head + 1) % self.SERIAL_RX_BUFFER_SIZE
-      if j != self._rx_buffer_tail:
-        l = self._read_bytes(self.REG_WK2132_FDAT, 1)
-        self._rx_buffer[self._rx_buffer_head] = chr(l[0])
-        self._rx_buffer_head = j
-        i += 1
-      else:
-        break
-    if self._rx_buffer_head == self._rx_buffer_tail:
+    if len(self._rx_buffer) == 0:
+      self._fill_rx_buffer()
+    if len(self._rx_buffer) == 0:
       return ''
-    return self._rx_buffer[self._rx_buffer_tail]
-        
+    return self._to_str(self._rx_buffer[:1])
+
   def read(self, size = 1):
     '''!
       @brief Read size bytes from the serial port, this operation will delete the data in the buffer.
+      @n It does not wait, the receive FIFO is read at most once, in one block transfer of up to 256 bytes.
       @param size: the bytes of read
       @return less characters as requested.
     '''
-    num = self.available() - ((self.SERIAL_RX_BUFFER_SIZE + self._rx_buffer_head - self._rx_buffer_tail) % self.SERIAL_RX_BUFFER_SIZE)
-    i = 0
-    k = 0
-    r = ""
-    if size > self.available():
-      size = self.available()
-    
-    while i < num or k < size:
-      j = (self._rx_buffer_head + 1) % self.SERIAL_RX_BUFFER_SIZE
-      if k < size and self._rx_buffer_tail != self._rx_buffer_head:
-        r += self._rx_buffer[self._rx_buffer_tail]
-        self._rx_buffer_tail = (self._rx_buffer_tail + 1) % self.SERIAL_RX_BUFFER_SIZE
-        k += 1
-        
-      if i < num and j != self._rx_buffer_tail:
-        l = self._read_bytes(self.REG_WK2132_FDAT, 1)
-        if len(l) != 1:
-          return -1
-        self._rx_buffer[self._rx_buffer_head] = chr(l[0])
-        self._rx_buffer_head = j
-        i += 1
-      if k >= size and j != self._rx_buffer_tail:
-        #print("ok")
-        break
-    try:
-      return bytes(r)
-    except:
-      return str(r)#bytes(r, encoding = "utf8")
+    if len(self._rx_buffer) < size:
+      self._fill_rx_buffer()
+    r = self._rx_buffer[:size]
+    del self._rx_buffer[:size]
+    return self._to_str(r)
 
   def flush(self):
     '''!
-      @brief Wait for the data to be transmited completely
+      @brief Wait for the data to be transmited completely, at most twice the time the transmit FIFO needs
     '''
-    fsr = self._read_fifo_state_reg()
-    while fsr & sFsrReg_tDat > 0:
-      time.sleep(0.001)
+    deadline = None
+    while True:
+      count, fsr = self._fifo_count(self.REG_WK2132_TFCNT)
+      if self.last_operate_status != self.STA_OK or (fsr & (self.sFsrReg_tBusy | self.sFsrReg_tDat)) == 0:
+        return
+      now = _monotonic()
+      if deadline is None:
+        deadline = now + 2 * (count + 1) * self._char_time + 0.01
+      elif now >= deadline:
+        return
+      time.sleep(max(count, 1) * self._char_time)
 
   def write(self, value):
     '''!
-      @brief Output the given byte string over the serial port.
+      @brief Output the given byte string over the serial port. The free space of the transmit FIFO is read once
+      @n per block, and the block is written in one transfer. If the FIFO is full, it waits at most write_timeout
+      @n seconds for space.
       @param value: byte string
       @return return bytes actually written.
     '''
-    d = 0
-    
-    try:
-      d = to_bytes(value)
-    except:
-      d = str(value)
-  
-    d = [ord(x) for x in d]
-    tx_len = length = len(d)
+    d = self._to_bytearray(value)
+    fifo_addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_FIFO)
     n = 0
-    while tx_len > 0:
-      try:
-        fsr = self._read_fifo_state_reg()
-        if fsr & self.sFsrReg_tFull > 0:
-          print("FIFO full")
-          return length - len(d[n:])
-        
-        self._write_bytes(self.REG_WK2132_FDAT, [d[n]])
-        n += 1
-        tx_len -= 1
-      except:
-        pass
-    return length - len(d[n:])
-    
-  
-  def _read_fifo_state_reg(self):
-    l = self._read_bytes(self.REG_WK2132_FSR, 1)
-    if len(l) != 1:
+    deadline = None
+    while n < len(d):
+      count = self._fifo_count(self.REG_WK2132_TFCNT)[0]
+      if self.last_operate_status != self.STA_OK:
+        break
+      free = self.FIFO_SIZE - count
+      if free > 0:
+        block = d[n:n + free]
+        try:
+          self._bus.transfer([(fifo_addr, block)])
+        except (IOError, OSError):
+          self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
+          break
+        n += len(block)
+        deadline = None
+        continue
+      now = _monotonic()
+      if deadline is None:
+        deadline = now + self.write_timeout
+      if now >= deadline:
+        break
+      #Wait until about half of the FIFO has been sent
+      time.sleep(min(len(d) - n, self.FIFO_SIZE // 2) * self._char_time)
+    return n
+
+  def wait(self, timeout = None):
+    '''!
+      @brief Wait until data has been received
+      @param timeout: seconds, None waits forever, 0 only checks
+      @return Return True if data is available
+    '''
+    return len(self.select([self], timeout)) > 0
+
+  @staticmethod
+  def select(ports, timeout = None):
+    '''!
+      @brief Wait until any of the sub UARTs has received data, like select.select() for the read list.
+      @n The receive FIFO counts of all sub UARTs on one IIC bus are read in one combined transfer per check.
+      @param ports: list of DFRobot_IIC_Serial objects, e.g. both sub UARTs of a module
+      @param timeout: seconds, None waits forever, 0 only checks
+      @return Return the list of ports with received data, empty on timeout
+    '''
+    interval = min(max(8 * min([p._char_time for p in ports]), 0.0005), 0.01)
+    deadline = None if timeout is None else _monotonic() + timeout
+    while True:
+      ready = set([id(p) for p in ports if len(p._rx_buffer)])
+      if not ready:
+        groups = {}
+        for p in ports:
+          groups.setdefault(id(p._bus), []).append(p)
+        for group in groups.values():
+          msgs = []
+          for p in group:
+            msgs += p._count_msgs(p.REG_WK2132_RFCNT)
+          try:
+            l = group[0]._bus.transfer(msgs)
+          except (IOError, OSError):
+            continue
+          for i in range(len(group)):
+            if (l[2 * i][0] & group[i].sFsrReg_rDat) or l[2 * i + 1][0]:
+              ready.add(id(group[i]))
+      if ready:
+        return [p for p in ports if id(p) in ready]
+      now = _monotonic()
+      if deadline is not None and now >= deadline:
+        return []
+      time.sleep(interval if deadline is None else min(interval, deadline - now))
+
+  def _count_msgs(self, reg):
+    addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
+    return [(addr, [self.REG_WK2132_FSR]), (addr, 1), (addr, [reg]), (addr, 1)]
+
+  def _fifo_count(self, reg):
+    '''!
+      @brief Read FSR and then RFCNT or TFCNT in one combined transfer. Both counters read 0 for an empty and
+      @n for a full FIFO, FSR tells them apart. FSR comes first, so a byte received between the two reads
+      @n cannot make an empty receive FIFO look full.
+      @param reg REG_WK2132_RFCNT or REG_WK2132_TFCNT
+      @return Return (the number of bytes in the FIFO, FSR)
+    '''
+    try:
+      l = self._bus.transfer(self._count_msgs(reg))
+      self.last_operate_status = self.STA_OK
+    except (IOError, OSError):
+      self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
+      return (0, 0)
+    fsr = l[0][0]
+    count = l[1][0]
+    if count == 0:
+      if reg == self.REG_WK2132_RFCNT and (fsr & self.sFsrReg_rDat):
+        count = self.FIFO_SIZE
+      elif reg == self.REG_WK2132_TFCNT and (fsr & self.sFsrReg_tFull):
+        count = self.FIFO_SIZE
+    return (count, fsr)
+
+  def _fill_rx_buffer(self):
+    '''!
+      @brief Move the receive FIFO into the software receive buffer in one block transfer
+      @return Return the number of bytes moved
+    '''
+    space = self.SERIAL_RX_BUFFER_SIZE - len(self._rx_buffer)
+    if space <= 0:
       return 0
-    else:
-      return l[0]
+    n = min(self._fifo_count(self.REG_WK2132_RFCNT)[0], space)
+    if n == 0:
+      return 0
+    fifo_addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_FIFO)
+    try:
+      self._rx_buffer += self._bus.transfer([(fifo_addr, n)])[0]
+    except (IOError, OSError):
+      self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
+      return 0
+    return n
+
+  def _to_str(self, buf):
+    r = bytes(buf)
+    if str is bytes:
+      return r
+    return r.decode('latin-1')
+
+  def _to_bytearray(self, value):
+    try:
+      return bytearray(to_bytes(value))
+    except TypeError:
+      if not hasattr(value, 'encode'):
+        value = str(value)
+      return bytearray(value.encode('utf-8'))
 
   def _begin(self, baud, format, mode, opt):
     '''!
@@ -351,14 +522,11 @@ class DFRobot_IIC_Serial:
       @param mode: Sub UART communciation mode, can set to UART mode, all enumeration values in eCommunicationMode_t
       @param opt: Sub UART Line-Break output control bit, can set to normal output (0) and Line-Break output (1),
       @n all enumeration values in eLineBreakOutput_t or 0/1
-      @return Return 0 if init succeeds, otherwise return non-zero 
+      @return Return 0 if init succeeds, otherwise return non-zero
     '''
-    self._rx_buffer_head = 0
-    self._rx_buffer_tail = 0
-    val = 0
-    channel = self._sub_serial_channel_switch(self.SUBUART_CHANNEL_1)
-    l = self._read_bytes(self.REG_WK2132_GENA, 1)
-    
+    self._rx_buffer = bytearray()
+    l = self._read_bytes(self.REG_WK2132_GENA, 1, self.SUBUART_CHANNEL_1)
+
     if len(l) != 1:
       print("READ BYTE ERROR!")
       return self.DFROBOT_IICSERIAL_ERR_READ
@@ -366,7 +534,6 @@ class DFRobot_IIC_Serial:
     if l[0] & 0x80 == 0:
       print("Read REG_WK2132_GENA  ERROR!")
       return self.DFROBOT_IICSERIAL_ERR_REGDATA
-    self._sub_serial_channel_switch(channel)
     self._sub_serial_config(self._sub_serial_channel)
     self._set_sub_serial_baudrate(baud)
     self._set_sub_serial_config_reg(format, mode, opt)
@@ -383,40 +550,43 @@ class DFRobot_IIC_Serial:
     self._sub_serial_reg_config(self.REG_WK2132_FCR, fcr)
     scr = ((1 << 0) | (1 << 1) | (0 << 2) | (0 << 3)) & 0xff
     self._sub_serial_reg_config(self.REG_WK2132_SCR, scr)
-    
+
   def _sub_serial_page_switch(self, page):
-    if page > 1:
-      return None
-    l = self._read_bytes(self.REG_WK2132_SPAGE, 1)
-    if len(l) != 1:
-      print("READ BYTE ERROR!")
+    '''!
+      @brief Switch the register page, SPAGE is only written when the cached page differs
+    '''
+    if page > 1 or page == self._page:
       return None
-    if page == 0:
-      l[0] &= 0xFE
-    elif page == 1:
-      l[0] |= 0x01
-    self._write_bytes(self.REG_WK2132_SPAGE, l)
-    l = self._read_bytes(self.REG_WK2132_SPAGE, 1)
-  
+    self._write_bytes(self.REG_WK2132_SPAGE, [page])
+    if self.last_operate_status == self.STA_OK:
+      self._page = page
+
   def _sub_serial_global_reg_enable(self, sub_uart_channel, type):
      if sub_uart_channel > self.SUBUART_CHANNEL_ALL:
        print("SUBSERIAL CHANNEL NUMBER ERROR!")
        return None
      reg_addr = self._get_global_reg_type(type)
-     channel = self._sub_serial_channel_switch(self.SUBUART_CHANNEL_1)
-     l = self._read_bytes(reg_addr, 1)
-     if len(l) != 1:
-       print("READ BYTE SIZE ERROR!")
-       return None
      if sub_uart_channel == self.SUBUART_CHANNEL_1:
-       l[0] |= 0x01
+       bits = 0x01
      elif sub_uart_channel == self.SUBUART_CHANNEL_2:
-       l[0] |= 0x02
+       bits = 0x02
      else:
-       l[0] |= 0x03
-     self._write_bytes(reg_addr, l)
-     l = self._read_bytes(reg_addr,1)
-     self._sub_serial_channel_switch(channel)
+       bits = 0x03
+     if type == 1:
+       #The reset bits clear automatically, and the reset sets SCR, LCR, FCR, SIER and SPAGE to 0
+       self._write_bytes(reg_addr, [bits], self.SUBUART_CHANNEL_1)
+       self._page = 0
+       self._shadow = {}
+       for reg in range(self.REG_WK2132_SCR, self.REG_WK2132_SIER + 1):
+         self._shadow[(0, reg)] = 0
+       return None
+     #The global registers are shared with the other sub UART, so they are not cached
+     l = self._read_bytes(reg_addr, 1, self.SUBUART_CHANNEL_1)
+     if len(l) != 1:
+       print("READ BYTE SIZE ERROR!")
+       return None
+     if l[0] & bits != bits:
+       self._write_bytes(reg_addr, [l[0] | bits], self.SUBUART_CHANNEL_1)
 
   def _get_global_reg_type(self, type):
     if type < 0 or type > 2:
@@ -432,94 +602,166 @@ class DFRobot_IIC_Serial:
     return reg_addr
 
   def _sub_serial_reg_config(self, reg, val):
-    l = self._read_bytes(reg, 1)
-    if len(l) != 1:
-      return None
-    l[0] = l[0] | val
-    self._write_bytes(reg, l)
-    l = self._read_bytes(reg, 1)
+    self._write_reg_cached(reg, self._read_reg_cached(reg) | val)
 
-  def _sub_serial_channel_switch(self, sub_uart_channel):
-    channel = self._sub_serial_channel
-    self._sub_serial_channel = sub_uart_channel
-    return channel
+  def _read_reg_cached(self, reg):
+    '''!
+      @brief Read a configuration register of the current page, only the first read goes to the module
+    '''
+    key = (self._page, reg)
+    if key not in self._shadow:
+      l = self._read_bytes(reg, 1)
+      if len(l) != 1:
+        return 0
+      self._shadow[key] = l[0]
+    return self._shadow[key]
+
+  def _write_reg_cached(self, reg, val):
+    '''!
+      @brief Write a configuration register of the current page, skipped if it already holds the value
+    '''
+    key = (self._page, reg)
+    if self._shadow.get(key) == val:
+      return None
+    self._write_bytes(reg, [val])
+    if self.last_operate_status != self.STA_OK or self._page is None:
+      self._shadow.pop(key, None)
+      return None
+    if self._page == 0 and reg == self.REG_WK2132_FCR:
+      #The FIFO reset bits clear automatically
+      val &= 0xFC
+    self._shadow[key] = val
 
   def _set_sub_serial_baudrate(self, baud):
-    scr = self._read_bytes(self.REG_WK2132_SCR, 1)
-    self._sub_serial_reg_config(self.REG_WK2132_SCR, 0)
-    baud1 = 0
-    baud0 = 0
-    baud_pres = 0
-    val_intger =  self.DFROBOT_IICSERIAL_FOSC//(baud * 16) - 1
-    val_decimal = (self.DFROBOT_IICSERIAL_FOSC%(baud * 16))//(baud * 16)
-    type(val_intger)
-    type(val_decimal)
-    baud1 = (val_intger >> 8)&0xff
-    baud0 = (val_intger & 0x00ff)
-    while val_decimal > 0x0A:
-      val_decimal /= 0x0A
-    baud_pres = val_decimal & 0xff
+    '''!
+      @brief Set the band rate, the divisor is rounded to the nearest tenth like baudDivisor() of the C++ library
+    '''
+    fosc = self.DFROBOT_IICSERIAL_FOSC
+    divisor = (fosc * 10 + baud * 8) // (baud * 16) - 10
+    if divisor < 0:
+      divisor = 0
+    baud1 = ((divisor // 10) >> 8) & 0xff
+    baud0 = (divisor // 10) & 0xff
+    baud_pres = divisor % 10
+    self._baud = (fosc * 10 + (divisor + 10) * 8) // ((divisor + 10) * 16)
+    scr = self._read_reg_cached(self.REG_WK2132_SCR)
+    self._write_reg_cached(self.REG_WK2132_SCR, 0)
     self._sub_serial_page_switch(1)
-    
-    self._sub_serial_reg_config(self.REG_WK2132_BAUD1, int(baud1))
-    self._sub_serial_reg_config(self.REG_WK2132_BAUD0, int(baud0))
-    self._sub_serial_reg_config(self.REG_WK2132_PRES, int(baud_pres))
-    
+    self._write_reg_cached(self.REG_WK2132_BAUD1, baud1)
+    self._write_reg_cached(self.REG_WK2132_BAUD0, baud0)
+    self._write_reg_cached(self.REG_WK2132_PRES, baud_pres)
     self._sub_serial_page_switch(0)
-    self._sub_serial_reg_config(self.REG_WK2132_SCR, scr[0])
+    self._write_reg_cached(self.REG_WK2132_SCR, scr)
+    self._update_char_time()
 
   def _set_sub_serial_config_reg(self, format, mode, opt):
-    self._addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
-    l = self._read_bytes(self.REG_WK2132_LCR, 1)
-    if len(l) != 1:
-      print("READ BYTE ERROR!")
-      return None
-    
-    lcr = l[0] & 0xC0
+    lcr = self._read_reg_cached(self.REG_WK2132_LCR) & 0xC0
     lcr |= format
     lcr |= (mode << 4)
     lcr |= (opt << 5)
-    self._write_bytes(self.REG_WK2132_LCR, [lcr])
-    l = self._read_bytes(self.REG_WK2132_LCR, 1)
+    self._write_reg_cached(self.REG_WK2132_LCR, lcr)
+    self._update_char_time()
+
+  def _reconfigure(self, baud, format):
+    '''!
+      @brief Change band rate and data format without resetting the sub UART, see set_baud()
+      @param baud: band rate, None keeps the current one
+      @param format: data format, None keeps the current one
+      @return Return 0 if it sucess, otherwise return non-zero
+    '''
+    self._sub_serial_page_switch(0)
+    writes = []
+    scr = 0
+    if baud is not None:
+      fosc = self.DFROBOT_IICSERIAL_FOSC
+      divisor = max((fosc * 10 + baud * 8) // (baud * 16) - 10, 0)
+      regs = [(self.REG_WK2132_BAUD1, ((divisor // 10) >> 8) & 0xff), (self.REG_WK2132_BAUD0, (divisor // 10) & 0xff),
+              (self.REG_WK2132_PRES, divisor % 10)]
+      regs = [(1, reg, val) for reg, val in regs if self._shadow.get((1, reg)) != val]
+      if regs:
+        #The band rate registers are only written while the receiver and the transmitter are disabled
+        scr = self._read_reg_cached(self.REG_WK2132_SCR)
+        if scr:
+          writes.append((0, self.REG_WK2132_SCR, 0))
+        writes += [(0, self.REG_WK2132_SPAGE, 1)] + regs + [(1, self.REG_WK2132_SPAGE, 0)]
+    if format is not None:
+      lcr = self._read_reg_cached(self.REG_WK2132_LCR)
+      if (lcr & 0xF0) | format != lcr:
+        writes.append((0, self.REG_WK2132_LCR, (lcr & 0xF0) | format))
+    if scr:
+      writes.append((0, self.REG_WK2132_SCR, scr))
+    if self.last_operate_status != self.STA_OK:
+      return self.DFROBOT_IICSERIAL_ERR_READ
+    if not writes:
+      return self.DFROBOT_IICSERIAL_ERR_OK
+    #Data written before belongs to the old setting, the FIFOs and the receive buffer are kept as they are
+    self.flush()
+    addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
+    try:
+      self._bus.transfer([(addr, [reg, val]) for page, reg, val in writes])
+      self.last_operate_status = self.STA_OK
+    except (IOError, OSError):
+      #Nothing is known about the registers after a partial transfer, they are read again on next use
+      self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
+      self._page = None
+      self._shadow = {}
+      return self.DFROBOT_IICSERIAL_ERR_READ
+    for page, reg, val in writes:
+      if reg != self.REG_WK2132_SPAGE:
+        self._shadow[(page, reg)] = val
+    if baud is not None:
+      self._baud = (fosc * 10 + (divisor + 10) * 8) // ((divisor + 10) * 16)
+    self._update_char_time()
+    return self.DFROBOT_IICSERIAL_ERR_OK
+
+  def _update_char_time(self):
+    '''!
+      @brief Time of one character on the line: start bit, 8 data bits, parity bit(PAEN) and 1 or 2 stop bits
+    '''
+    lcr = self._shadow.get((0, self.REG_WK2132_LCR), 0)
+    bits = 10 + ((lcr >> 3) & 0x01) + (lcr & 0x01)
+    self._char_time = float(bits) / max(self._baud, 1)
 
   def _update_addr(self, pre, sub_uart_channel, obj):
     addr = pre & 0xF8
     addr |= (obj & 0x01)
-    addr |= (sub_uart_channel << 1) 
+    addr |= (sub_uart_channel << 1)
     addr &= 0xff
     return addr
 
-  def _write_bytes(self, reg, buf):
+  def _write_bytes(self, reg, buf, sub_uart_channel = None):
     '''!
       @brief write bytes to register
       @param reg  Register address 8bits
       @param buf Store buffer list for the data to be write
+      @param sub_uart_channel Sub UART of the register, default the sub UART of this object
     '''
-    self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
-    self._addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
+    if sub_uart_channel is None:
+      sub_uart_channel = self._sub_serial_channel
+    addr = self._update_addr(self._addr, sub_uart_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
     try:
-      self._bus.write_i2c_block_data(self._addr, reg, buf)
+      self._bus.transfer([(addr, [reg] + list(buf))])
       self.last_operate_status = self.STA_OK
       return len(buf)
-    except:
-      #print("+++++++++++++")
+    except (IOError, OSError):
+      self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
       return 0
 
-      
-
-  def _read_bytes(self, reg, len1):
+  def _read_bytes(self, reg, len1, sub_uart_channel = None):
     '''!
-      @brief Read bytes data from register.
+      @brief Read bytes data from register, the register address and the data are one combined transfer
       @param reg  Register address 8bits
       @param len1 Store buffer list for the data to be read
+      @param sub_uart_channel Sub UART of the register, default the sub UART of this object
       @return Return list of data
     '''
-    self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
-    self._addr = self._update_addr(self._addr, self._sub_serial_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
-    self._addr = self._addr & 0xFE
+    if sub_uart_channel is None:
+      sub_uart_channel = self._sub_serial_channel
+    addr = self._update_addr(self._addr, sub_uart_channel, self.DFROBOT_IICSERIAL_OBJECT_REGISTER)
     try:
-      rslt = self._bus.read_i2c_block_data(self._addr, reg, len1)
+      rslt = list(self._bus.transfer([(addr, [reg]), (addr, len1)])[0])
       self.last_operate_status = self.STA_OK
       return rslt
-    except:
+    except (IOError, OSError):
+      self.last_operate_status = self.STA_ERR_DEVICE_NOT_DETECTED
       return []
@@ -0,0 +1,295 @@
+from __future__ import print_function
+
+'''!
+ @file DFRobot_IIC_Serial_PTY.py
+ @brief Define the basic structure of class DFRobot_IIC_Serial_PTY
+ @n Daemon that exposes every sub UART as a pseudo terminal, so minicom, pyserial or a Modbus stack can open it
+ @n like a tty device. One event loop waits on the pseudo terminals, the IRQ pin(optional) and a poll timer,
+ @n and moves data in FIFO blocks. Band rate and stop bits set on a pseudo terminal through termios are written
+ @n to the sub UART. Linux clears PARENB of every pseudo terminal, so the parity is chosen with --format.
+ @n Usage: python DFRobot_IIC_Serial_PTY.py --module 1,1 --baud 115200, then open /tmp/ttyIIC11_1 and /tmp/ttyIIC11_2.
+ @n With --sim it runs on DFRobot_IIC_Serial_Sim, TX of each sub UART connected to RX of the other, no module needed.
+
+ @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ @license     The MIT License (MIT)
+ @author [Arya](xue.peng@dfrobot.com)
+ @version  V1.0
+ @date  2021-05-07
+ @https://github.com/DFRobot/DFRobot_IIC_Serial
+'''
+import sys
+import os
+import errno
+import fcntl
+import select
+import termios
+import tty
+import argparse
+import signal
+
+from DFRobot_IIC_Serial import DFRobot_IIC_Serial
+
+## termios has no constant for mark/space parity in every Python version, this is the Linux value
+CMSPAR = getattr(termios, 'CMSPAR', 0o10000000000)
+
+## Band rates with a termios speed constant, rates like 14400 or 76800 cannot be chosen through termios
+_BAUDS = [1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 500000, 576000, 921600, 1000000]
+_SPEEDS = dict((getattr(termios, 'B%d' % b), b) for b in _BAUDS if hasattr(termios, 'B%d' % b))
+
+class _PtyPort(object):
+  def __init__(self, port, master, slave, name, link):
+    self.port = port
+    self.master = master
+    self.slave = slave
+    self.name = name
+    self.link = link
+    self.tx = bytearray()  #Read from the pseudo terminal, not yet in the transmit FIFO
+    self.rx = bytearray()  #Read from the receive FIFO, not yet taken by the pseudo terminal
+    self.termios = None
+
+class DFRobot_IIC_Serial_PTY(object):
+  ## Bytes taken from a pseudo terminal ahead of the transmit FIFO, the writer blocks beyond that
+  TX_PENDING_SIZE = 4096
+  ## Bytes kept for a pseudo terminal that does not read, the receive FIFO is not read beyond that
+  RX_PENDING_SIZE = 4096
+  ## Poll timer in IRQ mode, in case an edge was missed
+  IRQ_POLL_INTERVAL = 0.1
+
+  def __init__(self, irq_pin = None, poll_interval = None):
+    '''!
+      @brief Constructor
+      @param irq_pin: BCM number of the GPIO connected to the IRQ pin of the modules, None to poll only
+      @param poll_interval: seconds between two receive FIFO checks without IRQ pin, default 8 characters of the
+      @n fastest sub UART, 1~10ms
+    '''
+    self._ports = []
+    self._poll = select.poll()
+    self._poll_interval = poll_interval
+    self._irq_pin = irq_pin
+    self._wake = None
+    if irq_pin is not None:
+      import RPi.GPIO as GPIO
+      self._wake = os.pipe()
+      self._set_nonblocking(self._wake[0])
+      self._poll.register(self._wake[0], select.POLLIN)
+      GPIO.setmode(GPIO.BCM)
+      GPIO.setwarnings(False)
+      GPIO.setup(irq_pin, GPIO.IN, pull_up_down = GPIO.PUD_UP)
+      GPIO.add_event_detect(irq_pin, GPIO.FALLING, callback = self._irq)
+
+  def add_port(self, port, link = None):
+    '''!
+      @brief Create the pseudo terminal of a sub UART
+      @param port: DFRobot_IIC_Serial object, begin() has been called
+      @param link: path of a symbolic link to the pseudo terminal, None for none
+      @return Return the device name of the pseudo terminal, e.g. /dev/pts/3
+    '''
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    attr = termios.tcgetattr(slave)
+    attr[2] = (attr[2] & ~(termios.PARENB | termios.PARODD | CMSPAR | termios.CSTOPB)) | self._format_cflag(port)
+    for speed, baud in _SPEEDS.items():
+      if baud == port._baud:
+        attr[4] = attr[5] = speed
+    termios.tcsetattr(slave, termios.TCSANOW, attr)
+    self._set_nonblocking(master)
+    name = os.ttyname(slave)
+    if link is not None:
+      if os.path.islink(link):
+        os.unlink(link)
+      os.symlink(name, link)
+    p = _PtyPort(port, master, slave, name, link)
+    p.termios = self._termios_state(p)
+    port.write_timeout = 0
+    if self._irq_pin is not None:
+      #Only the receive FIFO trigger and timeout assert IRQ, both clear when the FIFO is read
+      port._write_reg_cached(port.REG_WK2132_SIER, 0x03)
+    self._ports.append(p)
+    self._poll.register(master, select.POLLIN)
+    return name
+
+  def close(self):
+    '''!
+      @brief Close the pseudo terminals and remove their links
+    '''
+    for p in self._ports:
+      self._poll.unregister(p.master)
+      os.close(p.master)
+      os.close(p.slave)
+      if p.link is not None and os.path.islink(p.link):
+        os.unlink(p.link)
+    self._ports = []
+    if self._irq_pin is not None:
+      import RPi.GPIO as GPIO
+      GPIO.remove_event_detect(self._irq_pin)
+
+  def run(self):
+    '''!
+      @brief Serve the pseudo terminals until an exception, e.g. KeyboardInterrupt
+    '''
+    while True:
+      self.poll()
+
+  def poll(self):
+    '''!
+      @brief One pass of the event loop: wait for a pseudo terminal, the IRQ pin or the timer, then move data
+      @n in both directions
+    '''
+    timeout = self._timeout()
+    events = dict(self._poll.poll(int(timeout * 1000 + 0.999)))
+    check_rx = self._irq_pin is None or len(events) == 0
+    if self._wake is not None and self._wake[0] in events:
+      self._drain_fd(self._wake[0])
+      check_rx = True
+    elif not check_rx:
+      #IRQ stays low while data waits, a busy pseudo terminal must not hide that there is no new edge
+      check_rx = self._irq_asserted()
+    for p in self._ports:
+      self._check_termios(p)
+      if events.get(p.master, 0) & select.POLLIN:
+        self._read_pty(p)
+      if len(p.tx):
+        del p.tx[:p.port.write(p.tx)]
+    if check_rx:
+      ports = [p.port for p in self._ports if len(p.rx) < self.RX_PENDING_SIZE]
+      ready = DFRobot_IIC_Serial.select(ports, 0) if len(ports) else []
+      for p in self._ports:
+        if p.port in ready:
+          r = p.port.read(DFRobot_IIC_Serial.FIFO_SIZE)
+          p.rx += bytearray(r if isinstance(r, bytes) else r.encode('latin-1'))
+    for p in self._ports:
+      if len(p.rx):
+        try:
+          del p.rx[:os.write(p.master, p.rx)]
+        except OSError as e:
+          if e.errno != errno.EAGAIN:
+            raise
+      mask = 0
+      if len(p.tx) < self.TX_PENDING_SIZE:
+        mask |= select.POLLIN
+      if len(p.rx):
+        mask |= select.POLLOUT
+      self._poll.modify(p.master, mask)
+
+  def _timeout(self):
+    timeout = self._poll_interval
+    if timeout is None:
+      timeout = min(max(8 * min([p.port._char_time for p in self._ports] + [1.0]), 0.001), 0.01)
+    if self._irq_pin is not None:
+      timeout = self.IRQ_POLL_INTERVAL
+    for p in self._ports:
+      if len(p.tx):
+        #Wait for space in the transmit FIFO
+        timeout = min(timeout, max(16 * p.port._char_time, 0.001))
+    return timeout
+
+  def _irq(self, pin):
+    os.write(self._wake[1], b'x')
+
+  def _irq_asserted(self):
+    import RPi.GPIO as GPIO
+    return GPIO.input(self._irq_pin) == GPIO.LOW
+
+  def _read_pty(self, p):
+    try:
+      p.tx += os.read(p.master, self.TX_PENDING_SIZE - len(p.tx))
+    except OSError as e:
+      if e.errno not in (errno.EAGAIN, errno.EIO):
+        raise
+
+  def _check_termios(self, p):
+    '''!
+      @brief Write band rate and data format changed on the pseudo terminal to the sub UART. The data written
+      @n before the change is sent first with the old setting.
+    '''
+    state = self._termios_state(p)
+    if state == p.termios:
+      return
+    p.termios = state
+    baud, cflag = state
+    fmt = p.port._shadow.get((0, p.port.REG_WK2132_LCR), 0) & 0x0E
+    if cflag & termios.PARENB:
+      if cflag & CMSPAR:
+        fmt = DFRobot_IIC_Serial.IIC_Serial_8F1 if cflag & termios.PARODD else DFRobot_IIC_Serial.IIC_Serial_8Z1
+      else:
+        fmt = DFRobot_IIC_Serial.IIC_Serial_8O1 if cflag & termios.PARODD else DFRobot_IIC_Serial.IIC_Serial_8E1
+    if cflag & termios.CSTOPB:
+      fmt |= DFRobot_IIC_Serial.IIC_Serial_8N2
+    self._read_pty(p)
+    p.port.write_timeout = 1.0
+    del p.tx[:p.port.write(p.tx)]
+    p.port.write_timeout = 0
+    p.port.flush()
+    if baud is None:
+      p.port.set_format(fmt)
+    else:
+      p.port.set_baud(baud, fmt)
+    print('%s: %s baud, format 0x%02X' % (p.link or p.name, p.port._baud, fmt))
+    sys.stdout.flush()
+
+  def _termios_state(self, p):
+    attr = termios.tcgetattr(p.slave)
+    return (_SPEEDS.get(attr[5]), attr[2] & (termios.CSTOPB | termios.PARENB | termios.PARODD | CMSPAR))
+
+  def _format_cflag(self, port):
+    lcr = port._shadow.get((0, port.REG_WK2132_LCR), 0)
+    cflag = termios.CSTOPB if lcr & 0x01 else 0
+    if lcr & 0x08:
+      cflag |= termios.PARENB
+      pam = (lcr >> 1) & 0x03
+      if pam == 0x00 or pam == 0x03:
+        cflag |= CMSPAR
+      if pam == 0x01 or pam == 0x03:
+        cflag |= termios.PARODD
+    return cflag
+
+  def _set_nonblocking(self, fd):
+    fcntl.fcntl(fd, fcntl.F_SETFL, fcntl.fcntl(fd, fcntl.F_GETFL) | os.O_NONBLOCK)
+
+  def _drain_fd(self, fd):
+    try:
+      while os.read(fd, 64):
+        pass
+    except OSError as e:
+      if e.errno != errno.EAGAIN:
+        raise
+
+def main(argv = None):
+  parser = argparse.ArgumentParser(description = 'Expose the sub UARTs of IIC to dual UART modules as pseudo terminals')
+  parser.add_argument('--bus', type = int, default = 1, help = 'IIC bus number, default 1 for /dev/i2c-1')
+  parser.add_argument('--module', action = 'append', help = 'IA1,IA0 of a module, can be repeated, default 1,1')
+  parser.add_argument('--baud', type = int, default = 115200, help = 'initial band rate, default 115200')
+  parser.add_argument('--format', default = '8N1', choices = ['8N1', '8N2', '8Z1', '8Z2', '8O1', '8O2', '8E1', '8E2', '8F1', '8F2'],
+                      help = 'initial data format, default 8N1')
+  parser.add_argument('--link', default = '/tmp/ttyIIC', help = 'link prefix, the links are <prefix><IA1><IA0>_<sub UART>')
+  parser.add_argument('--irq-pin', type = int, help = 'BCM number of the GPIO connected to IRQ, default poll timer')
+  parser.add_argument('--interval', type = float, help = 'poll timer in seconds')
+  parser.add_argument('--sim', action = 'store_true', help = 'simulated modules, TX of each sub UART connected to RX of the other')
+  args = parser.parse_args(argv)
+  modules = [tuple(int(x) for x in m.split(',')) for m in (args.module or ['1,1'])]
+  bus = args.bus
+  if args.sim:
+    from DFRobot_IIC_Serial_Sim import DFRobot_IIC_Serial_Sim
+    bus = DFRobot_IIC_Serial_Sim(modules = modules, cross = True, realtime = True)
+  daemon = DFRobot_IIC_Serial_PTY(irq_pin = args.irq_pin, poll_interval = args.interval)
+  #Stopping the daemon removes the links as well
+  signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(0))
+  try:
+    for IA1, IA0 in modules:
+      for channel in [DFRobot_IIC_Serial.SUBUART_CHANNEL_1, DFRobot_IIC_Serial.SUBUART_CHANNEL_2]:
+        port = DFRobot_IIC_Serial(channel, IA1, IA0, bus)
+        if port.begin(args.baud, getattr(DFRobot_IIC_Serial, 'IIC_Serial_' + args.format)) != DFRobot_IIC_Serial.DFROBOT_IICSERIAL_ERR_OK:
+          print('Module IA1=%d IA0=%d not found' % (IA1, IA0), file = sys.stderr)
+          return 1
+        link = '%s%d%d_%d' % (args.link, IA1, IA0, channel + 1)
+        print('%s -> %s' % (link, daemon.add_port(port, link)))
+    sys.stdout.flush()
+    daemon.run()
+  except KeyboardInterrupt:
+    pass
+  finally:
+    daemon.close()
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,193 @@
+from __future__ import print_function
+
+'''!
+ @file DFRobot_IIC_Serial_Sim.py
+ @brief Define the basic structure of class DFRobot_IIC_Serial_Sim
+ @n Simulated IIC bus with WK2132 modules, it has the same transfer() as DFRobot_IIC_Serial_Bus, so the driver,
+ @n the benchmark and the pseudo terminal daemon run without hardware. The transmitted bytes of a sub UART are
+ @n looped back to its own receiver, or to the other sub UART of the module. The band rate and data format are
+ @n taken from the BAUD1/BAUD0/PRES and LCR registers the driver writes.
+ @n The clock is either virtual, every transfer then costs its bits on the IIC bus plus TRANSFER_OVERHEAD, or real time.
+
+ @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ @license     The MIT License (MIT)
+ @author [Arya](xue.peng@dfrobot.com)
+ @version  V1.0
+ @date  2021-05-07
+ @https://github.com/DFRobot/DFRobot_IIC_Serial
+'''
+import time
+
+from DFRobot_IIC_Serial import DFRobot_IIC_Serial
+
+class DFRobot_IIC_Serial_Sim(object):
+  ## Assumed time of the ioctl and the IIC driver setup per transfer on the virtual clock, in seconds
+  TRANSFER_OVERHEAD = 60e-6
+
+  def __init__(self, bus_hz = 400000, modules = None, baud = 115200, cross = False, realtime = False):
+    '''!
+      @brief Constructor
+      @param bus_hz: IIC bus clock, only used on the virtual clock
+      @param modules: list of (IA1, IA0) of the simulated modules(default: [(1, 1)]), other addresses do not acknowledge
+      @param baud: Band rate of a sub UART whose band rate registers have not been written
+      @param cross: False: TX of a sub UART is connected to its own RX, True: to RX of the other sub UART
+      @param realtime: False: virtual clock, True: time.monotonic()
+    '''
+    s = DFRobot_IIC_Serial
+    if modules is None:
+      modules = [(1, 1)]
+    self._modules = [(IA1 << 6) | (IA0 << 5) | s.DFROBOT_IICSERIAL_IIC_ADDR_FIXED for IA1, IA0 in modules]
+    self._bit_time = 1.0 / bus_hz
+    self._default_baud = baud
+    self._cross = cross
+    self._realtime = realtime
+    self._start = self._real_time()
+    self._tx = {}
+    self._rx = {}
+    self._line = {}
+    self._reg = {}
+    self._regs = {}
+    for pre in self._modules:
+      for ch in [s.SUBUART_CHANNEL_1, s.SUBUART_CHANNEL_2]:
+        uart = pre | (ch << 1)
+        self._tx[uart] = bytearray()
+        self._rx[uart] = bytearray()
+        self._line[uart] = 0.0
+        self._reg[uart] = 0
+    ## Bytes dropped because the receive FIFO was full
+    self.lost = 0
+    ## Virtual time in seconds
+    self.now = 0.0
+    ## Number of transfer() calls
+    self.transactions = 0
+
+  def _real_time(self):
+    return time.monotonic() if hasattr(time, 'monotonic') else time.time()
+
+  def monotonic(self):
+    '''!
+      @brief Clock of the simulation, assign the object to DFRobot_IIC_Serial's time module for a virtual clock
+    '''
+    if self._realtime:
+      self.now = self._real_time() - self._start
+    return self.now
+
+  def time(self):
+    return self.monotonic()
+
+  def sleep(self, s):
+    if self._realtime:
+      time.sleep(s)
+    else:
+      self.now += s
+    self._run_line()
+
+  def char_time(self, uart):
+    '''!
+      @brief Time of one character of a sub UART, from the band rate and LCR registers
+      @param uart: 7 bits register address of the sub UART
+    '''
+    s = DFRobot_IIC_Serial
+    regs = self._regs
+    baud = self._default_baud
+    if (uart, 1, s.REG_WK2132_BAUD0) in regs:
+      divisor = ((regs.get((uart, 1, s.REG_WK2132_BAUD1), 0) << 8) | regs[(uart, 1, s.REG_WK2132_BAUD0)]) * 10
+      divisor += regs.get((uart, 1, s.REG_WK2132_PRES), 0)
+      baud = float(s.DFROBOT_IICSERIAL_FOSC) * 10 / ((divisor + 10) * 16)
+    lcr = regs.get((uart, 0, s.REG_WK2132_LCR), 0)
+    return (10.0 + ((lcr >> 3) & 0x01) + (lcr & 0x01)) / baud
+
+  def _run_line(self):
+    self.monotonic()
+    for uart in self._tx:
+      t = self.char_time(uart)
+      dest = (uart ^ 0x02) if self._cross else uart
+      while len(self._tx[uart]) and self._line[uart] + t <= self.now:
+        c = self._tx[uart].pop(0)
+        if len(self._rx[dest]) < DFRobot_IIC_Serial.FIFO_SIZE:
+          self._rx[dest].append(c)
+        else:
+          self.lost += 1
+        self._line[uart] += t
+
+  def _push_tx(self, uart, data):
+    if len(self._tx[uart]) == 0 and self._line[uart] < self.now:
+      self._line[uart] = self.now
+    self._tx[uart] += data[:DFRobot_IIC_Serial.FIFO_SIZE - len(self._tx[uart])]
+
+  def _read_reg(self, uart, reg):
+    s = DFRobot_IIC_Serial
+    page = self._regs.get((uart, 0, s.REG_WK2132_SPAGE), 0)
+    if reg == s.REG_WK2132_GENA:
+      return 0x80 | self._regs.get((uart, 0, reg), 0)
+    if reg == s.REG_WK2132_SPAGE:
+      return page
+    if page == 0:
+      if reg == s.REG_WK2132_RFCNT:
+        return len(self._rx[uart]) & 0xFF
+      if reg == s.REG_WK2132_TFCNT:
+        return len(self._tx[uart]) & 0xFF
+      if reg == s.REG_WK2132_FSR:
+        fsr = 0
+        if len(self._tx[uart]):
+          fsr |= s.sFsrReg_tBusy | s.sFsrReg_tDat
+        if len(self._tx[uart]) == s.FIFO_SIZE:
+          fsr |= s.sFsrReg_tFull
+        if len(self._rx[uart]):
+          fsr |= s.sFsrReg_rDat
+        return fsr
+      if reg == s.REG_WK2132_FDAT:
+        return self._rx[uart].pop(0) if len(self._rx[uart]) else 0
+    return self._regs.get((uart, page, reg), 0)
+
+  def _write_reg(self, uart, reg, val):
+    s = DFRobot_IIC_Serial
+    page = self._regs.get((uart, 0, s.REG_WK2132_SPAGE), 0)
+    if reg == s.REG_WK2132_SPAGE:
+      self._regs[(uart, 0, reg)] = val & 0x01
+    elif page == 0 and reg == s.REG_WK2132_FDAT:
+      self._push_tx(uart, bytearray([val]))
+    elif reg == s.REG_WK2132_GRST:
+      #The reset bits clear automatically and reset the registers of the sub UART
+      for bit in range(2):
+        if val & (1 << bit):
+          other = (uart & ~0x06) | (bit << 1)
+          self._tx[other] = bytearray()
+          self._rx[other] = bytearray()
+          for key in [k for k in self._regs if k[0] == other and k[2] != s.REG_WK2132_GENA and k[2] != s.REG_WK2132_GIER]:
+            del self._regs[key]
+    else:
+      self._regs[(uart, page, reg)] = val
+
+  def transfer(self, msgs):
+    '''!
+      @brief Run the messages as one combined transfer, see DFRobot_IIC_Serial_Bus.transfer()
+    '''
+    if self._realtime:
+      self._run_line()
+    else:
+      bits = 2
+      for addr, data in msgs:
+        bits += 9 * (1 + (len(data) if hasattr(data, '__len__') else data)) + 1
+      self.sleep(self.TRANSFER_OVERHEAD + bits * self._bit_time)
+    self.transactions += 1
+    reads = []
+    for addr, data in msgs:
+      if (addr & 0x78) not in self._modules:
+        raise IOError(121, 'Remote I/O error')
+      uart = addr & 0x7E
+      if hasattr(data, '__len__'):
+        data = bytearray(data)
+        if addr & 0x01:
+          self._push_tx(uart, data)
+        else:
+          self._reg[uart] = data[0]
+          for val in data[1:]:
+            self._write_reg(uart, data[0], val)
+      elif addr & 0x01:
+        r = self._rx[uart][:data]
+        del self._rx[uart][:data]
+        reads.append(r + bytearray(data - len(r)))
+      else:
+        reads.append(bytearray([self._read_reg(uart, self._reg[uart]) for i in range(data)]))
+    return reads
@@ -0,0 +1,74 @@
+from __future__ import print_function
+# -*- coding:utf-8 -*-
+
+'''
+  # demo_baud_switch.py
+  #
+  # brief Measure the time and the bytes lost when a sub UART changes its band rate at runtime, on a simulated bus
+  # Experiment phenomenon: no module is needed. A simulated WK2132 with TX of sub UART1 connected to its RX runs
+  # on a virtual clock, see DFRobot_IIC_Serial_Sim.
+  # For every pair of band rates, SWITCH_BYTES bytes are sent at the old band rate, the band rate is changed,
+  # SWITCH_BYTES bytes are sent at the new one and everything is read back. It is done once with begin() and once
+  # with set_baud(), one CSV line each:
+  # Columns: from, to, method, switch_us (virtual time of the begin() or set_baud() call, after flush()),
+  # iic_trans (IIC transactions of the call), bytes received, bytes lost, bytes corrupted.
+  # begin() resets the sub UART and its FIFOs, so the bytes of the old band rate not read yet are lost,
+  # set_baud() keeps them.
+  #
+  # @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+  # @license     The MIT License (MIT)
+  # @author [Arya](xue.peng@dfrobot.com)
+  # @version  V1.0
+  # @date  2021-05-17
+  # @url https://github.com/DFRobot/DFRobot_IICSerial
+'''
+
+import sys
+import os
+
+sys.path.append(os.path.dirname(os.path.dirname(os.path.realpath(__file__))))
+from DFRobot_IIC_Serial import *
+from DFRobot_IIC_Serial_Sim import *
+
+SWITCH_BYTES = 32              #Bytes sent before and after the switch
+SWITCH_TIMEOUT = 0.5           #Give up reading after this virtual time, the missing bytes are reported as lost
+
+switches = [(9600, 115200), (9600, 921600), (115200, 921600), (921600, 9600), (57600, 460800)]
+
+def run(bus, port, baud, method):
+  data = bytearray([i & 0xFF for i in range(SWITCH_BYTES * 2)])
+  port.write(data[:SWITCH_BYTES])
+  #Send the old data completely, so only the switch itself is timed
+  port.flush()
+  start = bus.now
+  t = bus.transactions
+  if method == "set_baud":
+    port.set_baud(baud)
+  else:
+    port.begin(baud)
+  elapsed = bus.now - start
+  trans = bus.transactions - t
+  port.write(data[SWITCH_BYTES:])
+  r = bytearray()
+  start = bus.now
+  while len(r) < SWITCH_BYTES * 2 and bus.now - start < SWITCH_TIMEOUT:
+    c = port.read(SWITCH_BYTES * 2 - len(r))
+    r += bytearray(c if isinstance(c, bytes) else c.encode('latin-1'))
+    bus.sleep(port._char_time)
+  #The bytes lost by a reset are the first ones, so the rest is compared with the tail of the data
+  lost = SWITCH_BYTES * 2 - len(r)
+  errors = len([i for i in range(len(r)) if r[i] != data[lost + i]])
+  return (elapsed, trans, len(r), lost, errors)
+
+if __name__ == "__main__":
+  #The driver waits on the virtual clock of the simulated bus
+  driver = sys.modules['DFRobot_IIC_Serial']
+  print("from,to,method,switch_us,iic_trans,bytes,lost,errors")
+  for old, new in switches:
+    for method in ["begin", "set_baud"]:
+      bus = DFRobot_IIC_Serial_Sim(bus_hz = 400000, baud = old)
+      driver.time = bus
+      port = DFRobot_IIC_Serial(sub_uart_channel = DFRobot_IIC_Serial.SUBUART_CHANNEL_1, IA1 = 1, IA0 = 1, bus = bus)
+      port.begin(baud = old)
+      elapsed, trans, received, lost, errors = run(bus, port, new, method)
+      print("%d,%d,%s,%d,%d,%d,%d,%d" % (old, new, method, elapsed * 1e6, trans, received, lost, errors))
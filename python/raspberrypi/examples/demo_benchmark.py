@@ -0,0 +1,108 @@
+from __future__ import print_function
+# -*- coding:utf-8 -*-
+
+'''
+  # demo_benchmark.py
+  #
+  # brief Compare the block transfer driver with the per-byte access of driver version 1.0 on a simulated bus
+  # Experiment phenomenon: no module is needed. A simulated WK2132 with TX of sub UART1 connected to its RX runs
+  # on a virtual clock, every transfer costs the bits on the IIC bus plus 60us for the system call, see
+  # DFRobot_IIC_Serial_Sim.
+  # For every IIC bus clock and band rate, both drivers send BENCH_BYTES bytes and read them back, and one CSV line
+  # is printed per driver:
+  # Columns: driver, bus_hz, baud, bytes received, bytes lost, bytes corrupted, bytes/s, iic_trans per byte.
+  # "v1.0" repeats the register accesses of the old driver: FSR read and FDAT write per transmitted byte, RFCNT
+  # reads and one FDAT read per received byte, each one smbus call.
+  #
+  # @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+  # @license     The MIT License (MIT)
+  # @author [Arya](xue.peng@dfrobot.com)
+  # @version  V1.0
+  # @date  2021-05-17
+  # @url https://github.com/DFRobot/DFRobot_IICSerial
+'''
+
+import sys
+import os
+
+sys.path.append(os.path.dirname(os.path.dirname(os.path.realpath(__file__))))
+from DFRobot_IIC_Serial import *
+from DFRobot_IIC_Serial_Sim import *
+
+BENCH_BYTES = 8192             #Payload bytes of every test
+BENCH_CHUNK = 64               #Bytes per write() call
+BENCH_TIMEOUT = 20.0           #Give up a test after this virtual time, the missing bytes are reported as lost
+
+bus_clocks = [100000, 400000, 1000000]
+bauds = [9600, 115200, 460800, 921600]
+
+class LegacyPort(object):
+  '''
+    Register accesses of driver version 1.0, every access one smbus call
+  '''
+  def __init__(self, bus, IA1 = 1, IA0 = 1):
+    self._bus = bus
+    self._addr = (IA1 << 6) | (IA0 << 5) | DFRobot_IIC_Serial.DFROBOT_IICSERIAL_IIC_ADDR_FIXED
+
+  def _read(self, reg):
+    return self._bus.transfer([(self._addr, [reg]), (self._addr, 1)])[0][0]
+
+  def available(self):
+    index = self._read(DFRobot_IIC_Serial.REG_WK2132_RFCNT)
+    if index == 0 and (self._read(DFRobot_IIC_Serial.REG_WK2132_FSR) & DFRobot_IIC_Serial.sFsrReg_rDat):
+      index = 256
+    return index
+
+  def write(self, d):
+    n = 0
+    for c in bytearray(d):
+      if self._read(DFRobot_IIC_Serial.REG_WK2132_FSR) & DFRobot_IIC_Serial.sFsrReg_tFull:
+        break
+      self._bus.transfer([(self._addr, [DFRobot_IIC_Serial.REG_WK2132_FDAT, c])])
+      n += 1
+    return n
+
+  def read(self, size):
+    #v1.0 reads available() two or three times, then FDAT once per byte
+    num = self.available()
+    if size > self.available():
+      size = num
+    return bytearray([self._read(DFRobot_IIC_Serial.REG_WK2132_FDAT) for i in range(min(size, num))])
+
+def run(port, bus):
+  sent = 0
+  received = 0
+  errors = 0
+  while received < BENCH_BYTES and bus.now < BENCH_TIMEOUT:
+    if sent < BENCH_BYTES:
+      n = min(BENCH_CHUNK, BENCH_BYTES - sent)
+      sent += port.write(bytearray([(sent + i) & 0xFF for i in range(n)]))
+    r = port.read(BENCH_BYTES)
+    if not isinstance(r, bytearray):
+      r = bytearray(r if isinstance(r, bytes) else r.encode('latin-1'))
+    for i in range(len(r)):
+      if r[i] != (received + i) & 0xFF:
+        errors += 1
+    received += len(r)
+  return (received, errors)
+
+if __name__ == "__main__":
+  #The driver waits on the virtual clock of the simulated bus
+  driver = sys.modules['DFRobot_IIC_Serial']
+  print("driver,bus_hz,baud,bytes,lost,errors,bytes_per_s,iic_trans_per_byte")
+  for bus_hz in bus_clocks:
+    for baud in bauds:
+      for name in ["v1.0", "block"]:
+        bus = DFRobot_IIC_Serial_Sim(bus_hz = bus_hz, baud = baud)
+        driver.time = bus
+        if name == "block":
+          port = DFRobot_IIC_Serial(sub_uart_channel = DFRobot_IIC_Serial.SUBUART_CHANNEL_1, IA1 = 1, IA0 = 1, bus = bus)
+          port.begin(baud = baud)
+        else:
+          port = LegacyPort(bus)
+        start = bus.now
+        t = bus.transactions
+        received, errors = run(port, bus)
+        elapsed = bus.now - start
+        print("%s,%d,%d,%d,%d,%d,%d,%.2f" % (name, bus_hz, baud, received, max(BENCH_BYTES - received, 0), errors,
+              received / elapsed if elapsed else 0, float(bus.transactions - t) / max(received, 1)))
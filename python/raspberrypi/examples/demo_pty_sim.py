@@ -0,0 +1,135 @@
+from __future__ import print_function
+# -*- coding:utf-8 -*-
+
+'''
+  # demo_pty_sim.py
+  #
+  # brief Check the pseudo terminal daemon end to end on the simulated bus, no module needed
+  # Experiment phenomenon: DFRobot_IIC_Serial_PTY.py is started with --sim, TX of each sub UART connected to RX of
+  # the other. PTY_BYTES bytes are written to each pseudo terminal and must come out of the other one intact. Both
+  # pseudo terminals are then switched to 9600 baud through termios, the daemon must write the new band rate to
+  # the sub UARTs, and data must still cross.
+  # Prints "OK" and returns 0 if everything passed, 1 otherwise, and 77 if pyserial is missing.
+  #
+  # @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+  # @license     The MIT License (MIT)
+  # @author [Arya](xue.peng@dfrobot.com)
+  # @version  V1.0
+  # @date  2021-05-19
+  # @url https://github.com/DFRobot/DFRobot_IICSerial
+'''
+
+import sys
+import os
+import time
+import select
+import termios
+import tty
+import subprocess
+
+PTY_BYTES = 2048               #Bytes sent in each direction at the initial band rate
+TIMEOUT = 20.0                 #Seconds for each step
+LINK = '/tmp/ttyIICsim%d_' % os.getpid()   #Link prefix, the daemon prints <prefix>11_1 -> /dev/pts/N
+
+try:
+  import serial
+except ImportError:
+  print('pyserial is missing, skipped')
+  sys.exit(77)
+
+daemon_path = os.path.join(os.path.dirname(os.path.dirname(os.path.realpath(__file__))), 'DFRobot_IIC_Serial_PTY.py')
+
+def read_line(proc, deadline):
+  line = b''
+  while time.time() < deadline:
+    if select.select([proc.stdout], [], [], 0.1)[0]:
+      c = os.read(proc.stdout.fileno(), 1)
+      if c == b'':
+        break
+      if c == b'\n':
+        return line.decode('latin-1')
+      line += c
+  return None
+
+def open_tty(link, deadline):
+  while not os.path.exists(link):
+    if time.time() > deadline:
+      return None
+    time.sleep(0.01)
+  fd = os.open(link, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+  tty.setraw(fd)
+  return fd
+
+def cross(src, dst, data):
+  '''!
+    @brief Write data to src and read it back from dst, with the writer blocked by the daemon's back-pressure
+    @return Return the bytes read from dst
+  '''
+  sent = 0
+  got = bytearray()
+  deadline = time.time() + TIMEOUT
+  while len(got) < len(data) and time.time() < deadline:
+    w = [src] if sent < len(data) else []
+    r, w, _ = select.select([dst], w, [], 0.1)
+    if w:
+      try:
+        sent += os.write(src, data[sent:sent + 256])
+      except OSError:
+        pass
+    if r:
+      try:
+        got += os.read(dst, 4096)
+      except OSError:
+        pass
+  return got
+
+def set_baud(fd, speed):
+  attr = termios.tcgetattr(fd)
+  attr[4] = attr[5] = speed
+  termios.tcsetattr(fd, termios.TCSADRAIN, attr)
+
+def check():
+  proc = subprocess.Popen([sys.executable, '-u', daemon_path, '--sim', '--link', LINK], stdout = subprocess.PIPE)
+  fds = []
+  try:
+    deadline = time.time() + TIMEOUT
+    for n in [1, 2]:
+      line = read_line(proc, deadline)
+      print(line)
+      fd = open_tty(line.split(' -> ')[0], deadline) if line is not None else None
+      if fd is None:
+        print('pseudo terminal %d did not come up' % n)
+        return 1
+      fds.append(fd)
+    data = bytearray([(i * 7 + 1) & 0xFF for i in range(PTY_BYTES)])
+    for src, dst in [(0, 1), (1, 0)]:
+      got = cross(fds[src], fds[dst], data)
+      print('%d -> %d: %d of %d bytes' % (src + 1, dst + 1, len(got), len(data)))
+      if got != data:
+        return 1
+
+    for fd in fds:
+      set_baud(fd, termios.B9600)
+    deadline = time.time() + TIMEOUT
+    for n in [1, 2]:
+      line = read_line(proc, deadline)
+      print(line)
+      if line is None or '9600 baud' not in line:
+        print('band rate change did not reach the sub UART')
+        return 1
+    data = data[:256]
+    for src, dst in [(0, 1), (1, 0)]:
+      got = cross(fds[src], fds[dst], data)
+      print('9600 baud %d -> %d: %d of %d bytes' % (src + 1, dst + 1, len(got), len(data)))
+      if got != data:
+        return 1
+    print('OK')
+    return 0
+  finally:
+    for fd in fds:
+      os.close(fd)
+    proc.terminate()
+    proc.wait()
+
+if __name__ == "__main__":
+  sys.exit(check())
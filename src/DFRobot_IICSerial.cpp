@@ -48,25 +48,1318 @@
 #define REG_WK2132_RFTL   0x07   //< Sub UART receive FIFO interrupt trigger configuration register
 #define REG_WK2132_TFTL   0x08   //< Sub UART transmit FIFO interrupt trigger configuration register
 
-DFRobot_IICSerial::DFRobot_IICSerial(TwoWire &wire,  uint8_t subUartChannel, uint8_t IA1, uint8_t IA0){
-  _pWire = &wire;
-  _addr = (IA1 << 6) | (IA0 << 5) | DFROBOT_IICSERIAL_IIC_ADDR_FIXED;
+#define WK2132_SIER_RX_MASK  0x83   //< RFTRIG_IEN | RXOVT_IEN | FERR_IEN
+#define WK2132_SIER_TX_MASK  0x04   //< TFTRIG_IEN
+#define WK2132_SIER_TFEMPTY  0x08   //< TFEMPTY_IEN
+#define WK2132_SIER_RXOVT    0x02   //< RXOVT_IEN
+#define WK2132_FCR_RST_MASK  0x03   //< TFRST | RFRST, clear automatically once the reset is done
+#define WK2132_SCR_SLEEPEN   0x04   //< SLEEPEN
+#define WK2132_PAGE_UNKNOWN  0xFF
+
+#ifdef DFROBOT_IICSERIAL_THREAD_SAFE
+#define DFROBOT_IICSERIAL_LOCK(pBus)            DFRobot_IICSerialLock busLock(pBus)
+#define DFROBOT_IICSERIAL_ACQUIRE(index)        __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define DFROBOT_IICSERIAL_RELEASE(index, val)   __atomic_store_n(&(index), (val), __ATOMIC_RELEASE)
+#else
+#define DFROBOT_IICSERIAL_LOCK(pBus)
+#define DFROBOT_IICSERIAL_ACQUIRE(index)        (index)
+#define DFROBOT_IICSERIAL_RELEASE(index, val)   ((index) = (val))
+#endif
+#define DFROBOT_IICSERIAL_PORT_LOCK()           DFROBOT_IICSERIAL_LOCK((_pChip == NULL) ? NULL : _pChip->_pBus)
+
+#ifdef DFROBOT_IICSERIAL_STATS
+#define DFROBOT_IICSERIAL_STAT_ADD(pPort, field, n)  do{ if((pPort) != NULL){ (pPort)->_stats.field += (n); } }while(0)
+#else
+#define DFROBOT_IICSERIAL_STAT_ADD(pPort, field, n)
+#endif
+
+DFRobot_IICSerialChip DFRobot_IICSerialChip::_chips[DFROBOT_IICSERIAL_CHIP_MAX];
+DFRobot_IICSerialWireTransport DFRobot_IICSerialWireTransport::_pool[DFROBOT_IICSERIAL_CHIP_MAX];
+uint8_t DFRobot_IICSerialChip::_rrStart = 0;
+
+DFRobot_IICSerialBase::DFRobot_IICSerialBase(DFRobot_IICSerialTransport *pBus, uint8_t subUartChannel, uint8_t IA1, uint8_t IA0,
+                                             uint8_t *pRxBuffer, uint8_t *pRxError, uint16_t rxSize, uint8_t *pTxBuffer, uint16_t txSize){
+  uint8_t addr = (IA1 << 6) | (IA0 << 5) | DFROBOT_IICSERIAL_IIC_ADDR_FIXED;
   _subSerialChannel = subUartChannel;
   _rx_buffer_head = 0;
   _rx_buffer_tail = 0;
-  memset(_rx_buffer, 0, sizeof(_rx_buffer));
+  _rxMask = rxSize - 1;
+  _rx_buffer = pRxBuffer;
+  _rx_error = pRxError;
+  memset(_rx_error, 0, (rxSize + 7) / 8);
+  _tx_buffer_head = 0;
+  _tx_buffer_tail = 0;
+  _txMask = txSize - 1;
+  _tx_buffer = pTxBuffer;
+  _txDeferred = false;
+  _rxFIFOPending = false;
+  _txWaitIRQ = false;
+  _sier = 0;
+  _txActive = false;
+  _txQueuedUs = 0;
+  _txTurnaroundUs = 0;
+  _txCallback = NULL;
+  _txIdleUs = 0;
+  _rs485Pin = -1;
+  _rs485ActiveHigh = true;
+  _format = IICSerial_8N1;
+  _baud = 0;
+  _actualBaud = 0;
+  _rxErrorTracking = false;
+  _rxErrorPending = false;
+  _lineErrors = 0;
+  _rxLastUs = 0;
+  _rxIdle = false;
+  _sleeping = false;
+  _autoSleepMs = 0;
+  _activityMs = 0;
+#ifdef DFROBOT_IICSERIAL_ASYNC
+  memset(&_rxTransfer, 0, sizeof(_rxTransfer));
+  memset(&_txTransfer, 0, sizeof(_txTransfer));
+  _rxAsyncBusy = false;
+  _txAsyncBusy = false;
+  _rxWakePending = false;
+  _rxAsyncLeft = 0;
+  _txAsyncLeft = 0;
+  _rxAsyncReg = 0;
+  _rxAsyncVal = 0;
+  _txAsyncReg = 0;
+  _txAsyncVal = 0;
+  _rxAsyncRecount = false;
+  _txAsyncRecount = false;
+#endif
+  resetStats();
+  _pChip = (pBus == NULL) ? NULL : DFRobot_IICSerialChip::getChip(pBus, addr);
+  if(_pChip != NULL){
+      _pChip->attachPort(this, subUartChannel);
+  }
+}
+
+DFRobot_IICSerialBase::~DFRobot_IICSerialBase(){
+  if(_pChip != NULL){
+      _pChip->detachPort(this);
+  }
+}
+
+int DFRobot_IICSerialBase::begin(long unsigned baud, uint8_t format, eCommunicationMode_t mode, eLineBreakOutput_t opt){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  _rx_buffer_head = _rx_buffer_tail;
+  _tx_buffer_head = _tx_buffer_tail;
+  _txActive = false;
+  _sleeping = false;
+  _activityMs = millis();
+  if(_rs485Pin >= 0){
+      digitalWrite(_rs485Pin, _rs485ActiveHigh ? LOW : HIGH);
+  }
+  if(_pChip == NULL){
+      DBG("CHIP POOL FULL!");
+      return DFROBOT_IICSERIAL_ERR_CHIP;
+  }
+  int ret = _pChip->begin();
+  if(ret != DFROBOT_IICSERIAL_ERR_OK){
+      return ret;
+  }
+  subSerialConfig(_subSerialChannel);
+  DBG("OK");
+  setSubSerialBaudRate(baud);
+  setSubSerialConfigReg(format, mode, opt);
+  if(interruptMode()){
+      enterInterruptMode();
+  }
+  return DFROBOT_IICSERIAL_ERR_OK;
+}
+
+int DFRobot_IICSerialBase::reconfigure(unsigned long baud, uint8_t format){
+  if(_pChip == NULL){
+      return DFROBOT_IICSERIAL_ERR_CHIP;
+  }
+  uint8_t flushes = 0;
+  while(true){
+      {
+        DFROBOT_IICSERIAL_PORT_LOCK();
+        uint32_t fosc = _pChip->_fosc;
+        bool baudChanged = (baud != 0) && (baudRate(baudDivisor(baud, fosc), fosc) != _actualBaud);
+        uint8_t lcr = readRegCached(REG_WK2132_LCR);
+        uint8_t val = (lcr & 0xF0) | (format & 0x0F);
+        if(baud != 0){
+            _baud = baud;
+        }
+        if(!baudChanged && (val == lcr)){
+            return DFROBOT_IICSERIAL_ERR_OK;
+        }
+        //Data written before belongs to the old setting, the FIFOs and the receive buffer are kept as they are.
+        //Another task may write between flush() and the lock, so the line is checked again here. After a flush()
+        //timeout the setting is switched anyway.
+        if(isTxComplete() || (flushes > 2)){
+            if(baudChanged){
+                setSubSerialBaudRate(baud);
+            }
+            writeRegCached(REG_WK2132_LCR, val);
+            _format = format & 0x0F;
+            return DFROBOT_IICSERIAL_ERR_OK;
+        }
+      }
+      //Wait without the lock, the other sub UART and other tasks keep the bus meanwhile
+      flush();
+      flushes++;
+  }
+}
+
+void DFRobot_IICSerialBase::end(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  _tx_buffer_head = _tx_buffer_tail;
+  _txActive = false;
+  _sleeping = false;
+  if(_pChip == NULL){
+      return;
+  }
+  subSerialGlobalRegEnable(_subSerialChannel, rst);
+}
+
+int DFRobot_IICSerialBase::available(void){
+  pollTxComplete();
+  pollSleep();
+  if(interruptMode()){
+      DFROBOT_IICSERIAL_PORT_LOCK();
+      _pChip->service();
+      if((DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail) && _rxFIFOPending){
+          fillRxBuffer();
+      }
+      return (uint16_t)(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) - _rx_buffer_tail) & _rxMask;
+  }
+  return (readRxFIFOCount() + ((uint16_t)(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) - _rx_buffer_tail) & _rxMask));
+}
+
+int DFRobot_IICSerialBase::peek(void){
+  if(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail){
+      DFROBOT_IICSERIAL_PORT_LOCK();
+      if(!interruptMode()){
+          fillRxBuffer();
+      }else{
+          _pChip->service();
+          if((DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail) && _rxFIFOPending){
+              fillRxBuffer();
+          }
+      }
+  }
+  if(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail){
+      return -1;
+  }
+  return _rx_buffer[_rx_buffer_tail];
+}
+
+int DFRobot_IICSerialBase::read(void){
+  if(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail){
+      DFROBOT_IICSERIAL_PORT_LOCK();
+      if(!interruptMode()){
+          fillRxBuffer();
+      }else{
+          _pChip->service();
+          if((DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail) && _rxFIFOPending){
+              fillRxBuffer();
+          }
+      }
+  }
+  if(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail){
+      return -1;
+  }
+  unsigned char c = _rx_buffer[_rx_buffer_tail];
+  DFROBOT_IICSERIAL_RELEASE(_rx_buffer_tail, (_rx_buffer_tail + 1) & _rxMask);
+  return c;
+}
+
+size_t DFRobot_IICSerialBase::write(uint8_t value){
+  uint16_t i = (_tx_buffer_head + 1) & _txMask;
+  if(i == DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_tail)){
+      waitTxBuffer();
+      if(i == DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_tail)){
+          DBG("FIFO full!");
+          return 0;
+      }
+  }
+  startTx();
+  _tx_buffer[_tx_buffer_head] = value;
+  DFROBOT_IICSERIAL_RELEASE(_tx_buffer_head, i);
+  if(!_txDeferred){
+      poll();
+  }
+  return 1;
+}
+
+size_t DFRobot_IICSerialBase::write(const uint8_t *pBuf, size_t size){
+  if(pBuf == NULL){
+    DBG("pBuf ERROR!! : null pointer");
+    return 0;
+  }
+  size_t n = 0;
+  if(size == 0){
+      return 0;
+  }
+  startTx();
+  if(!_txDeferred && (_tx_buffer_head == DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_tail))){
+      //Nothing queued ahead of this data, so it may go straight into the FIFO
+      n = writeFIFO((void *)pBuf, size);
+  }
+  while(n < size){
+      uint16_t i = (_tx_buffer_head + 1) & _txMask;
+      if(i == DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_tail)){
+          if(waitTxBuffer() == 0){
+              DBG("FIFO full!");
+              break;
+          }
+          continue;
+      }
+      _tx_buffer[_tx_buffer_head] = pBuf[n++];
+      DFROBOT_IICSERIAL_RELEASE(_tx_buffer_head, i);
+  }
+  if(!_txDeferred){
+      poll();
+  }
+  return n;
+}
+
+int DFRobot_IICSerialBase::availableForWrite(void){
+  return _txMask - ((uint16_t)(_tx_buffer_head - DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_tail)) & _txMask);
+}
+
+size_t DFRobot_IICSerialBase::poll(void){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(interruptMode()){
+      _pChip->service();
+  }
+  size_t num = pumpTxBuffer();
+  if(_rs485Pin >= 0){
+      pollTxComplete();
+  }
+  pollSleep();
+  return num;
+}
+
+bool DFRobot_IICSerialBase::pollAsync(void){
+#ifdef DFROBOT_IICSERIAL_ASYNC
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(_rxWakePending){
+      _rxWakePending = false;
+      rxActivity();
+  }
+  if((_pChip == NULL) || interruptMode() || _rxErrorTracking){
+      poll();
+      if((_pChip != NULL) && !interruptMode()){
+          fillRxBuffer();
+      }
+      return false;
+  }
+  _pChip->_pBus->poll();
+  if(!_rxAsyncBusy && rxBufferSpace()){
+      _rxAsyncBusy = true;
+      _rxAsyncReg = REG_WK2132_RFCNT;
+      _rxAsyncRecount = false;
+      _rxTransfer.pTx = &_rxAsyncReg;
+      _rxTransfer.txSize = 1;
+      _rxTransfer.pRx = &_rxAsyncVal;
+      _rxTransfer.rxSize = 1;
+      _rxTransfer.callback = rxCountDone;
+      _rxTransfer.pContext = this;
+      if(_pChip->submit(_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER, &_rxTransfer) != 0){
+          _rxAsyncBusy = false;
+      }
+  }
+  if(!_txAsyncBusy && (DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_head) != _tx_buffer_tail)){
+      _txAsyncBusy = true;
+      _txAsyncReg = REG_WK2132_TFCNT;
+      _txAsyncRecount = false;
+      _txTransfer.pTx = &_txAsyncReg;
+      _txTransfer.txSize = 1;
+      _txTransfer.pRx = &_txAsyncVal;
+      _txTransfer.rxSize = 1;
+      _txTransfer.callback = txSpaceDone;
+      _txTransfer.pContext = this;
+      if(_pChip->submit(_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER, &_txTransfer) != 0){
+          _txAsyncBusy = false;
+      }
+  }
+  if(!_txAsyncBusy){
+      pollTxComplete();
+  }
+  if(!_rxAsyncBusy && !_txAsyncBusy){
+      pollSleep();
+  }
+  return _rxAsyncBusy || _txAsyncBusy;
+#else
+  poll();
+  if((_pChip != NULL) && !interruptMode()){
+      fillRxBuffer();
+  }
+  return false;
+#endif
+}
+
+#ifdef DFROBOT_IICSERIAL_ASYNC
+void DFRobot_IICSerialBase::rxCountDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer){
+  DFRobot_IICSerialBase *pPort = (DFRobot_IICSerialBase *)pTransfer->pContext;
+  if(pTransfer->result != 0){
+      pPort->_rxAsyncBusy = false;
+      return;
+  }
+  if(pPort->_rxAsyncReg == REG_WK2132_RFCNT){
+      if((pPort->_rxAsyncVal == 0) && !pPort->_rxAsyncRecount){
+          //RFCNT is 0 for a null and a full FIFO alike, FSR tells them apart
+          pPort->_rxAsyncReg = REG_WK2132_FSR;
+          if(pPort->_pChip->submit(pPort->_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER, pTransfer) != 0){
+              pPort->_rxAsyncBusy = false;
+          }
+          return;
+      }
+      pPort->_rxAsyncLeft = ((pPort->_rxAsyncVal == 0) && pPort->_rxAsyncRecount) ? 256 : pPort->_rxAsyncVal;
+  }else{
+      sFsrReg_t fsr = *((sFsrReg_t *)(&pPort->_rxAsyncVal));
+      if(fsr.rDat){
+          //RDAT is also set by a byte that arrived after RFCNT read 0, only a full FIFO still reads 0
+          pPort->_rxAsyncReg = REG_WK2132_RFCNT;
+          pPort->_rxAsyncRecount = true;
+          if(pPort->_pChip->submit(pPort->_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER, pTransfer) != 0){
+              pPort->_rxAsyncBusy = false;
+          }
+          return;
+      }
+      pPort->_rxAsyncLeft = 0;
+  }
+  pPort->submitRxData();
+}
+
+void DFRobot_IICSerialBase::submitRxData(){
+  size_t n = rxBufferSpace();
+  _rxFIFOPending = (_rxAsyncLeft > n);
+  //Only the contiguous free space at the head, the rest follows with the next burst
+  if(n > (size_t)_rxMask + 1 - _rx_buffer_head){
+      n = (size_t)_rxMask + 1 - _rx_buffer_head;
+  }
+  if(n > _rxAsyncLeft){
+      n = _rxAsyncLeft;
+  }
+  if(n > _pChip->_pBus->getMaxTransfer()){
+      n = _pChip->_pBus->getMaxTransfer();
+  }
+  if(n == 0){
+      _rxAsyncBusy = false;
+      return;
+  }
+  _rxTransfer.pTx = NULL;
+  _rxTransfer.txSize = 0;
+  _rxTransfer.pRx = _rx_buffer + _rx_buffer_head;
+  _rxTransfer.rxSize = n;
+  _rxTransfer.callback = rxDataDone;
+  if(_pChip->submit(_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_FIFO, &_rxTransfer) != 0){
+      _rxAsyncBusy = false;
+  }
+}
+
+void DFRobot_IICSerialBase::rxDataDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer){
+  DFRobot_IICSerialBase *pPort = (DFRobot_IICSerialBase *)pTransfer->pContext;
+  if(pTransfer->result != 0){
+      pPort->_rxAsyncBusy = false;
+      return;
+  }
+  DFROBOT_IICSERIAL_STAT_ADD(pPort, rxBytes, pTransfer->rxSize);
+  DFROBOT_IICSERIAL_RELEASE(pPort->_rx_buffer_head, (pPort->_rx_buffer_head + pTransfer->rxSize) & pPort->_rxMask);
+  pPort->_rxAsyncLeft -= pTransfer->rxSize;
+  pPort->_rxLastUs = micros();
+  pPort->_rxIdle = false;
+  pPort->_activityMs = millis();
+  if(pPort->_sleeping){
+      pPort->_rxWakePending = true;
+  }
+  pPort->submitRxData();
+}
+
+void DFRobot_IICSerialBase::txSpaceDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer){
+  DFRobot_IICSerialBase *pPort = (DFRobot_IICSerialBase *)pTransfer->pContext;
+  if(pTransfer->result != 0){
+      pPort->_txAsyncBusy = false;
+      return;
+  }
+  if(pPort->_txAsyncReg == REG_WK2132_TFCNT){
+      if((pPort->_txAsyncVal == 0) && !pPort->_txAsyncRecount){
+          //TFCNT is 0 for a null and a full FIFO alike, FSR tells them apart
+          pPort->_txAsyncReg = REG_WK2132_FSR;
+          if(pPort->_pChip->submit(pPort->_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER, pTransfer) != 0){
+              pPort->_txAsyncBusy = false;
+          }
+          return;
+      }
+      pPort->_txAsyncLeft = 256 - pPort->_txAsyncVal;
+  }else{
+      sFsrReg_t fsr = *((sFsrReg_t *)(&pPort->_txAsyncVal));
+      if(!fsr.tFull){
+          //TFULL is also clear when a character left a full FIFO after TFCNT read 0, only an empty FIFO still reads 0
+          pPort->_txAsyncReg = REG_WK2132_TFCNT;
+          pPort->_txAsyncRecount = true;
+          if(pPort->_pChip->submit(pPort->_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER, pTransfer) != 0){
+              pPort->_txAsyncBusy = false;
+          }
+          return;
+      }
+      pPort->_txAsyncLeft = 0;
+  }
+  pPort->submitTxData();
+}
+
+void DFRobot_IICSerialBase::submitTxData(){
+  size_t n = (uint16_t)(DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_head) - _tx_buffer_tail) & _txMask;
+  //Only the contiguous data at the tail, the rest follows with the next burst
+  if(n > (size_t)_txMask + 1 - _tx_buffer_tail){
+      n = (size_t)_txMask + 1 - _tx_buffer_tail;
+  }
+  if(n > _txAsyncLeft){
+      n = _txAsyncLeft;
+  }
+  if(n > _pChip->_pBus->getMaxTransfer()){
+      n = _pChip->_pBus->getMaxTransfer();
+  }
+  if(n == 0){
+      _txAsyncBusy = false;
+      return;
+  }
+  _txTransfer.pTx = _tx_buffer + _tx_buffer_tail;
+  _txTransfer.txSize = n;
+  _txTransfer.pRx = NULL;
+  _txTransfer.rxSize = 0;
+  _txTransfer.callback = txDataDone;
+  if(_pChip->submit(_subSerialChannel, DFROBOT_IICSERIAL_OBJECT_FIFO, &_txTransfer) != 0){
+      _txAsyncBusy = false;
+  }
+}
+
+void DFRobot_IICSerialBase::txDataDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer){
+  DFRobot_IICSerialBase *pPort = (DFRobot_IICSerialBase *)pTransfer->pContext;
+  if(pTransfer->result != 0){
+      pPort->_txAsyncBusy = false;
+      return;
+  }
+  DFROBOT_IICSERIAL_STAT_ADD(pPort, txBytes, pTransfer->txSize);
+  DFROBOT_IICSERIAL_RELEASE(pPort->_tx_buffer_tail, (pPort->_tx_buffer_tail + pTransfer->txSize) & pPort->_txMask);
+  pPort->_txAsyncLeft -= pTransfer->txSize;
+  pPort->submitTxData();
+}
+#endif
+
+size_t DFRobot_IICSerialBase::waitTxBuffer(){
+#ifdef DFROBOT_IICSERIAL_STATS
+  uint32_t t = micros();
+  size_t num = poll();
+  _stats.txStalls++;
+  _stats.txBlockedUs += micros() - t;
+  return num;
+#else
+  return poll();
+#endif
+}
+
+size_t DFRobot_IICSerialBase::pumpTxBuffer(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(!interruptMode()){
+      return drainTxBuffer();
+  }
+  if(_txWaitIRQ){
+      return 0;
+  }
+  size_t num = drainTxBuffer();
+  updateTxInterrupt();
+  return num;
+}
+
+size_t DFRobot_IICSerialBase::drainTxBuffer(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  size_t num = (uint16_t)(DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_head) - _tx_buffer_tail) & _txMask;
+#ifdef DFROBOT_IICSERIAL_ASYNC
+  if(_txAsyncBusy){
+      return 0;
+  }
+#endif
+  if(num == 0){
+      return 0;
+  }
+  size_t space = readTxFIFOSpace();
+  if(num > space){
+      num = space;
+  }
+  size_t left = num;
+  while(left){
+      //The ring may wrap, so send it in at most two contiguous pieces
+      size_t n = (size_t)_txMask + 1 - _tx_buffer_tail;
+      if(n > left){
+          n = left;
+      }
+      size_t ret = writeFIFOBurst(_tx_buffer + _tx_buffer_tail, n);
+      DFROBOT_IICSERIAL_RELEASE(_tx_buffer_tail, (_tx_buffer_tail + ret) & _txMask);
+      left -= ret;
+      if(ret != n){
+          DBG("WRITE FIFO ERROR!");
+          break;
+      }
+  }
+  return num - left;
+}
+
+size_t DFRobot_IICSerialBase::read(void *pBuf, size_t size){
+  if(pBuf == NULL){
+    DBG("pBuf ERROR!! : null pointer");
+    return 0;
+  }
+  uint8_t *_pBuf = (uint8_t *)pBuf;
+  size_t num = 0, n = 0;
+  //Data already in _rx_buffer is older than the FIFO, so it goes first
+  num = copyRxBuffer(_pBuf, size);
+  if(num == size){
+      return num;
+  }
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(interruptMode()){
+      _pChip->service();
+      //The interrupt handler may have refilled _rx_buffer
+      num += copyRxBuffer(_pBuf + num, size - num);
+      if((num == size) || !_rxFIFOPending){
+          return num;
+      }
+  }
+  if(_rxErrorTracking){
+      //The line status is kept per byte of _rx_buffer, so the data has to go through it
+      while((num < size) && fillRxBuffer()){
+          num += copyRxBuffer(_pBuf + num, size - num);
+      }
+      return num;
+  }
+#ifdef DFROBOT_IICSERIAL_THREAD_SAFE
+  //Another task may have moved FIFO data into _rx_buffer before the lock was taken
+  num += copyRxBuffer(_pBuf + num, size - num);
+  if(num == size){
+      return num;
+  }
+#endif
+  n = readRxFIFOCount();
+  _rxFIFOPending = (n > size - num);
+  if(n > size - num){
+      n = size - num;
+  }
+  n = readFIFO(_pBuf + num, n);
+  if(n){
+      rxActivity();
+  }
+  return num + n;
+}
+
+size_t DFRobot_IICSerialBase::copyRxBuffer(uint8_t *pBuf, size_t size){
+  const uint8_t *pData = NULL;
+  size_t num = 0, n = 0;
+  while((num < size) && ((n = rxBufferSpan(&pData)) != 0)){
+      if(n > size - num){
+          n = size - num;
+      }
+      memcpy(pBuf + num, pData, n);
+      consume(n);
+      num += n;
+  }
+  return num;
+}
+
+size_t DFRobot_IICSerialBase::peekSpan(const uint8_t **ppData){
+  if(ppData == NULL){
+    DBG("ppData ERROR!! : null pointer");
+    return 0;
+  }
+  if(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail){
+      DFROBOT_IICSERIAL_PORT_LOCK();
+      if(!interruptMode()){
+          fillRxBuffer();
+      }else{
+          _pChip->service();
+          if((DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) == _rx_buffer_tail) && _rxFIFOPending){
+              fillRxBuffer();
+          }
+      }
+  }
+  return rxBufferSpan(ppData);
+}
+
+size_t DFRobot_IICSerialBase::rxBufferSpan(const uint8_t **ppData){
+  uint16_t head = DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head);
+  *ppData = _rx_buffer + _rx_buffer_tail;
+  if(head >= _rx_buffer_tail){
+      return head - _rx_buffer_tail;
+  }
+  return (size_t)_rxMask + 1 - _rx_buffer_tail;
+}
+
+void DFRobot_IICSerialBase::consume(size_t size){
+  size_t used = (uint16_t)(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) - _rx_buffer_tail) & _rxMask;
+  if(size > used){
+      size = used;
+  }
+  DFROBOT_IICSERIAL_RELEASE(_rx_buffer_tail, (_rx_buffer_tail + size) & _rxMask);
+}
+
+void DFRobot_IICSerialBase::flush(void){
+  uint32_t baud = _actualBaud ? _actualBaud : 2400;
+  //The software transmit buffer and the 256 bytes FIFO at up to 12 bits per character, plus some margin
+  uint32_t timeout = ((uint32_t)_txMask + 1 + 256) * 12 * 1000 / baud + 20;
+  //Check the line about once per character time instead of keeping the bus busy
+  uint32_t charUs = 10000000UL / baud;
+  if(charUs > 10000){
+      charUs = 10000;
+  }
+  uint32_t t = millis();
+  while(!isTxComplete()){
+      if(millis() - t > timeout){
+          DBG("FLUSH TIMEOUT!");
+          break;
+      }
+      delayMicroseconds(charUs);
+  }
+}
+
+bool DFRobot_IICSerialBase::isTxComplete(){
+  if(!_txActive){
+      return true;
+  }
+  poll();
+  if(DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_head) != _tx_buffer_tail){
+      return false;
+  }
+  if(interruptMode()){
+      //The transmit FIFO null interrupt finishes the transmission in serviceInterrupt()
+      return !_txActive;
+  }
+  return checkTxComplete();
+}
+
+bool DFRobot_IICSerialBase::checkTxComplete(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(!_txActive){
+      return true;
+  }
+  if((DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_head) != _tx_buffer_tail) || (_pChip == NULL)){
+      return false;
+  }
+  sFsrReg_t fsr = readFIFOStateReg();
+  if(fsr.tDat || fsr.tBusy){
+      return false;
+  }
+  if(_rs485Pin >= 0){
+      digitalWrite(_rs485Pin, _rs485ActiveHigh ? LOW : HIGH);
+  }
+  _txIdleUs = micros();
+  _txTurnaroundUs = _txIdleUs - _txQueuedUs;
+  _txActive = false;
+  if(interruptMode()){
+      updateTxInterrupt();
+  }
+  if(_txCallback != NULL){
+      _txCallback(this);
+  }
+  return true;
+}
+
+void DFRobot_IICSerialBase::pollTxComplete(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(_txActive && ((_txCallback != NULL) || (_rs485Pin >= 0)) && !interruptMode()){
+      checkTxComplete();
+  }
+}
+
+void DFRobot_IICSerialBase::startTx(){
+  if(!_txActive && (_rs485Pin >= 0)){
+      //Keep the line idle for the inter-frame gap after the previous frame before driving it again. The wait is
+      //outside the lock, the other sub UART and other tasks keep the IIC bus meanwhile
+      uint32_t gap = getInterFrameGap();
+      while(micros() - _txIdleUs < gap);
+  }
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(!_txActive && (_rs485Pin >= 0)){
+      digitalWrite(_rs485Pin, _rs485ActiveHigh ? HIGH : LOW);
+  }
+  if(_sleeping){
+      wakeup();
+  }
+  _txActive = true;
+  _txQueuedUs = micros();
+  _activityMs = millis();
+}
+
+void DFRobot_IICSerialBase::enableRS485(uint8_t dePin, bool deActiveHigh){
+  _rs485Pin = dePin;
+  _rs485ActiveHigh = deActiveHigh;
+  pinMode(dePin, OUTPUT);
+  digitalWrite(dePin, (deActiveHigh == _txActive) ? HIGH : LOW);
+}
+
+void DFRobot_IICSerialBase::disableRS485(){
+  if(_rs485Pin < 0){
+      return;
+  }
+  digitalWrite(_rs485Pin, _rs485ActiveHigh ? LOW : HIGH);
+  _rs485Pin = -1;
+}
+
+uint32_t DFRobot_IICSerialBase::getCharTime(){
+  if(_actualBaud == 0){
+      return 0;
+  }
+  //Start bit, 8 data bits, parity bit if PAEN, 1 or 2 stop bits by STPL
+  uint32_t bits = 10 + ((_format & 0x08) ? 1 : 0) + (_format & 0x01);
+  return (bits * 1000000UL + _actualBaud - 1) / _actualBaud;
+}
+
+uint32_t DFRobot_IICSerialBase::getInterFrameGap(){
+  if(_actualBaud > 19200){
+      return 1750;
+  }
+  return (getCharTime() * 7 + 1) / 2;
+}
+
+int DFRobot_IICSerialBase::readRxFIFOCount(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  uint8_t val = 0;
+  if(readReg(REG_WK2132_RFCNT, &val, 1) != 1){
+      DBG("READ BYTE SIZE ERROR!");
+      return 0;
+  }
+  if(val == 0){
+      sFsrReg_t fsr = readFIFOStateReg();
+      if(fsr.rDat == 1){
+          //RDAT is also set by a byte that arrived after RFCNT read 0, a full FIFO still reads 0
+          if(readReg(REG_WK2132_RFCNT, &val, 1) != 1){
+              DBG("READ BYTE SIZE ERROR!");
+              return 0;
+          }
+          return (val == 0) ? 256 : (int)val;
+      }
+  }
+  return (int)val;
+}
+
+int DFRobot_IICSerialBase::readTxFIFOSpace(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  uint8_t val = 0;
+  if(readReg(REG_WK2132_TFCNT, &val, 1) != 1){
+      DBG("READ BYTE SIZE ERROR!");
+      return 0;
+  }
+  if(val == 0){
+      sFsrReg_t fsr = readFIFOStateReg();
+      if(fsr.tFull == 1){
+          DBG("FIFO full!");
+          return 0;
+      }
+      //TFULL is also clear when a character left a full FIFO after TFCNT read 0, only an empty FIFO still reads 0
+      if(readReg(REG_WK2132_TFCNT, &val, 1) != 1){
+          DBG("READ BYTE SIZE ERROR!");
+          return 0;
+      }
+  }
+  return 256 - (int)val;
+}
+
+size_t DFRobot_IICSerialBase::fillRxBuffer(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(rxBufferSpace() == 0){
+      return 0;
+  }
+  return fillRxBuffer(readRxFIFOCount());
+}
+
+size_t DFRobot_IICSerialBase::rxBufferSpace(){
+  size_t used = (uint16_t)(_rx_buffer_head - DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_tail)) & _rxMask;
+  return _rxMask - used;
+}
+
+size_t DFRobot_IICSerialBase::fillRxBuffer(size_t num){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+#ifdef DFROBOT_IICSERIAL_ASYNC
+  if(_rxAsyncBusy){
+      return 0;
+  }
+#endif
+  size_t space = rxBufferSpace();
+  _rxFIFOPending = (num > space);
+  if(num > space){
+      num = space;
+  }
+  size_t left = num;
+  if(_rxErrorTracking && num && rxFIFOHasError()){
+      num = fillRxBufferChecked(num);
+      //A part of the erroneous data may still be left in the FIFO
+      _rxErrorPending = _rxFIFOPending;
+      left = 0;
+  }
+  while(left){
+      //The ring may wrap, so copy it in at most two contiguous pieces
+      size_t n = (size_t)_rxMask + 1 - _rx_buffer_head;
+      if(n > left){
+          n = left;
+      }
+      if(readFIFO(_rx_buffer + _rx_buffer_head, n) != n){
+          DBG("READ FIFO ERROR!");
+          break;
+      }
+      if(_rxErrorTracking){
+          for(size_t i = 0; i < n; i++){
+              uint16_t index = _rx_buffer_head + i;
+              _rx_error[index >> 3] &= ~(1 << (index & 0x07));
+          }
+      }
+      DFROBOT_IICSERIAL_RELEASE(_rx_buffer_head, (_rx_buffer_head + n) & _rxMask);
+      left -= n;
+  }
+  if(left != num){
+      rxActivity();
+  }
+  return num - left;
+}
+
+size_t DFRobot_IICSerialBase::fillRxBufferChecked(size_t num){
+  uint8_t val = 0, lsr = 0;
+  size_t i = 0;
+  for(i = 0; i < num; i++){
+      //LSR holds the status of the byte at the front of the FIFO
+      if(readReg(REG_WK2132_LSR, &lsr, 1) != 1){
+          DBG("READ LSR ERROR!");
+          break;
+      }
+      if(readFIFO(&val, 1) != 1){
+          DBG("READ FIFO ERROR!");
+          break;
+      }
+      lsr &= DFROBOT_IICSERIAL_LINE_ERR_MASK;
+      _lineErrors |= lsr;
+      _rx_buffer[_rx_buffer_head] = val;
+      if(lsr){
+          _rx_error[_rx_buffer_head >> 3] |= (1 << (_rx_buffer_head & 0x07));
+      }else{
+          _rx_error[_rx_buffer_head >> 3] &= ~(1 << (_rx_buffer_head & 0x07));
+      }
+      DFROBOT_IICSERIAL_RELEASE(_rx_buffer_head, (_rx_buffer_head + 1) & _rxMask);
+  }
+  return i;
+}
+
+bool DFRobot_IICSerialBase::rxFIFOHasError(){
+  if(interruptMode()){
+      return _rxErrorPending;
+  }
+  sFsrReg_t fsr = readFIFOStateReg();
+  return fsr.rFpe || fsr.rFfe || fsr.rFbi || fsr.rFoe;
+}
+
+void DFRobot_IICSerialBase::setRxErrorTracking(bool enable){
+  if(enable != _rxErrorTracking){
+      //Stale marks would otherwise show up in peekError() once tracking is off
+      memset(_rx_error, 0, ((size_t)_rxMask + 8) / 8);
+  }
+  _rxErrorTracking = enable;
+  _rxErrorPending = false;
+}
+
+bool DFRobot_IICSerialBase::peekError(size_t size){
+  size_t used = (uint16_t)(DFROBOT_IICSERIAL_ACQUIRE(_rx_buffer_head) - _rx_buffer_tail) & _rxMask;
+  if(size > used){
+      size = used;
+  }
+  uint16_t index = _rx_buffer_tail;
+  for(size_t i = 0; i < size; i++){
+      if(_rx_error[index >> 3] & (1 << (index & 0x07))){
+          return true;
+      }
+      index = (index + 1) & _rxMask;
+  }
+  return false;
+}
+
+uint8_t DFRobot_IICSerialBase::getLineErrors(){
+  uint8_t errors = _lineErrors;
+  _lineErrors = 0;
+  return errors;
+}
+
+bool DFRobot_IICSerialBase::isRxIdle(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(_rxIdle){
+      return true;
+  }
+  if((micros() - _rxLastUs) < getInterFrameGap()){
+      return false;
+  }
+  if(interruptMode()){
+      size_t num = readRxFIFOCount();
+      if(num){
+          fillRxBuffer(num);
+          return false;
+      }
+      _rxIdle = true;
+  }
+  return true;
+}
+
+int DFRobot_IICSerialBase::attachInterruptPin(uint8_t pin){
+  if(_pChip == NULL){
+      return -1;
+  }
+  return _pChip->attachInterruptPin(pin);
+}
+
+void DFRobot_IICSerialBase::detachInterruptPin(){
+  if(_pChip != NULL){
+      _pChip->detachInterruptPin();
+  }
+}
+
+void DFRobot_IICSerialBase::enterInterruptMode(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  _rxFIFOPending = true;
+  _txWaitIRQ = false;
+  _sier &= WK2132_SIER_RX_MASK;
+  writeRegCached(REG_WK2132_SIER, _sier);
+}
+
+void DFRobot_IICSerialBase::serviceInterrupt(){
+  uint8_t val = 0;
+  readReg(REG_WK2132_SIFR, &val, 1);
+  sSifrReg_t sifr = *((sSifrReg_t *)(&val));
+  if(sifr.tfTrig || sifr.tFEmpty){
+      _txWaitIRQ = false;
+  }
+  if(sifr.tFEmpty && (_sier & WK2132_SIER_TFEMPTY)){
+      //The last byte may still be shifting out, the interrupt stays asserted until checkTxComplete() succeeds
+      checkTxComplete();
+  }
+#ifdef DFROBOT_IICSERIAL_STATS
+  if(sifr.fErr){
+      readFIFOStateReg();//Count the error
+  }
+#endif
+  if(sifr.fErr){
+      _rxErrorPending = true;
+  }
+  if(sifr.rFTrig || sifr.rxOvt || sifr.fErr){
+      _rxFIFOPending = true;
+      fillRxBuffer();
+  }
+  if(sifr.rxOvt){
+      //The timeout fires once the line has been idle for a while with data left in the FIFO
+      _rxIdle = true;
+  }
+}
+
+void DFRobot_IICSerialBase::updateTxInterrupt(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  bool wait = (DFROBOT_IICSERIAL_ACQUIRE(_tx_buffer_head) != _tx_buffer_tail);
+  uint8_t sier = _sier & ~(WK2132_SIER_TX_MASK | WK2132_SIER_TFEMPTY);
+  if(wait){
+      sier |= WK2132_SIER_TX_MASK;
+  }else if(_txActive){
+      sier |= WK2132_SIER_TFEMPTY;
+  }
+  _txWaitIRQ = wait;
+  if(sier != _sier){
+      _sier = sier;
+      writeRegCached(REG_WK2132_SIER, _sier);
+  }
+}
+
+void DFRobot_IICSerialBase::setFIFOTriggerLevel(uint8_t rxLevel, uint8_t txLevel){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  subSerialPageSwitch(page1);
+  writeRegCached(REG_WK2132_RFTL, rxLevel);
+  writeRegCached(REG_WK2132_TFTL, txLevel);
+  subSerialPageSwitch(page0);
+}
+
+void DFRobot_IICSerialBase::setRxTimeoutInterrupt(bool enable){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(enable){
+      _sier |= WK2132_SIER_RXOVT;
+  }else{
+      _sier &= ~WK2132_SIER_RXOVT;
+  }
+  writeRegCached(REG_WK2132_SIER, _sier);
+}
+
+void DFRobot_IICSerialBase::subSerialConfig(uint8_t subUartChannel){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  DBG("Sub UART clock enable");
+  subSerialGlobalRegEnable(subUartChannel, clock);
+  DBG("Software reset sub UART");
+  subSerialGlobalRegEnable(subUartChannel, rst);
+  DBG("Sub UART global interrupt enable");
+  subSerialGlobalRegEnable(subUartChannel, intrpt);
+  DBG("Sub UART page register setting (default PAGE0)");
+  subSerialPageSwitch(page0);
+  DBG("Sub interrupt setting");
+  sSierReg_t sier = {.rFTrig = 0x01, .rxOvt = 0x01, .tfTrig = 0x01, .tFEmpty = 0x01, .rsv = 0x00, .fErr = 0x01};
+  subSerialRegConfig(REG_WK2132_SIER, &sier);
+  _sier = *(uint8_t *)&sier;
+  DBG("enable transmit/receive FIFO");
+  sFcrReg_t fcr = {.rfRst = 0x01, .tfRst = 0x00, .rfEn = 0x01, .tfEn = 0x01, .rfTrig = 0x00, .tfTrig = 0x00};
+  subSerialRegConfig(REG_WK2132_FCR, &fcr);
+  DBG("Sub UART reiceive/transmit enable");
+  sScrReg_t scr = {.rxEn = 0x01, .txEn = 0x01, .sleepEn = 0x00, .rsv = 0x00 };
+  subSerialRegConfig(REG_WK2132_SCR, &scr);
+}
+
+void DFRobot_IICSerialBase::subSerialGlobalRegEnable(uint8_t subUartChannel, eGlobalRegType_t type){
+  _pChip->globalRegEnable(subUartChannel, type);
+}
+
+void DFRobot_IICSerialBase::subSerialPageSwitch(ePageNumber_t page){
+  _pChip->pageSwitch(_subSerialChannel, page);
+}
+
+void DFRobot_IICSerialBase::subSerialRegConfig(uint8_t reg, void *pValue){
+  uint8_t val = readRegCached(reg);
+  DBG("before: "); DBG(val);
+  val |= *(uint8_t *)pValue;
+  writeRegCached(reg, val);
+}
+
+uint8_t DFRobot_IICSerialBase::readRegCached(uint8_t reg){
+  return _pChip->readRegCached(_subSerialChannel, reg);
+}
+
+void DFRobot_IICSerialBase::writeRegCached(uint8_t reg, uint8_t val){
+  _pChip->writeRegCached(_subSerialChannel, reg, val);
+}
+
+void DFRobot_IICSerialBase::setSubSerialBaudRate(unsigned long baud){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  uint32_t fosc = _pChip->_fosc;
+  uint32_t divisor = baudDivisor(baud, fosc);
+  uint8_t baud1 = (uint8_t)((divisor / 10) >> 8);
+  uint8_t baud0 = (uint8_t)((divisor / 10) & 0xFF);
+  uint8_t baudPres = (uint8_t)(divisor % 10);
+  _baud = baud;
+  _actualBaud = baudRate(divisor, fosc);
+  uint8_t scr = readRegCached(REG_WK2132_SCR);
+  writeRegCached(REG_WK2132_SCR, 0x00);
+  subSerialPageSwitch(page1);
+  writeRegCached(REG_WK2132_BAUD1, baud1);
+  writeRegCached(REG_WK2132_BAUD0, baud0);
+  writeRegCached(REG_WK2132_PRES, baudPres);
+  DBG(baud1, HEX);
+  DBG(baud0, HEX);
+  DBG(baudPres, HEX);
+  subSerialPageSwitch(page0);
+  writeRegCached(REG_WK2132_SCR, scr);
+}
+
+void DFRobot_IICSerialBase::setCrystalFrequency(uint32_t fosc){
+  if(_pChip != NULL){
+      _pChip->_fosc = fosc;
+  }
+}
+
+float DFRobot_IICSerialBase::getBaudError(){
+  if(_baud == 0){
+      return 0;
+  }
+  return ((float)_actualBaud - (float)_baud) * 100 / (float)_baud;
+}
+
+void DFRobot_IICSerialBase::setSubSerialConfigReg(uint8_t format, eCommunicationMode_t mode, eLineBreakOutput_t opt){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  uint8_t _mode = (uint8_t)mode;
+  uint8_t _opt = (uint8_t)opt;
+  uint8_t val = readRegCached(REG_WK2132_LCR);
+  DBG("before: "); DBG(val, HEX);
+  sLcrReg_t lcr = *((sLcrReg_t *)(&val));
+  lcr.format = format;
+  _format = format;
+  lcr.irEn = _mode;
+  lcr.lBreak = _opt;
+  val = *(uint8_t *)&lcr;
+  writeRegCached(REG_WK2132_LCR, val);
+}
+
+DFRobot_IICSerialBase::sFsrReg_t DFRobot_IICSerialBase::readFIFOStateReg(){
+  sFsrReg_t fsr;
+  readReg(REG_WK2132_FSR, &fsr, sizeof(fsr));
+#ifdef DFROBOT_IICSERIAL_STATS
+  _stats.rxOverruns += fsr.rFoe;
+  _stats.parityErrors += fsr.rFpe;
+  _stats.frameErrors += fsr.rFfe;
+  _stats.lineBreaks += fsr.rFbi;
+#endif
+  return fsr;
+}
+
+DFRobot_IICSerialBase::sStats_t DFRobot_IICSerialBase::getStats(){
+  sStats_t stats;
+#ifdef DFROBOT_IICSERIAL_STATS
+  stats = _stats;
+#else
+  memset(&stats, 0, sizeof(stats));
+#endif
+  return stats;
+}
+
+void DFRobot_IICSerialBase::resetStats(){
+#ifdef DFROBOT_IICSERIAL_STATS
+  memset(&_stats, 0, sizeof(_stats));
+#endif
+}
+
+void DFRobot_IICSerialBase::sleep(){
+  if(_pChip == NULL){
+      return;
+  }
+  DFROBOT_IICSERIAL_LOCK(_pChip->_pBus);
+  writeRegCached(REG_WK2132_SCR, readRegCached(REG_WK2132_SCR) | WK2132_SCR_SLEEPEN);
+  _sleeping = true;
+#ifdef DFROBOT_IICSERIAL_STATS
+  _stats.sleeps++;
+#endif
+}
+
+void DFRobot_IICSerialBase::wakeup(){
+  if(_pChip == NULL){
+      return;
+  }
+  DFROBOT_IICSERIAL_LOCK(_pChip->_pBus);
+  writeRegCached(REG_WK2132_SCR, readRegCached(REG_WK2132_SCR) & ~WK2132_SCR_SLEEPEN);
+  _sleeping = false;
+  _activityMs = millis();
+}
+
+void DFRobot_IICSerialBase::setAutoSleep(uint32_t idleMs){
+  _autoSleepMs = idleMs;
+  _activityMs = millis();
+}
+
+void DFRobot_IICSerialBase::pollSleep(){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if((_autoSleepMs == 0) || _sleeping || (_pChip == NULL) || ((uint32_t)(millis() - _activityMs) < _autoSleepMs)){
+      return;
+  }
+  //Data still queued or shifting out keeps it awake
+  if(checkTxComplete()){
+      sleep();
+  }
+}
+
+void DFRobot_IICSerialBase::rxActivity(){
+  _rxLastUs = micros();
+  _rxIdle = false;
+  _activityMs = millis();
+  if(_sleeping){
+      //The sub UART wakes up by itself on the start bit, but with SLEEPEN left set it would doze off
+      //again in every pause of a slow peer and risk the first byte after each one
+      wakeup();
+#ifdef DFROBOT_IICSERIAL_STATS
+      _stats.rxWakeups++;
+#endif
+  }
+}
+
+void DFRobot_IICSerialBase::writeReg(uint8_t reg, const void* pBuf, size_t size){
+  if(_pChip != NULL){
+      _pChip->writeReg(_subSerialChannel, reg, pBuf, size);
+  }
+}
+
+uint8_t DFRobot_IICSerialBase::readReg(uint8_t reg, void* pBuf, size_t size){
+  if(_pChip == NULL){
+      return 0;
+  }
+  return _pChip->readReg(_subSerialChannel, reg, pBuf, size);
+}
+
+size_t DFRobot_IICSerialBase::readFIFO(void* pBuf, size_t size){
+  if(_pChip == NULL){
+      return 0;
+  }
+  return _pChip->readFIFO(_subSerialChannel, pBuf, size);
+}
+
+size_t DFRobot_IICSerialBase::writeFIFO(void *pBuf, size_t size){
+  DFROBOT_IICSERIAL_PORT_LOCK();
+  if(pBuf == NULL){
+      DBG("pBuf ERROR!! : null pointer");
+      return 0;
+  }
+  uint8_t *_pBuf = (uint8_t *)pBuf;
+  size_t left = size, space = 0, num = 0;
+  while(left){
+      space = readTxFIFOSpace();
+      if(space == 0){
+          break;
+      }
+      if(space > left){
+          space = left;
+      }
+      num = writeFIFOBurst(_pBuf, space);
+      left -= num;
+      _pBuf += num;
+      if(num != space){
+          break;
+      }
+  }
+  return size - left;
 }
 
-DFRobot_IICSerial::~DFRobot_IICSerial(){
-  
+size_t DFRobot_IICSerialBase::writeFIFOBurst(const uint8_t *pBuf, size_t size){
+  if(_pChip == NULL){
+      return 0;
+  }
+  return _pChip->writeFIFO(_subSerialChannel, pBuf, size);
 }
 
-int DFRobot_IICSerial::begin(long unsigned baud, uint8_t format, eCommunicationMode_t mode, eLineBreakOutput_t opt){
-  _rx_buffer_head = _rx_buffer_tail;
-  _pWire->begin();
+DFRobot_IICSerialChip *DFRobot_IICSerialChip::getChip(DFRobot_IICSerialTransport *pBus, uint8_t addr){
+  DFRobot_IICSerialChip *pFree = NULL;
+  uint8_t addrPre = addr >> 3;
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      DFRobot_IICSerialChip *pChip = &_chips[i];
+      if((pChip->_pBus == pBus) && (pChip->_addrPre == addrPre)){
+          return pChip;
+      }
+      if((pChip->_pBus == NULL) && (pFree == NULL)){
+          pFree = pChip;
+      }
+  }
+  if(pFree != NULL){
+      memset(pFree, 0, sizeof(DFRobot_IICSerialChip));
+      pFree->_pBus = pBus;
+      pFree->_addrPre = addrPre;
+      pFree->_irqPin = -1;
+      pFree->_fosc = DFROBOT_IICSERIAL_FOSC;
+      pFree->_page[SUBUART_CHANNEL_1] = WK2132_PAGE_UNKNOWN;
+      pFree->_page[SUBUART_CHANNEL_2] = WK2132_PAGE_UNKNOWN;
+  }
+  return pFree;
+}
+
+void DFRobot_IICSerialChip::attachPort(DFRobot_IICSerialBase *pPort, uint8_t subUartChannel){
+  if(subUartChannel <= SUBUART_CHANNEL_2){
+      _ports[subUartChannel] = pPort;
+  }
+}
+
+void DFRobot_IICSerialChip::detachPort(DFRobot_IICSerialBase *pPort){
+  for(uint8_t i = 0; i < 2; i++){
+      if(_ports[i] == pPort){
+          _ports[i] = NULL;
+      }
+  }
+  if((_ports[SUBUART_CHANNEL_1] == NULL) && (_ports[SUBUART_CHANNEL_2] == NULL)){
+      detachInterruptPin();
+      _pBus = NULL;
+  }
+}
+
+int DFRobot_IICSerialChip::begin(){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
   uint8_t val = 0;
-  uint8_t channel = subSerialChnnlSwitch(SUBUART_CHANNEL_1);
-  if(readReg(REG_WK2132_GENA, &val, 1) != 1){
+  _pBus->begin();
+  //The global registers are shared by both sub UARTs, so their shadow copy is refreshed here
+  _globalShadowValid = 0;
+  if(readReg(SUBUART_CHANNEL_1, REG_WK2132_GENA, &val, 1) != 1){
       DBG("READ BYTEERROR!");
       return DFROBOT_IICSERIAL_ERR_READ;
   }
@@ -76,218 +1369,215 @@ int DFRobot_IICSerial::begin(long unsigned baud, uint8_t format, eCommunicationM
       return DFROBOT_IICSERIAL_ERR_REGDATA;
   }
 #endif
-  subSerialChnnlSwitch(channel);
-  subSerialConfig(_subSerialChannel);
-  DBG("OK");
-  setSubSerialBaudRate(baud);
-  setSubSerialConfigReg(format, mode, opt);
+  _gena = val;
+  _globalShadowValid |= 0x01;
   return DFROBOT_IICSERIAL_ERR_OK;
 }
 
-void DFRobot_IICSerial::end(){
-  subSerialGlobalRegEnable(_subSerialChannel, rst);
+size_t DFRobot_IICSerialChip::poll(){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
+  size_t num = 0;
+  service();
+  for(uint8_t i = 0; i < 2; i++){
+      DFRobot_IICSerialBase *pPort = _ports[i];
+      if(pPort == NULL){
+          continue;
+      }
+      if((_irqPin < 0) || pPort->_rxFIFOPending){
+          num += pPort->fillRxBuffer();
+      }
+      num += pPort->pumpTxBuffer();
+      pPort->pollTxComplete();
+      pPort->pollSleep();
+  }
+  return num;
 }
 
-int DFRobot_IICSerial::available(void){
-  int index;
-  uint8_t val = 0;
-  sFsrReg_t fsr;
-  if(readReg(REG_WK2132_RFCNT, &val, 1) != 1){
-      DBG("READ BYTE SIZE ERROR!");
-      return 0;
+size_t DFRobot_IICSerialChip::pollAll(){
+  DFRobot_IICSerialBase *pPorts[DFROBOT_IICSERIAL_CHIP_MAX * 2];
+  int counts[DFROBOT_IICSERIAL_CHIP_MAX * 2];
+  uint8_t total = 0;
+  size_t num = 0;
+#ifdef DFROBOT_IICSERIAL_THREAD_SAFE
+  //The counts stay valid only while no other task reads the FIFOs, so the buses are held for the whole cycle,
+  //always in chip order
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      if(_chips[i]._pBus != NULL){
+          _chips[i]._pBus->lock();
+      }
   }
-  index = (int)val;
-  if(index == 0){
-      fsr = readFIFOStateReg();
-      if(fsr.rDat == 1){
-          index = 256;
+#endif
+  //Collect the receive FIFO fill level of every port that may hold data
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      DFRobot_IICSerialChip *pChip = &_chips[i];
+      if(pChip->_pBus == NULL){
+          continue;
+      }
+      pChip->service();
+      for(uint8_t j = 0; j < 2; j++){
+          DFRobot_IICSerialBase *pPort = pChip->_ports[j];
+          if((pPort == NULL) || (pPort->rxBufferSpace() == 0)){
+              continue;
+          }
+          int count = 0;
+          if(pChip->_irqPin < 0){
+              count = pPort->readRxFIFOCount();
+          }else if(pPort->_rxFIFOPending){
+              count = -1;
+          }
+          if(count == 0){
+              continue;
+          }
+          //Insertion sort, the fullest FIFO is the closest to overrun, a pending interrupt goes first
+          uint8_t k = total++;
+          int key = (count < 0) ? 257 : count;
+          while((k > 0) && (((counts[k - 1] < 0) ? 257 : counts[k - 1]) < key)){
+              pPorts[k] = pPorts[k - 1];
+              counts[k] = counts[k - 1];
+              k--;
+          }
+          pPorts[k] = pPort;
+          counts[k] = count;
       }
   }
-  return (index + ((unsigned int)(SERIAL_RX_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail)) % SERIAL_RX_BUFFER_SIZE);
+  for(uint8_t i = 0; i < total; i++){
+      num += (counts[i] < 0) ? pPorts[i]->fillRxBuffer() : pPorts[i]->fillRxBuffer(counts[i]);
+  }
+  //Refill the transmit FIFOs round-robin, starting one port later every cycle
+  total = 0;
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      for(uint8_t j = 0; j < 2; j++){
+          if((_chips[i]._pBus != NULL) && (_chips[i]._ports[j] != NULL)){
+              pPorts[total++] = _chips[i]._ports[j];
+          }
+      }
+  }
+  for(uint8_t i = 0; i < total; i++){
+      num += pPorts[(i + _rrStart) % total]->pumpTxBuffer();
+      pPorts[(i + _rrStart) % total]->pollTxComplete();
+      pPorts[(i + _rrStart) % total]->pollSleep();
+  }
+  if(total){
+      _rrStart = (_rrStart + 1) % total;
+  }
+#ifdef DFROBOT_IICSERIAL_THREAD_SAFE
+  for(uint8_t i = DFROBOT_IICSERIAL_CHIP_MAX; i > 0; i--){
+      if(_chips[i - 1]._pBus != NULL){
+          _chips[i - 1]._pBus->unlock();
+      }
+  }
+#endif
+  return num;
 }
 
-int DFRobot_IICSerial::peek(void){
-  int num = available() - (((unsigned int)(SERIAL_RX_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail)) % SERIAL_RX_BUFFER_SIZE);
-  for(int i = 0; i < num; i++){
-      rx_buffer_index_t j = (rx_buffer_index_t)(_rx_buffer_head + 1) % SERIAL_RX_BUFFER_SIZE;
-      if(j != _rx_buffer_tail){
-          uint8_t val = 0;
-          readReg(REG_WK2132_FDAT, &val, 1);
-          _rx_buffer[_rx_buffer_head] = val;
-          _rx_buffer_head = j;
-      }else{
-          break;
+int DFRobot_IICSerialChip::attachInterruptPin(uint8_t pin){
+  _irqPin = pin;
+  DFROBOT_IICSERIAL_RELEASE(_irqPending, true);
+  for(uint8_t i = 0; i < 2; i++){
+      if(_ports[i] != NULL){
+          _ports[i]->enterInterruptMode();
       }
   }
-  if(_rx_buffer_head == _rx_buffer_tail){
-      return -1;
-  }
-  return _rx_buffer[_rx_buffer_tail];
+  pinMode(pin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(pin), irqHandler, FALLING);
+  return 0;
 }
 
-int DFRobot_IICSerial::read(void){
-  int num = available() - ((unsigned int)(SERIAL_RX_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail)) % SERIAL_RX_BUFFER_SIZE;
-  for(int i = 0; i < num; i++){
-      rx_buffer_index_t j = (rx_buffer_index_t)(_rx_buffer_head + 1) % SERIAL_RX_BUFFER_SIZE;
-      if(j != _rx_buffer_tail){
-          uint8_t val = 0;
-          readReg(REG_WK2132_FDAT, &val, 1);
-          _rx_buffer[_rx_buffer_head] = val;
-          _rx_buffer_head = j;
-      }else{
-          break;
+void DFRobot_IICSerialChip::detachInterruptPin(){
+  if(_irqPin < 0){
+      return;
+  }
+  bool shared = false;
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      if((&_chips[i] != this) && (_chips[i]._pBus != NULL) && (_chips[i]._irqPin == _irqPin)){
+          shared = true;
       }
   }
-  if(_rx_buffer_head == _rx_buffer_tail){
-      return -1;
+  if(!shared){
+      detachInterrupt(digitalPinToInterrupt(_irqPin));
   }
-  unsigned char c = _rx_buffer[_rx_buffer_tail];
-  _rx_buffer_tail = (rx_buffer_index_t)(_rx_buffer_tail + 1) % SERIAL_RX_BUFFER_SIZE;
-  return c;
+  _irqPin = -1;
 }
 
-size_t DFRobot_IICSerial::write(uint8_t value){
-  sFsrReg_t fsr;
-  fsr = readFIFOStateReg();
-  if(fsr.tFull == 1){
-      DBG("FIFO full!");
-      return -1;
+void DFROBOT_IICSERIAL_ISR_ATTR DFRobot_IICSerialChip::irqHandler(){
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      if((_chips[i]._pBus != NULL) && (_chips[i]._irqPin >= 0)){
+          DFROBOT_IICSERIAL_RELEASE(_chips[i]._irqPending, true);
+      }
   }
-  writeReg(REG_WK2132_FDAT, &value, 1);
-  return 1;
 }
 
-size_t DFRobot_IICSerial::write(const uint8_t *pBuf, size_t size){
-  if(pBuf == NULL){
-    DBG("pBuf ERROR!! : null pointer");
-    return 0;
+uint8_t DFRobot_IICSerialChip::service(){
+  if(_irqPin < 0){
+      return 0;
   }
-  uint8_t *_pBuf = (uint8_t *)pBuf;
-  sFsrReg_t fsr;
-  uint8_t val = 0;
-  fsr = readFIFOStateReg();
-  if(fsr.tFull == 1){
-      DBG("FIFO full!");
+  DFROBOT_IICSERIAL_LOCK(_pBus);
+  //The IRQ output is level triggered, so a source that is still active keeps the pin low after the edge
+  if(!DFROBOT_IICSERIAL_ACQUIRE(_irqPending) && (digitalRead(_irqPin) == HIGH)){
       return 0;
   }
-  writeFIFO(_pBuf, size);
-  return size;
-}
-
-size_t DFRobot_IICSerial::read(void *pBuf, size_t size){
-  if(pBuf == NULL){
-    DBG("pBuf ERROR!! : null pointer");
-    return 0;
+  DFROBOT_IICSERIAL_RELEASE(_irqPending, false);
+  uint8_t gifr = 0;
+  if(readReg(SUBUART_CHANNEL_1, REG_WK2132_GIFR, &gifr, 1) != 1){
+      DBG("READ BYTE SIZE ERROR!");
+      DFROBOT_IICSERIAL_RELEASE(_irqPending, true);
+      return 0;
   }
-  uint8_t *_pBuf = (uint8_t *)pBuf;
-  size = available() - (((unsigned int)(SERIAL_RX_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail)) % SERIAL_RX_BUFFER_SIZE);
-  readFIFO(_pBuf, size);
-  return size;
-}
-void DFRobot_IICSerial::flush(void){
-  sFsrReg_t fsr = readFIFOStateReg();
-  while(fsr.tDat == 1);
-}
-
-
-void DFRobot_IICSerial::subSerialConfig(uint8_t subUartChannel){
-  DBG("Sub UART clock enable");
-  subSerialGlobalRegEnable(subUartChannel, clock);
-  DBG("Software reset sub UART");
-  subSerialGlobalRegEnable(subUartChannel, rst);
-  DBG("Sub UART global interrupt enable");
-  subSerialGlobalRegEnable(subUartChannel, intrpt);
-  DBG("Sub UART page register setting (default PAGE0)");
-  subSerialPageSwitch(page0);
-  DBG("Sub interrupt setting");
-  sSierReg_t sier = {.rFTrig = 0x01, .rxOvt = 0x01, .tfTrig = 0x01, .tFEmpty = 0x01, .rsv = 0x00, .fErr = 0x01};
-  subSerialRegConfig(REG_WK2132_SIER, &sier);
-  DBG("enable transmit/receive FIFO");
-  sFcrReg_t fcr = {.rfRst = 0x01, .tfRst = 0x00, .rfEn = 0x01, .tfEn = 0x01, .rfTrig = 0x00, .tfTrig = 0x00};
-  subSerialRegConfig(REG_WK2132_FCR, &fcr);
-  DBG("Sub UART reiceive/transmit enable");
-  sScrReg_t scr = {.rxEn = 0x01, .txEn = 0x01, .sleepEn = 0x00, .rsv = 0x00 };
-  subSerialRegConfig(REG_WK2132_SCR, &scr);
+  for(uint8_t i = 0; i < 2; i++){
+      if((gifr & (1 << i)) && (_ports[i] != NULL)){
+          _ports[i]->serviceInterrupt();
+      }
+  }
+  return gifr & 0x03;
 }
 
-void DFRobot_IICSerial::subSerialGlobalRegEnable(uint8_t subUartChannel, eGlobalRegType_t type){
+void DFRobot_IICSerialChip::globalRegEnable(uint8_t subUartChannel, DFRobot_IICSerialBase::eGlobalRegType_t type){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
   if(subUartChannel > SUBUART_CHANNEL_ALL)
   {
       DBG("SUBSERIAL CHANNEL NUMBER ERROR!");
       return;
   }
-  uint8_t val = 0;
+  uint8_t val = 0, bits = 0;
   uint8_t regAddr = getGlobalRegType(type);
-  uint8_t channel = subSerialChnnlSwitch(SUBUART_CHANNEL_1);
-  DBG("reg");DBG(regAddr, HEX);
-  if(readReg(regAddr, &val, 1) != 1){
-        DBG("READ BYTE SIZE ERROR!");
-      return;
-  }
-  DBG("before:");DBG(val, HEX);
   switch(subUartChannel){
       case SUBUART_CHANNEL_1:
-                             val |= 0x01;
+                             bits = 0x01;
                              break;
       case SUBUART_CHANNEL_2:
-                             val |= 0x02;
+                             bits = 0x02;
                              break;
       default:
-              val |= 0x03;
+              bits = 0x03;
               break;
   }
-  writeReg(regAddr, &val, 1);
-  readReg(regAddr, &val, 1);
-  DBG("after:");DBG(val, HEX);
-  subSerialChnnlSwitch(channel);
-}
-
-void DFRobot_IICSerial::subSerialPageSwitch(ePageNumber_t page){
-  if(page >= pageTotal){
-      return;
-  }
-  uint8_t val = 0;
-  if(readReg(REG_WK2132_SPAGE, &val, 1) != 1){
-      DBG("READ BYTE SIZE ERROR!");
+  DBG("reg");DBG(regAddr, HEX);
+  if(type == DFRobot_IICSerialBase::rst){
+      //The reset bits clear automatically, so only the bits of the sub UART to be reset are written
+      writeReg(SUBUART_CHANNEL_1, regAddr, &bits, 1);
+      for(uint8_t i = 0; i < 2; i++){
+          if(bits & (1 << i)){
+              resetRegCache(i);
+          }
+      }
       return;
   }
-  switch(page){
-      case page0:
-                 val &= 0xFE;
-                 break;
-      case page1:
-                 val |= 0x01;
-                 break;
-      default:
-              break;
-  }
-  DBG("before: "); DBG(val);
-  writeReg(REG_WK2132_SPAGE, &val, 1);
-  readReg(REG_WK2132_SPAGE, &val, 1);
-  DBG("after: ");DBG(val, HEX);
-}
-
-void DFRobot_IICSerial::subSerialRegConfig(uint8_t reg, void *pValue){
-  uint8_t val = 0;
-  readReg(reg, &val, 1);
-  DBG("before: "); DBG(val);
-  val |= *(uint8_t *)pValue;
-  writeReg(reg, &val, 1);
-  readReg(reg, &val, 1);
-  DBG("after: ");DBG(val, HEX);
+  val = readRegCached(SUBUART_CHANNEL_1, regAddr);
+  DBG("before:");DBG(val, HEX);
+  writeRegCached(SUBUART_CHANNEL_1, regAddr, val | bits);
 }
 
-uint8_t DFRobot_IICSerial::getGlobalRegType(eGlobalRegType_t type){
-  if((type < clock) || (type > intrpt)){
+uint8_t DFRobot_IICSerialChip::getGlobalRegType(DFRobot_IICSerialBase::eGlobalRegType_t type){
+  if((type < DFRobot_IICSerialBase::clock) || (type > DFRobot_IICSerialBase::intrpt)){
       DBG("Global Reg Type Error!");
       return 0;
   }
   uint8_t regAddr = 0;
   switch(type){
-      case clock:
+      case DFRobot_IICSerialBase::clock:
                  regAddr = REG_WK2132_GENA;
                  break;
-      case rst:
+      case DFRobot_IICSerialBase::rst:
                  regAddr = REG_WK2132_GRST;
                  break;
       default:
@@ -297,152 +1587,385 @@ uint8_t DFRobot_IICSerial::getGlobalRegType(eGlobalRegType_t type){
   return regAddr;
 }
 
-void DFRobot_IICSerial::setSubSerialBaudRate(unsigned long baud){
-  uint8_t scr = 0x00,clear = 0x00;
-  readReg(REG_WK2132_SCR, &scr, 1);
-  subSerialRegConfig(REG_WK2132_SCR, &clear);
-  uint8_t baud1 = 0,baud0 = 0, baudPres = 0;
-  uint16_t valIntger  = DFROBOT_IICSERIAL_FOSC/(baud * 16) - 1;
-  uint16_t valDecimal = (DFROBOT_IICSERIAL_FOSC%(baud * 16))/(baud * 16); 
-  baud1 = (uint8_t)(valIntger >> 8);
-  baud0 = (uint8_t)(valIntger & 0x00ff);
-  while(valDecimal > 0x0A){
-      valDecimal /= 0x0A;
+void DFRobot_IICSerialChip::pageSwitch(uint8_t subUartChannel, DFRobot_IICSerialBase::ePageNumber_t page){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
+  if(page >= DFRobot_IICSerialBase::pageTotal){
+      return;
   }
-  baudPres = (uint8_t)(valDecimal);
-  subSerialPageSwitch(page1);
-  subSerialRegConfig(REG_WK2132_BAUD1, &baud1);
-  subSerialRegConfig(REG_WK2132_BAUD0, &baud0);
-  subSerialRegConfig(REG_WK2132_PRES, &baudPres);
-
-  readReg(REG_WK2132_BAUD1, &baud1, 1);
-  readReg(REG_WK2132_BAUD0, &baud0, 1);
-  readReg(REG_WK2132_PRES, &baudPres, 1);
-  DBG(baud1, HEX);
-  DBG(baud0, HEX);
-  DBG(baudPres, HEX);
-  subSerialPageSwitch(page0);
-  subSerialRegConfig(REG_WK2132_SCR, &scr);
+  if(_page[subUartChannel] == page){
+      return;
+  }
+  uint8_t val = (uint8_t)page;
+  writeReg(subUartChannel, REG_WK2132_SPAGE, &val, 1);
+  _page[subUartChannel] = page;
+#ifdef DFROBOT_IICSERIAL_VERIFY_WRITE
+  readReg(subUartChannel, REG_WK2132_SPAGE, &val, 1);
+  if((val & 0x01) != page){
+      DBG("SPAGE VERIFY ERROR!");
+      _page[subUartChannel] = WK2132_PAGE_UNKNOWN;
+  }
+#endif
 }
 
-void DFRobot_IICSerial::setSubSerialConfigReg(uint8_t format, eCommunicationMode_t mode, eLineBreakOutput_t opt){
-  uint8_t _mode = (uint8_t)mode;
-  uint8_t _opt = (uint8_t)opt;
+uint8_t DFRobot_IICSerialChip::readRegCached(uint8_t subUartChannel, uint8_t reg){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
   uint8_t val = 0;
-  _addr = updateAddr(_addr, _subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER);
-  if(readReg(REG_WK2132_LCR, &val, 1) != 1){
-      DBG("Read Byte ERROR！");
-      return;
+  uint8_t page = _page[subUartChannel];
+  if((reg == REG_WK2132_GENA) || (reg == REG_WK2132_GIER)){
+      uint8_t bit = (reg == REG_WK2132_GENA) ? 0x01 : 0x02;
+      uint8_t *pShadow = (reg == REG_WK2132_GENA) ? &_gena : &_gier;
+      if((_globalShadowValid & bit) == 0){
+          readReg(SUBUART_CHANNEL_1, reg, pShadow, 1);
+          _globalShadowValid |= bit;
+      }
+      return *pShadow;
   }
-  DBG("before: "); DBG(val, HEX);
-  sLcrReg_t lcr = *((sLcrReg_t *)(&val));
-  lcr.format = format;
-  lcr.irEn = _mode;
-  lcr.lBreak = _opt;
-  val = *(uint8_t *)&lcr;
-  writeReg(REG_WK2132_LCR, &val, 1);
-  readReg(REG_WK2132_LCR, &val, 1);
-  DBG("after: "); DBG(val, HEX);
+  if((reg < REG_WK2132_SCR) || (reg >= REG_WK2132_SCR + DFROBOT_IICSERIAL_SHADOW_REG_NUM) || (page >= DFRobot_IICSerialBase::pageTotal)){
+      readReg(subUartChannel, reg, &val, 1);
+      return val;
+  }
+  uint8_t index = reg - REG_WK2132_SCR;
+  if((_regShadowValid[subUartChannel][page] & (1 << index)) == 0){
+      readReg(subUartChannel, reg, &_regShadow[subUartChannel][page][index], 1);
+      _regShadowValid[subUartChannel][page] |= (1 << index);
+  }
+  return _regShadow[subUartChannel][page][index];
 }
 
-uint8_t DFRobot_IICSerial::updateAddr(uint8_t pre, uint8_t subUartChannel, uint8_t obj){
-  sIICAddr_t addr ={.type = obj, .uart = subUartChannel, .addrPre = (uint8_t)((int)pre >> 3)};
-  return *(uint8_t *)&addr;
+void DFRobot_IICSerialChip::writeRegCached(uint8_t subUartChannel, uint8_t reg, uint8_t val){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
+  uint8_t *pShadow = NULL, *pValid = NULL, bit = 0;
+  uint8_t page = _page[subUartChannel];
+  if((reg == REG_WK2132_GENA) || (reg == REG_WK2132_GIER)){
+      subUartChannel = SUBUART_CHANNEL_1;
+      pShadow = (reg == REG_WK2132_GENA) ? &_gena : &_gier;
+      pValid = &_globalShadowValid;
+      bit = (reg == REG_WK2132_GENA) ? 0x01 : 0x02;
+  }else if((reg >= REG_WK2132_SCR) && (reg < REG_WK2132_SCR + DFROBOT_IICSERIAL_SHADOW_REG_NUM) && (page < DFRobot_IICSerialBase::pageTotal)){
+      pShadow = &_regShadow[subUartChannel][page][reg - REG_WK2132_SCR];
+      pValid = &_regShadowValid[subUartChannel][page];
+      bit = 1 << (reg - REG_WK2132_SCR);
+  }
+  if((pShadow != NULL) && (*pValid & bit) && (*pShadow == val)){
+      return;
+  }
+  writeReg(subUartChannel, reg, &val, 1);
+  if(pShadow == NULL){
+      return;
+  }
+  if((page == DFRobot_IICSerialBase::page0) && (reg == REG_WK2132_FCR)){
+      val &= ~WK2132_FCR_RST_MASK;
+  }
+  *pShadow = val;
+  *pValid |= bit;
+#ifdef DFROBOT_IICSERIAL_VERIFY_WRITE
+  uint8_t readback = 0;
+  readReg(subUartChannel, reg, &readback, 1);
+  DBG("after: ");DBG(readback, HEX);
+  if(readback != val){
+      DBG("VERIFY ERROR!");
+      *pValid &= ~bit;
+  }
+#endif
 }
 
-DFRobot_IICSerial::sFsrReg_t DFRobot_IICSerial::readFIFOStateReg(){
-  sFsrReg_t fsr;
-  readReg(REG_WK2132_FSR, &fsr, sizeof(fsr));
-  return fsr;
+void DFRobot_IICSerialChip::resetRegCache(uint8_t subUartChannel){
+  //SCR, LCR, FCR, SIER and SPAGE are 0 after a software reset, the page 1 registers are re-read on first use
+  memset(_regShadow[subUartChannel], 0, sizeof(_regShadow[subUartChannel]));
+  _regShadowValid[subUartChannel][DFRobot_IICSerialBase::page0] = (1 << DFROBOT_IICSERIAL_SHADOW_REG_NUM) - 1;
+  _regShadowValid[subUartChannel][DFRobot_IICSerialBase::page1] = 0;
+  _page[subUartChannel] = DFRobot_IICSerialBase::page0;
 }
 
-uint8_t DFRobot_IICSerial::subSerialChnnlSwitch(uint8_t subUartChannel){
-  uint8_t channel = _subSerialChannel;
-  _subSerialChannel = subUartChannel;
-  return channel;
-}
-void DFRobot_IICSerial::sleep(){
-  
+uint8_t DFRobot_IICSerialChip::updateAddr(uint8_t subUartChannel, uint8_t obj){
+  DFRobot_IICSerialBase::sIICAddr_t addr ={.type = obj, .uart = subUartChannel, .addrPre = _addrPre};
+  return *(uint8_t *)&addr;
 }
 
-void DFRobot_IICSerial::wakeup(){
-
-}
-void DFRobot_IICSerial::writeReg(uint8_t reg, const void* pBuf, size_t size){
+void DFRobot_IICSerialChip::writeReg(uint8_t subUartChannel, uint8_t reg, const void* pBuf, size_t size){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
+  uint8_t buf[DFROBOT_IICSERIAL_SHADOW_REG_NUM + 1];
   if(pBuf == NULL){
       DBG("pBuf ERROR!! : null pointer");
+      return;
   }
-  _addr = updateAddr(_addr, _subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER);
-  uint8_t * _pBuf = (uint8_t *)pBuf;
-  _pWire->beginTransmission(_addr);
-  _pWire->write(&reg, 1);
-
-  for(uint16_t i = 0; i < size; i++){
-    _pWire->write(_pBuf[i]);
+  if(size >= sizeof(buf)){
+      DBG("SIZE ERROR!");
+      return;
+  }
+  uint8_t addr = updateAddr(subUartChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER);
+  buf[0] = reg;
+  memcpy(buf + 1, pBuf, size);
+  DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicTransactions, 1);
+  if(_pBus->write(addr, buf, size + 1) != 0){
+      DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicErrors, 1);
   }
-  _pWire->endTransmission();
 }
 
-uint8_t DFRobot_IICSerial::readReg(uint8_t reg, void* pBuf, size_t size){
+uint8_t DFRobot_IICSerialChip::readReg(uint8_t subUartChannel, uint8_t reg, void* pBuf, size_t size){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
   if(pBuf == NULL){
     DBG("pBuf ERROR!! : null pointer");
     return 0;
   }
-  _addr = updateAddr(_addr, _subSerialChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER);
-  uint8_t * _pBuf = (uint8_t *)pBuf;
-  _addr &= 0xFE;
-  _pWire->beginTransmission(_addr);
-  _pWire->write(&reg, 1);
-  if(_pWire->endTransmission() != 0){
-      return 0;
-  }
-  _pWire->requestFrom(_addr, (uint8_t) size);
-  for(uint16_t i = 0; i < size; i++){
-    _pBuf[i] = (char)_pWire->read();
+  uint8_t addr = updateAddr(subUartChannel, DFROBOT_IICSERIAL_OBJECT_REGISTER);
+  DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicTransactions, 2);
+  size_t num = _pBus->writeRead(addr, &reg, 1, (uint8_t *)pBuf, size);
+  if(num != size){
+      DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicErrors, 1);
   }
-  return size;
+  return num;
 }
 
-uint8_t DFRobot_IICSerial::readFIFO(void* pBuf, size_t size){
+size_t DFRobot_IICSerialChip::readFIFO(uint8_t subUartChannel, void* pBuf, size_t size){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
   if(pBuf == NULL){
     DBG("pBuf ERROR!! : null pointer");
     return 0;
   }
-  _addr = updateAddr(_addr, _subSerialChannel, DFROBOT_IICSERIAL_OBJECT_FIFO);
+  uint8_t addr = updateAddr(subUartChannel, DFROBOT_IICSERIAL_OBJECT_FIFO);
   uint8_t *_pBuf = (uint8_t *)pBuf;
-  size_t left = size,num = 0;
+  size_t left = size, num = 0, max = _pBus->getMaxTransfer();
   while(left){
-      num = (left > DFROBOT_IICSERIAL_IIC_BUFFER_SIZE) ?  DFROBOT_IICSERIAL_IIC_BUFFER_SIZE : left;
-      _pWire->beginTransmission(_addr);
-      if(_pWire->endTransmission() != 0){
-          return 0;
-      }
-      _pWire->requestFrom(_addr, (uint8_t) num);
-      for(size_t i = 0; i < num; i++){
-          *(_pBuf+i) = _pWire->read();
+      num = (left > max) ? max : left;
+      //The FIFO address needs no register pointer, so every chunk is a single read transaction
+      DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicTransactions, 1);
+      if(_pBus->read(addr, _pBuf, num) != num){
+          DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicErrors, 1);
+          return size - left;
       }
-      left -=num;
+      DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], rxBytes, num);
+      left -= num;
       _pBuf += num;
   }
-  return (uint8_t)size;
+  return size;
 }
-void DFRobot_IICSerial::writeFIFO(void *pBuf, size_t size){
-  if(pBuf == NULL){
-      DBG("pBuf ERROR!! : null pointer");
+
+size_t DFRobot_IICSerialChip::writeFIFO(uint8_t subUartChannel, const uint8_t *pBuf, size_t size){
+  DFROBOT_IICSERIAL_LOCK(_pBus);
+  uint8_t addr = updateAddr(subUartChannel, DFROBOT_IICSERIAL_OBJECT_FIFO);
+  size_t left = size, num = 0, max = _pBus->getMaxTransfer();
+  while(left){
+      num = (left > max) ? max : left;
+      DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicTransactions, 1);
+      if(_pBus->write(addr, pBuf, num) != 0){
+          DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicErrors, 1);
+          break;
+      }
+      DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], txBytes, num);
+      left -= num;
+      pBuf += num;
+  }
+  return size - left;
+}
+
+int DFRobot_IICSerialChip::submit(uint8_t subUartChannel, uint8_t obj, DFRobot_IICSerialTransport::sTransfer_t *pTransfer){
+  pTransfer->addr = updateAddr(subUartChannel, obj);
+  DFROBOT_IICSERIAL_STAT_ADD(_ports[subUartChannel], iicTransactions, ((pTransfer->txSize && pTransfer->rxSize) ? 2 : 1));
+  return _pBus->submit(pTransfer);
+}
+
+size_t DFRobot_IICSerialTransport::writeRead(uint8_t addr, const uint8_t *pTx, size_t txSize, uint8_t *pRx, size_t rxSize){
+  if(write(addr, pTx, txSize) != 0){
+      return 0;
+  }
+  return read(addr, pRx, rxSize);
+}
+
+int DFRobot_IICSerialTransport::submit(sTransfer_t *pTransfer){
+  if(pTransfer == NULL){
+      return -1;
+  }
+  pTransfer->result = 0;
+  if(pTransfer->rxSize){
+      if(writeRead(pTransfer->addr, pTransfer->pTx, pTransfer->txSize, pTransfer->pRx, pTransfer->rxSize) != pTransfer->rxSize){
+          pTransfer->result = -1;
+      }
+  }else if(write(pTransfer->addr, pTransfer->pTx, pTransfer->txSize) != 0){
+      pTransfer->result = -1;
+  }
+  if(pTransfer->callback != NULL){
+      pTransfer->callback(pTransfer);
+  }
+  return 0;
+}
+
+void DFRobot_IICSerialTransport::lock(){
+#if defined(DFROBOT_IICSERIAL_THREAD_SAFE) && defined(ESP32)
+  SemaphoreHandle_t mutex = __atomic_load_n(&_mutex, __ATOMIC_ACQUIRE);
+  if(mutex == NULL){
+      static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+      SemaphoreHandle_t created = xSemaphoreCreateRecursiveMutex();
+      portENTER_CRITICAL(&mux);
+      if(_mutex == NULL){
+          __atomic_store_n(&_mutex, created, __ATOMIC_RELEASE);
+          created = NULL;
+      }
+      mutex = _mutex;
+      portEXIT_CRITICAL(&mux);
+      //Another task created the mutex first
+      if(created != NULL){
+          vSemaphoreDelete(created);
+      }
+  }
+  xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+#endif
+}
+
+void DFRobot_IICSerialTransport::unlock(){
+#if defined(DFROBOT_IICSERIAL_THREAD_SAFE) && defined(ESP32)
+  xSemaphoreGiveRecursive(_mutex);
+#endif
+}
+
+DFRobot_IICSerialWireTransport *DFRobot_IICSerialWireTransport::get(TwoWire *pWire){
+  DFRobot_IICSerialWireTransport *pFree = NULL;
+  for(uint8_t i = 0; i < DFROBOT_IICSERIAL_CHIP_MAX; i++){
+      if(_pool[i]._pWire == pWire){
+          return &_pool[i];
+      }
+      if((_pool[i]._pWire == NULL) && (pFree == NULL)){
+          pFree = &_pool[i];
+      }
+  }
+  if(pFree != NULL){
+      pFree->_pWire = pWire;
+  }
+  return pFree;
+}
+
+void DFRobot_IICSerialWireTransport::begin(){
+  _pWire->begin();
+}
+
+uint8_t DFRobot_IICSerialWireTransport::write(uint8_t addr, const uint8_t *pBuf, size_t size){
+  _pWire->beginTransmission(addr);
+  if(size){
+      _pWire->write(pBuf, size);
+  }
+  return _pWire->endTransmission();
+}
+
+size_t DFRobot_IICSerialWireTransport::read(uint8_t addr, uint8_t *pBuf, size_t size){
+  size_t num = _pWire->requestFrom(addr, (uint8_t)size);
+  if(num > size){
+      num = size;
+  }
+  for(size_t i = 0; i < num; i++){
+      pBuf[i] = _pWire->read();
+  }
+  return num;
+}
+
+DFRobot_IICSerialFrame::DFRobot_IICSerialFrame(DFRobot_IICSerialBase &port, uint8_t *pBuf, size_t size){
+  _pPort = &port;
+  _pBuf = pBuf;
+  _size = size;
+  _callback = NULL;
+  _dropped = 0;
+  _lenOffset = 0;
+  _lenExtra = 0;
+  setDelimiter('\n');
+}
+
+void DFRobot_IICSerialFrame::setDelimiter(uint8_t delimiter){
+  _mode = eFrameDelimiter;
+  _delimiter = delimiter;
+  reset();
+}
+
+void DFRobot_IICSerialFrame::setLengthPrefix(uint8_t offset, uint8_t extra){
+  if(offset >= _size){
+      DBG("LENGTH OFFSET ERROR!");
       return;
   }
-  _addr = updateAddr(_addr, _subSerialChannel, DFROBOT_IICSERIAL_OBJECT_FIFO);
-  uint8_t *_pBuf = (uint8_t *)pBuf;
-  size_t left = size;
-  while(left){
-      size = (left > DFROBOT_IICSERIAL_IIC_BUFFER_SIZE) ? DFROBOT_IICSERIAL_IIC_BUFFER_SIZE: left;
-      _pWire->beginTransmission(_addr);
-      _pWire->write(_pBuf, size);
-      if(_pWire->endTransmission() != 0){
-          return;
+  _mode = eFrameLength;
+  _lenOffset = offset;
+  _lenExtra = extra;
+  reset();
+}
+
+void DFRobot_IICSerialFrame::setIdleGap(){
+  _mode = eFrameIdle;
+  reset();
+}
+
+void DFRobot_IICSerialFrame::reset(){
+  _len = 0;
+  _total = 0;
+  _lenByte = 0;
+  _drop = false;
+}
+
+size_t DFRobot_IICSerialFrame::poll(){
+  const uint8_t *pData = NULL;
+  size_t n = 0, frames = 0;
+  while((n = _pPort->peekSpan(&pData)) != 0){
+      size_t take = n;
+      bool end = false;
+      if(_mode == eFrameDelimiter){
+          //memchr() is the C library scan, word at a time on most 32-bit cores
+          const uint8_t *p = (const uint8_t *)memchr(pData, _delimiter, n);
+          if(p != NULL){
+              take = p - pData + 1;
+              end = true;
+          }
+      }else if(_mode == eFrameLength){
+          size_t need = (_len <= _lenOffset) ? (_lenOffset + 1 - _len) : (_total - _len);
+          if(take > need){
+              take = need;
+          }
+      }
+      if(_pPort->peekError(take)){
+          _drop = true;
+      }
+      if((_mode == eFrameLength) && (_len <= _lenOffset) && (_len + take > _lenOffset)){
+          //Kept apart from _pBuf, which a dropped frame does not fill, its length still has to be skipped
+          _lenByte = pData[_lenOffset - _len];
+      }
+      append(pData, take);
+      _pPort->consume(take);
+      if(_mode == eFrameLength){
+          if(_len == (size_t)_lenOffset + 1){
+              _total = _len + _lenByte + _lenExtra;
+          }
+          end = (_len > _lenOffset) && (_len == _total);
       }
-      delay(10);
-      left -= size;
-      _pBuf = _pBuf + size;
+      if(end){
+          frames += endFrame();
+      }
+  }
+  if((_mode == eFrameIdle) && _len && _pPort->isRxIdle()){
+      frames += endFrame();
+  }
+  return frames;
+}
+
+void DFRobot_IICSerialFrame::append(const uint8_t *pData, size_t size){
+  if(_len + size > _size){
+      _drop = true;
+  }
+  if(!_drop){
+      memcpy(_pBuf + _len, pData, size);
+  }
+  _len += size;
+}
+
+size_t DFRobot_IICSerialFrame::endFrame(){
+  size_t ret = 0;
+  if(_drop){
+      DBG("FRAME DROPPED!");
+      _dropped++;
+  }else{
+      onFrame(_pBuf, _len);
+      ret = 1;
+  }
+  reset();
+  return ret;
+}
+
+void DFRobot_IICSerialFrame::onFrame(const uint8_t *pFrame, size_t size){
+  if(_callback != NULL){
+      _callback(_pPort, pFrame, size);
   }
 }
@@ -35,23 +35,222 @@
 #define DBG(...)
 #endif
 
-#if !defined(SERIAL_RX_BUFFER_SIZE)
-#if ((RAMEND - RAMSTART) < 1023)
-#define SERIAL_RX_BUFFER_SIZE 16
+#if 0  //< Change 0 to 1 to read back every configuration register write and report mismatches in debug information
+#define DFROBOT_IICSERIAL_VERIFY_WRITE
+#endif
+
+#if 0  //< Change 0 to 1 to count IIC transactions, errors and stalls of every sub UART, read them through getStats()
+#define DFROBOT_IICSERIAL_STATS
+#endif
+
+#if !defined(DFROBOT_IICSERIAL_RX_BUFFER_SIZE)
+#if defined(RAMEND) && ((RAMEND - RAMSTART) < 1023)
+#define DFROBOT_IICSERIAL_RX_BUFFER_SIZE 16     //< Default receive buffer of DFRobot_IICSerial, must be a power of 2
+#elif defined(__AVR__)
+#define DFROBOT_IICSERIAL_RX_BUFFER_SIZE 64
+#else
+#define DFROBOT_IICSERIAL_RX_BUFFER_SIZE 256
+#endif
+#endif
+
+#if !defined(DFROBOT_IICSERIAL_TX_BUFFER_SIZE)
+#if defined(RAMEND) && ((RAMEND - RAMSTART) < 1023)
+#define DFROBOT_IICSERIAL_TX_BUFFER_SIZE 16     //< Default transmit buffer of DFRobot_IICSerial, must be a power of 2
 #else
-#define SERIAL_RX_BUFFER_SIZE 32
+#define DFROBOT_IICSERIAL_TX_BUFFER_SIZE 32
 #endif
 #endif
-#if  (SERIAL_RX_BUFFER_SIZE>256)
-typedef uint16_t rx_buffer_index_t;
+
+#if !defined(DFROBOT_IICSERIAL_CHIP_MAX)
+#define DFROBOT_IICSERIAL_CHIP_MAX 4  //< IA1/IA0 select one of 4 modules on a bus
+#endif
+
+#if !defined(DFROBOT_IICSERIAL_ASYNC) && !defined(__AVR__)
+#define DFROBOT_IICSERIAL_ASYNC   //< pollAsync() moves data with queued transfers, left out on AVR to save RAM
+#endif
+
+#if !defined(DFROBOT_IICSERIAL_THREAD_SAFE) && defined(ESP32)
+#define DFROBOT_IICSERIAL_THREAD_SAFE   //< Ports may be used from several FreeRTOS tasks, see DFRobot_IICSerialTransport::lock()
+#endif
+
+#if defined(ESP32) || defined(ESP8266)
+#define DFROBOT_IICSERIAL_ISR_ATTR IRAM_ATTR
+#else
+#define DFROBOT_IICSERIAL_ISR_ATTR
+#endif
+
+#ifdef ARDUINO_ARCH_NRF5
+#define DFROBOT_IICSERIAL_IIC_BUFFER_SIZE      63       //< micro:bit IIC can transmit at most 63 bytes each time 
+#elif ARDUINO_ARCH_MPYTHON
+#define DFROBOT_IICSERIAL_IIC_BUFFER_SIZE      31       //< mPython IIC can transmit at most 31 bytes each time 
 #else
-typedef uint8_t rx_buffer_index_t;
+#define DFROBOT_IICSERIAL_IIC_BUFFER_SIZE      32       //< UNO, Mega2560, Leonardo(AVR series), IIC can transmit at most 32 bytes each time
+#endif
+
+/**
+ * @brief IIC bus access of the module. DFRobot_IICSerialWireTransport(TwoWire) is used by default, implement this
+ * @n interface to run the module over another IIC driver, e.g. a DMA driver of the MCU vendor.
+ * @n A transport that queues transfers must finish the queued ones before a blocking call accesses the bus.
+ */
+class DFRobot_IICSerialTransport{
+public:
+  /**
+   * @struct sTransfer_t
+   * @brief One IIC transfer: write txSize bytes, then read rxSize bytes if any. It belongs to the transport from
+   * @n submit() until the callback is called.
+   */
+  typedef struct sTransfer{
+      uint8_t addr;              /**< 7-bits IIC address */
+      const uint8_t *pTx;        /**< Data to be written, NULL for a read only transfer */
+      size_t txSize;
+      uint8_t *pRx;              /**< Data to be read, NULL for a write only transfer */
+      size_t rxSize;
+      void (*callback)(struct sTransfer *pTransfer); /**< Called once the transfer is finished, only from submit() or poll(), never from an interrupt */
+      void *pContext;            /**< Free for the owner of the transfer */
+      int8_t result;             /**< 0 if the transfer succeeded, otherwise non-zero */
+      struct sTransfer *pNext;   /**< Queue of the transport */
+  } sTransfer_t;
+
+  /**
+   * @fn begin
+   * @brief Init the IIC bus
+   */
+  virtual void begin() = 0;
+
+  /**
+   * @fn write
+   * @brief Write data in one transaction
+   * @param addr 7-bits IIC address
+   * @param pBuf Data to be written
+   * @param size Length of the data, at most getMaxTransfer()
+   * @return Return 0 if the device acknowledged everything, otherwise non-zero
+   */
+  virtual uint8_t write(uint8_t addr, const uint8_t *pBuf, size_t size) = 0;
+
+  /**
+   * @fn read
+   * @brief Read data in one transaction
+   * @param addr 7-bits IIC address
+   * @param pBuf Store buffer for the data to be read
+   * @param size Length of the data, at most getMaxTransfer()
+   * @return Return the number of bytes read
+   */
+  virtual size_t read(uint8_t addr, uint8_t *pBuf, size_t size) = 0;
+
+  /**
+   * @fn writeRead
+   * @brief Write the register address and read the register, two transactions by default. A transport that can
+   * @n combine them with a repeated start overrides it.
+   * @param addr 7-bits IIC address
+   * @param pTx Data to be written
+   * @param txSize Length of the data to be written
+   * @param pRx Store buffer for the data to be read
+   * @param rxSize Length of the data to be read
+   * @return Return the number of bytes read, 0 if the write was not acknowledged
+   */
+  virtual size_t writeRead(uint8_t addr, const uint8_t *pTx, size_t txSize, uint8_t *pRx, size_t rxSize);
+
+  /**
+   * @fn submit
+   * @brief Queue a transfer, the callback is called when it is finished. By default the transfer is done at once
+   * @n and the callback is called before submit() returns. A transport with a queue or DMA overrides it, returns
+   * @n before the transfer is done and calls the callback from poll().
+   * @param pTransfer The transfer
+   * @return Return 0 if the transfer was queued, otherwise non-zero and the callback is not called
+   */
+  virtual int submit(sTransfer_t *pTransfer);
+
+  /**
+   * @fn poll
+   * @brief Advance queued transfers and call the callbacks of the finished ones. A transport driven by DMA or
+   * @n interrupts only marks a transfer finished in its interrupt handler, the callback waits for poll().
+   */
+  virtual void poll(){}
+
+  /**
+   * @fn getMaxTransfer
+   * @brief Get the longest transaction the IIC driver supports
+   * @return Return the number of bytes
+   */
+  virtual size_t getMaxTransfer(){return DFROBOT_IICSERIAL_IIC_BUFFER_SIZE;}
+
+  /**
+   * @fn lock
+   * @brief Take the bus for a sequence of transfers, e.g. a page switch and the register writes that follow.
+   * @n Only called when DFROBOT_IICSERIAL_THREAD_SAFE is defined, and nested by the same thread, so it has to be
+   * @n recursive. A recursive FreeRTOS mutex on ESP32 by default, nothing elsewhere, override lock() and
+   * @n unlock() for another RTOS. Transfer callbacks are only called from submit() or poll(), see sTransfer_t,
+   * @n so they may take the lock as well.
+   */
+  virtual void lock();
+
+  /**
+   * @fn unlock
+   * @brief Release the bus taken by lock()
+   */
+  virtual void unlock();
+
+#if defined(DFROBOT_IICSERIAL_THREAD_SAFE) && defined(ESP32)
+private:
+  SemaphoreHandle_t _mutex = NULL; //< Created on the first lock(), a transport may be used before setup()
 #endif
+};
+
+/**
+ * @brief Holds the lock of a transport for its scope, see DFRobot_IICSerialTransport::lock()
+ */
+class DFRobot_IICSerialLock{
+public:
+  DFRobot_IICSerialLock(DFRobot_IICSerialTransport *pBus):_pBus(pBus){
+    if(_pBus != NULL){
+        _pBus->lock();
+    }
+  }
+  ~DFRobot_IICSerialLock(){
+    if(_pBus != NULL){
+        _pBus->unlock();
+    }
+  }
+
+private:
+  DFRobot_IICSerialTransport *_pBus;
+};
 
+/**
+ * @brief Blocking transport on a TwoWire bus. The objects live in a static pool without runtime constructor, so
+ * @n they are ready before any global port.
+ */
+class DFRobot_IICSerialWireTransport : public DFRobot_IICSerialTransport{
+public:
+  constexpr DFRobot_IICSerialWireTransport(TwoWire *pWire = NULL):_pWire(pWire){}
+
+  /**
+   * @fn get
+   * @brief Get the transport of a TwoWire bus, the same object for every call with the same bus
+   * @param pWire I2C bus pointer object
+   * @return Return the transport, NULL if DFROBOT_IICSERIAL_CHIP_MAX buses are used
+   */
+  static DFRobot_IICSerialWireTransport *get(TwoWire *pWire);
+
+  virtual void begin();
+  virtual uint8_t write(uint8_t addr, const uint8_t *pBuf, size_t size);
+  virtual size_t read(uint8_t addr, uint8_t *pBuf, size_t size);
+
+private:
+  TwoWire *_pWire;
+  static DFRobot_IICSerialWireTransport _pool[DFROBOT_IICSERIAL_CHIP_MAX];
+};
+
+class DFRobot_IICSerialChip;
+
+/**
+ * @brief Sub UART port, the receive and transmit buffers are provided by DFRobot_IICSerialPort.
+ * @n Use DFRobot_IICSerial for the default buffer sizes.
+ */
 #ifdef ARDUINO_ARCH_NRF5
-class DFRobot_IICSerial : public _Stream{
+class DFRobot_IICSerialBase : public _Stream{
 #else
-class DFRobot_IICSerial : public Stream{
+class DFRobot_IICSerialBase : public Stream{
 #endif
 public:
   /**
@@ -76,16 +275,23 @@ public:
   #define DFROBOT_IICSERIAL_ERR_OK                0
   #define DFROBOT_IICSERIAL_ERR_REGDATA          -1
   #define DFROBOT_IICSERIAL_ERR_READ             -2
+  #define DFROBOT_IICSERIAL_ERR_CHIP             -3       //< More than DFROBOT_IICSERIAL_CHIP_MAX modules are used
   #define DFROBOT_IICSERIAL_FOSC                 14745600L//< External cystal frequency 14.7456MHz
   #define DFROBOT_IICSERIAL_OBJECT_REGISTER      0x00     //< Register object 
   #define DFROBOT_IICSERIAL_OBJECT_FIFO          0x01     //< FIFO buffer object 
-#ifdef ARDUINO_ARCH_NRF5
-  #define DFROBOT_IICSERIAL_IIC_BUFFER_SIZE      63       //< micro:bit IIC can transmit at most 63 bytes each time 
-#elif ARDUINO_ARCH_MPYTHON
-  #define DFROBOT_IICSERIAL_IIC_BUFFER_SIZE      31       //< mPython IIC can transmit at most 31 bytes each time 
-#else
-  #define DFROBOT_IICSERIAL_IIC_BUFFER_SIZE      32       //< UNO, Mega2560, Leonardo(AVR series), IIC can transmit at most 32 bytes each time
-#endif
+  #define DFROBOT_IICSERIAL_SHADOW_REG_NUM       5        //< Shadowed sub UART registers per page, 0x04~0x08
+
+  #define DFROBOT_IICSERIAL_LINE_ERR_BI          0x01     //< Line-Break
+  #define DFROBOT_IICSERIAL_LINE_ERR_PE          0x02     //< Parity error
+  #define DFROBOT_IICSERIAL_LINE_ERR_FE          0x04     //< Frame error
+  #define DFROBOT_IICSERIAL_LINE_ERR_OE          0x08     //< Receive FIFO overflow
+  #define DFROBOT_IICSERIAL_LINE_ERR_MASK        0x0F
+
+  /**
+   * @brief Called when the transmitted data has completely left the TX pin
+   * @param pPort The sub UART that finished transmitting
+   */
+  typedef void (*txCompleteCallback_t)(DFRobot_IICSerialBase *pPort);
 
   typedef enum{
       eNormalMode = 0,
@@ -97,6 +303,26 @@ public:
       //eLineBreak
   }eLineBreakOutput_t;
 
+  /**
+   * @struct sStats_t
+   * @brief Counters of a sub UART, only updated when DFROBOT_IICSERIAL_STATS is defined.
+   * @n Accesses to the global registers(GENA/GRST/GIER/GIFR) are counted on sub UART1.
+   */
+  typedef struct{
+      uint32_t iicTransactions; /**< IIC transactions, a register read counts as 2(address write and data read) */
+      uint32_t iicErrors;       /**< NACKs and short reads */
+      uint32_t rxBytes;         /**< Bytes read from the receive FIFO */
+      uint32_t txBytes;         /**< Bytes written into the transmit FIFO */
+      uint32_t rxOverruns;      /**< FSR reads that reported a receive FIFO overflow(RFOE) */
+      uint32_t parityErrors;    /**< FSR reads that reported a parity error(RFPE) */
+      uint32_t frameErrors;     /**< FSR reads that reported a frame error(RFFE) */
+      uint32_t lineBreaks;      /**< FSR reads that reported a Line-Break(RFBI) */
+      uint32_t txStalls;        /**< Times write() found the software transmit buffer full */
+      uint32_t txBlockedUs;     /**< Time write() spent waiting for transmit FIFO space, in microseconds */
+      uint32_t sleeps;          /**< Times SLEEPEN was set */
+      uint32_t rxWakeups;       /**< Times received data woke the sub UART up */
+  } sStats_t;
+
 protected:
   /**
    * @struct sIICAddr_t
@@ -211,6 +437,41 @@ protected:
       uint8_t rFoe : 1;  /**< Sub UART receive FIFO data overflow error flag bit, 0-no OE error, 1-OE error */
   } __attribute__ ((packed)) sFsrReg_t;
 
+ /**
+  * @struct sSifrReg_t
+  * @brief SIFR description of WK2132 sub UART interrupt flag register:
+  * @n --------------------------------------------------------------------------------------------
+  * @n |    b7    |   b6   |   b5   |   b4   |      b3     |     b2     |     b1     |     b0     |
+  * @n --------------------------------------------------------------------------------------------
+  * @n | FERR_INT |          RSV             | TFEMPTY_INT | TFTRIG_INT | RXOVT_INT  | RFTRIG_INT |
+  * @n --------------------------------------------------------------------------------------------
+  */
+  typedef struct{
+      uint8_t rFTrig : 1;  /**< Receive FIFO contact interrupt flag bit, 1-the receive FIFO reaches the trigger level */
+      uint8_t rxOvt : 1;   /**< Receive FIFO timeout interrupt flag bit, 1-data has been waiting in the receive FIFO too long */
+      uint8_t tfTrig : 1;  /**< Transmit FIFO contact interrupt flag bit, 1-the transmit FIFO falls below the trigger level */
+      uint8_t tFEmpty : 1; /**< Transmit FIFO null interrupt flag bit, 1-the transmit FIFO is null */
+      uint8_t rsv : 3;     /**< Reserved bit */
+      uint8_t fErr: 1;     /**< Receive FIFO data error interrupt flag bit, 1-there is error data in the receive FIFO */
+  } __attribute__ ((packed)) sSifrReg_t;
+
+  /**
+   * @struct sLsrReg_t
+   * @brief LSR description of WK2132 sub UART receive status register, the status of the next byte read from the receive FIFO:
+   * @n -------------------------------------------------------------------------
+   * @n |   b7   |   b6   |   b5   |   b4   |   b3   |   b2   |   b1   |   b0   |
+   * @n -------------------------------------------------------------------------
+   * @n |                  RSV              |   OE   |   FE   |   PE   |   BI   |
+   * @n -------------------------------------------------------------------------
+   */
+  typedef struct{
+      uint8_t bi : 1;  /**< Line-Break flag bit, 1-the byte was received during a Line-Break */
+      uint8_t pe : 1;  /**< Parity error flag bit, 1-the byte has a parity error */
+      uint8_t fe : 1;  /**< Frame error flag bit, 1-the byte has no valid stop bit */
+      uint8_t oe : 1;  /**< Overflow flag bit, 1-the receive FIFO overflowed before this byte */
+      uint8_t rsv : 4; /**< Reserved bit */
+  } __attribute__ ((packed)) sLsrReg_t;
+
   
   typedef enum{
       clock = 0, /**< Operate global control register, control sub UART clock */
@@ -225,28 +486,6 @@ protected:
   }ePageNumber_t;
 
 public:
-  /**
-   * @fn DFRobot_IICSerial
-   * @brief Constructor
-   * @param wire I2C bus pointer object, default Wire
-   * @param subUartChannel sub UART channel, WK2132 has two sub UARTs: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
-   * @param IA1 corresponds with IA1 Level(0 or 1) of DIP switch on the module, and is used for configuring 
-   * @n the IIC address of the 6th bit value(default: 1).
-   * @param IA0 corresponds with IA0 Level(0 or 1) of DIP switch on the module, and is used for configuring
-   * @n IIC address of the 5th bit value(default: 1).
-   * @n IIC address configuration: 
-   * @n 7   6   5   4   3   2   1   0
-   * @n 0  IA1 IA0  1   0  C1  C0  0/1
-   * @n IIC address only has 7 bits, while there are 8 bits for one byte, so the extra one bit will be filled as 0. 
-   * @n The 6th bit corresponds with IA1 Level of DIP switch, can be configured manually.
-   * @n The 5th bit corresponds with IA0 Level of DIP switch, can be configured manually. 
-   * @n The 4th and 3rd bits are fixed, value 1 and 0 respectively.
-   * @n The values of the 2nd and 1st bits are the sub UART channels, 00 for sub UART 1, 01 for sub UART 2. 
-   * @n The 0 bit represents the operation object: 0 for register, 1 for FIFO cache.
-   */
-  DFRobot_IICSerial(TwoWire &wire = Wire, uint8_t subUartChannel = SUBUART_CHANNEL_1, uint8_t IA1 = 1, uint8_t IA0 = 1);
-  ~DFRobot_IICSerial();
-
   /**
    * @fn begin(long unsigned baud)
    * @brief Init function, set band rate of sub UART
@@ -268,6 +507,36 @@ public:
    */
   int begin(long unsigned baud, uint8_t format){return begin(baud, format, eNormalMode, eNormal);}
 
+  /**
+   * @fn setBaud
+   * @brief Change the band rate of a running sub UART, e.g. after a speed negotiation, without begin().
+   * @n The sub UART is not reset: data written before is sent with the old band rate first(flush(), the bus is not
+   * @n held meanwhile), received data stays in the receive FIFO and the receive buffer. Only BAUD1/BAUD0/PRES are
+   * @n written while the sub UART is disabled in SCR, registers that keep their value are skipped, at most 7 IIC
+   * @n transactions.
+   * @n A byte arriving while it is disabled is lost, so switch while the peer is silent.
+   * @param baud Band rate, see begin()
+   * @return Return 0 if it succeeds, otherwise return non-zero
+   */
+  int setBaud(unsigned long baud){return reconfigure(baud, _format);}
+
+  /**
+   * @fn setBaud
+   * @brief Change the band rate and the data format of a running sub UART, see setBaud(baud)
+   * @param baud Band rate, see begin()
+   * @param format Data format, see begin(), LCR is written once the new band rate is set
+   * @return Return 0 if it succeeds, otherwise return non-zero
+   */
+  int setBaud(unsigned long baud, uint8_t format){return reconfigure(baud, format);}
+
+  /**
+   * @fn setFormat
+   * @brief Change the data format of a running sub UART, only LCR is written, see setBaud(baud)
+   * @param format Data format, see begin()
+   * @return Return 0 if it succeeds, otherwise return non-zero
+   */
+  int setFormat(uint8_t format){return reconfigure(0, format);}
+
   /**
    * @fn end
    * @brief Release sub UART to clean up all registers in Sub UART. Call function begin() again to make it work.
@@ -277,7 +546,7 @@ public:
   /**
    * @fn available
    * @brief Get the number of bytes in receive buffer, it should be the total number of bytes in FIFO
-   * @n receive buffer(256B) and self-defined _rx_buffer(31B).
+   * @n receive buffer(256B) and self-defined _rx_buffer(RX_SIZE - 1 bytes).
    * @return Return the number of bytes in receive buffer
    */
   virtual int available(void);
@@ -285,6 +554,7 @@ public:
   /**
    * @fn peek
    * @brief Return the data of 1 byte without deleting the data in the receive buffer
+   * @n The receive buffer is refilled from the FIFO in bursts only when it is empty.
    * @return Return the readings
    */
   virtual int peek(void);
@@ -292,31 +562,110 @@ public:
   /**
    * @fn read(void)
    * @brief Read 1 byte in receive buffer, this operation will delete the data in the buffer.
+   * @n The receive buffer is refilled from the FIFO in bursts only when it is empty.
    * @return Return the readings
    */
   virtual int read(void);
 
   /**
    * @fn read(void *pBuf, size_t size)
-   * @brief Read a specified number of character from FIFO and store them into a array. 
-   * @n This operation doesn't involve receive buffer. 
+   * @brief Read at most size characters and store them into a array, this operation will delete the data.
+   * @n The receive buffer is emptied first, then the rest is read from FIFO in bursts straight into pBuf.
    * @param pBuf Array for storing data 
-   * @param size The number of character to be read
-   * @return Return the readings
+   * @param size The maximum number of character to be read
+   * @return Return the number of characters read
    */
   size_t read(void *pBuf, size_t size);
 
+  /**
+   * @fn peekSpan
+   * @brief Get the data at the front of the receive buffer without copying or deleting it, the receive buffer
+   * @n is refilled from FIFO when it is empty. Data that wraps around the end of the receive buffer is
+   * @n returned by the next call after consume().
+   * @param ppData Return the pointer to the data, valid until the next read, peek or consume
+   * @return Return the number of contiguous bytes at *ppData, 0 if there is no data
+   */
+  size_t peekSpan(const uint8_t **ppData);
+
+  /**
+   * @fn consume
+   * @brief Delete data from the front of the receive buffer, after parsing it through peekSpan()
+   * @param size The number of bytes to be deleted
+   */
+  void consume(size_t size);
+
   /**
    * @fn flush
-   * @brief Wait for the data to be transmited completely
+   * @brief Wait for the data to be transmited completely: the software transmit buffer and the transmit FIFO are
+   * @n empty and the last stop bit has left the TX pin. It gives up after the time the buffered data needs on the
+   * @n line at the current band rate, so a missing module cannot hang the program.
    */
   virtual void flush(void);
 
+  /**
+   * @fn isTxComplete
+   * @brief Non-blocking flush: move buffered data into the transmit FIFO and check whether the transmission is complete.
+   * @n In interrupt mode the transmit FIFO null interrupt is used, otherwise FSR(TDAT, TBUSY) is read.
+   * @return Return true if every byte written has completely left the TX pin
+   */
+  bool isTxComplete();
+
+  /**
+   * @fn setTxCompleteCallback
+   * @brief Set the function called when the transmission is complete, e.g. to switch a RS-485 transceiver back to
+   * @n receive. It is called from poll()/flush()/isTxComplete() or DFRobot_IICSerialChip::poll()/pollAll(),
+   * @n never from the interrupt handler.
+   * @param cb Callback, NULL to remove it
+   */
+  void setTxCompleteCallback(txCompleteCallback_t cb){_txCallback = cb;}
+
+  /**
+   * @fn getTxTurnaround
+   * @brief Get the time from the last write() to the line going idle of the last completed transmission,
+   * @n including the time the data needed on the line
+   * @return Return the time in microseconds
+   */
+  uint32_t getTxTurnaround(){return _txTurnaroundUs;}
+
+  /**
+   * @fn enableRS485
+   * @brief Enter RS-485 half-duplex mode: the DE pin(DE and /RE tied together) of the transceiver is driven active
+   * @n before the first byte of a frame reaches the transmit FIFO and released as soon as the transmit FIFO is empty
+   * @n and the last stop bit has left the TX pin(TBUSY). A new frame is held back until the inter-frame gap has
+   * @n passed. The release is detected by poll(), available(), flush(), isTxComplete() or
+   * @n DFRobot_IICSerialChip::poll()/pollAll(), so call one of them while waiting for the answer.
+   * @n getTxTurnaround() then reports the time from the last write() until DE was released.
+   * @param dePin MCU pin connected to DE and /RE of the transceiver
+   * @param deActiveHigh true: DE is driven HIGH to transmit(default), false: driven LOW
+   */
+  void enableRS485(uint8_t dePin, bool deActiveHigh = true);
+
+  /**
+   * @fn disableRS485
+   * @brief Leave RS-485 mode, the DE pin is left in receive level
+   */
+  void disableRS485();
+
+  /**
+   * @fn getCharTime
+   * @brief Get the time of one character on the line at the current band rate and data format
+   * @return Return the time in microseconds, 0 before begin()
+   */
+  uint32_t getCharTime();
+
+  /**
+   * @fn getInterFrameGap
+   * @brief Get the minimum idle time between two frames: 3.5 character times, and 1750us above 19200 band rate
+   * @n as the Modbus RTU specification requires
+   * @return Return the time in microseconds
+   */
+  uint32_t getInterFrameGap();
+
   /**
    * @fn write
    * @brief Write one byte into transmit FIFO cache.The following are the overload functions of the byte of different data type. 
    * @param n data to be written
-   * @return Return 0 if it succeeds, otherwise return -1
+   * @return Return 1 if it succeeds, return 0 if the transmit FIFO is full
    */
   virtual size_t write(uint8_t n);
   inline size_t write(unsigned long n) { return write((uint8_t)n); }
@@ -326,16 +675,241 @@ public:
  
   /**
    * @fn write
-   * @brief Write data into transmit FIFO cache
-   * @param pBuf Store buffer for the data to be read
-   * @param size Length of the data to be read
-   * @return Output the number of bytes
+   * @brief Write data into transmit FIFO cache, as many bytes as the 256 bytes transmit FIFO has room for
+   * @param pBuf Store buffer for the data to be written
+   * @param size Length of the data to be written
+   * @return Output the number of bytes, less than size when the transmit FIFO is full
    */
   virtual size_t write(const uint8_t *pBuf, size_t size);
   using Print::write; /*!< pull in write(str) and write(buf, size) from Print */
   operator bool() { return true; }
 
+  /**
+   * @fn availableForWrite
+   * @brief Get the free space of the software transmit buffer, no IIC transaction is involved
+   * @return Return the number of bytes that can be written without waiting
+   */
+  virtual int availableForWrite(void);
+
+  /**
+   * @fn poll
+   * @brief Move the data of the software transmit buffer into the transmit FIFO in maximal bursts.
+   * @n Call it from loop() when deferred transmit is enabled, it never waits for FIFO space.
+   * @return Return the number of bytes moved into the transmit FIFO
+   */
+  size_t poll(void);
+
+  /**
+   * @fn pollAsync
+   * @brief Like poll() and a receive buffer refill, but through queued transfers of the transport: RFCNT, then the
+   * @n receive FIFO burst straight into the receive buffer, and TFCNT, then the transmit buffer straight into the
+   * @n transmit FIFO. Each step is queued from the callback of the one before, so with a DMA transport the call
+   * @n returns at once. Falls back to poll() in interrupt mode, with error tracking enabled, or when
+   * @n DFROBOT_IICSERIAL_ASYNC is not defined(AVR).
+   * @n RFCNT and TFCNT read 0 for a null and a full FIFO alike, FSR and a second count read tell them apart.
+   * @return Return true while transfers are still in flight
+   */
+  bool pollAsync(void);
+
+  /**
+   * @fn setTxDeferred
+   * @brief Set whether write() only queues data in the software transmit buffer
+   * @param enable true: write() returns after queueing and the data is sent by poll()/flush() or when
+   * @n the buffer fills up, so many small print() calls share IIC transactions.
+   * @n false(default): write() queues and sends immediately.
+   */
+  void setTxDeferred(bool enable){_txDeferred = enable;}
+
+  /**
+   * @fn attachInterruptPin
+   * @brief Enter interrupt mode, call it after begin(). The IRQ pin of the module is watched with an external
+   * @n interrupt and the bus is only accessed when it is asserted: GIFR is read once to find the sub UART that
+   * @n fired and SIFR to find why, then the receive FIFO is drained or the transmit buffer is refilled.
+   * @n Both sub UARTs of a module, or several modules, may share one IRQ line.
+   * @param pin MCU pin connected to the IRQ pin of the module, it must support external interrupt
+   * @return Return 0 if it succeeds, return -1 if the port got no module object, all DFROBOT_IICSERIAL_CHIP_MAX
+   * @n of the pool being used by other modules
+   */
+  int attachInterruptPin(uint8_t pin);
+
+  /**
+   * @fn detachInterruptPin
+   * @brief Leave interrupt mode and go back to polling the FIFO registers
+   */
+  void detachInterruptPin();
+
+  /**
+   * @fn getChip
+   * @brief Get the object of the module this sub UART belongs to, call its poll() to service both sub UARTs
+   * @n of the module in one cycle.
+   * @return Return the module object, NULL if all DFROBOT_IICSERIAL_CHIP_MAX modules are used
+   */
+  DFRobot_IICSerialChip *getChip(){return _pChip;}
+
+  /**
+   * @fn setFIFOTriggerLevel
+   * @brief Set the interrupt trigger levels of the receive and transmit FIFO through RFTL/TFTL on page 1.
+   * @n A low receive level gives low latency for command links, a high one fewer interrupts for streams.
+   * @param rxLevel Receive FIFO contact interrupt fires when the receive FIFO holds at least rxLevel bytes, 1~255,
+   * @n 0 means use the FCR setting(8 bytes)
+   * @param txLevel Transmit FIFO contact interrupt fires when the transmit FIFO holds at most txLevel bytes, 1~255,
+   * @n 0 means use the FCR setting(8 bytes)
+   */
+  void setFIFOTriggerLevel(uint8_t rxLevel, uint8_t txLevel);
+
+  /**
+   * @fn setRxTimeoutInterrupt
+   * @brief Set whether the receive FIFO timeout interrupt is enabled(default enabled). It reports data left below
+   * @n the receive trigger level once the line has been idle for a while, disable it only when the
+   * @n receive trigger level alone is enough to collect every frame.
+   * @param enable true: enable, false: disable
+   */
+  void setRxTimeoutInterrupt(bool enable);
+
+  /**
+   * @fn getStats
+   * @brief Get the counters of this sub UART
+   * @return Return the counters, all 0 if DFROBOT_IICSERIAL_STATS is not defined
+   */
+  sStats_t getStats();
+
+  /**
+   * @fn resetStats
+   * @brief Clear the counters of this sub UART
+   */
+  void resetStats();
+
+  /**
+   * @fn setCrystalFrequency
+   * @brief Set the crystal frequency of the module when it is not the default 14.7456MHz, call it before begin()
+   * @n It is shared by both sub UARTs of the module.
+   * @param fosc Crystal frequency in Hz
+   */
+  void setCrystalFrequency(uint32_t fosc);
+
+  /**
+   * @fn getActualBaud
+   * @brief Get the band rate the sub UART really runs at after begin(), the crystal frequency is divided by
+   * @n 16 * (BAUD + 1 + PRES / 10), so not every band rate can be reached exactly
+   * @return Return the band rate
+   */
+  uint32_t getActualBaud(){return _actualBaud;}
+
+  /**
+   * @fn getBaudError
+   * @brief Get the difference between the actual and the requested band rate
+   * @return Return the error in percent, positive if the sub UART runs faster than requested
+   */
+  float getBaudError();
+
+  /**
+   * @fn baudDivisor
+   * @brief Calculate the divisor for a band rate, also usable at compile time
+   * @param baud Band rate, any rate up to fosc / 16
+   * @param fosc Crystal frequency in Hz
+   * @return Return the divisor in tenths: BAUD1:BAUD0 = divisor / 10, PRES = divisor % 10
+   */
+  static constexpr uint32_t baudDivisor(uint32_t baud, uint32_t fosc = DFROBOT_IICSERIAL_FOSC){
+    return ((baud == 0) || ((fosc * 10 + baud * 8) / (baud * 16) < 10)) ? 0 : ((fosc * 10 + baud * 8) / (baud * 16) - 10);
+  }
+
+  /**
+   * @fn baudRate
+   * @brief Calculate the band rate of a divisor, also usable at compile time
+   * @param divisor Divisor in tenths, see baudDivisor()
+   * @param fosc Crystal frequency in Hz
+   * @return Return the band rate
+   */
+  static constexpr uint32_t baudRate(uint32_t divisor, uint32_t fosc = DFROBOT_IICSERIAL_FOSC){
+    return (fosc * 10 + (divisor + 10) * 8) / ((divisor + 10) * 16);
+  }
+
+  /**
+   * @fn setRxErrorTracking
+   * @brief Set whether the line status of every received byte is tracked(default disabled). Error free data costs
+   * @n no extra bus transaction per byte: FSR is read once per receive FIFO burst in polling mode, and FERR_INT
+   * @n is used in interrupt mode. Only while the receive FIFO holds erroneous data, the bytes are read one by one
+   * @n together with LSR. read(pBuf, size) then always goes through the receive buffer.
+   * @param enable true: enable, false: disable
+   */
+  void setRxErrorTracking(bool enable);
+
+  /**
+   * @fn peekError
+   * @brief Check the next bytes of the receive buffer for line errors without deleting them, call it after
+   * @n peek(), available() or peekSpan() so the bytes are in the receive buffer. Needs setRxErrorTracking(true).
+   * @param size The number of bytes to be checked, from the byte read() returns next
+   * @return Return true if any of them was received with a parity, frame, Line-Break or overflow error
+   */
+  bool peekError(size_t size = 1);
+
+  /**
+   * @fn getLineErrors
+   * @brief Get the line errors seen since the last call, then clear them. Needs setRxErrorTracking(true).
+   * @return Return the OR of DFROBOT_IICSERIAL_LINE_ERR_BI, DFROBOT_IICSERIAL_LINE_ERR_PE,
+   * @n DFROBOT_IICSERIAL_LINE_ERR_FE and DFROBOT_IICSERIAL_LINE_ERR_OE, 0 if there is no error
+   */
+  uint8_t getLineErrors();
+
+  /**
+   * @fn isRxIdle
+   * @brief Whether the receive line is idle, which marks the end of a frame: the receive FIFO timeout interrupt
+   * @n reported it, or the inter-frame gap has passed since the last byte was moved out of the receive FIFO.
+   * @n In polling mode call it after peekSpan(), peek() or read() found no more data. In interrupt mode RFCNT is
+   * @n read once after the gap, as no timeout interrupt follows when the FIFO was drained right at the trigger level.
+   * @return Return true if no byte has arrived since the line went idle
+   */
+  bool isRxIdle();
+
+  /**
+   * @fn sleep
+   * @brief Sub UART enters sleep state: SLEEPEN is set, the sub UART stops its clock as soon as both FIFOs are
+   * @n empty and the line is idle. A start bit on RX or the next write() wakes it up again. The first bytes
+   * @n received while it is asleep may be lost or corrupted, see example 9.sleepWake for the figures of a band rate.
+   */
+  void sleep();
+
+  /**
+   * @fn wakeup
+   * @brief Sub UART wakes up from sleep, SLEEPEN is cleared
+   */
+  void wakeup();
+
+  /**
+   * @fn isSleeping
+   * @brief Whether sleep() or the auto sleep has set SLEEPEN
+   * @return Return true if the sub UART may be asleep
+   */
+  bool isSleeping(){return _sleeping;}
+
+  /**
+   * @fn setAutoSleep
+   * @brief Put the sub UART to sleep after idleMs without a byte received or written(default disabled), and
+   * @n once the transmitter is done.
+   * @n It is checked in poll(), pollAsync(), available() and DFRobot_IICSerialChip::poll()/pollAll(), the next
+   * @n write() or the first byte received wakes it up, and it stays awake until it is idle again. Call it after begin().
+   * @param idleMs Idle period in milliseconds, 0 disables the auto sleep
+   */
+  void setAutoSleep(uint32_t idleMs);
+
 protected:
+  /**
+   * @fn DFRobot_IICSerialBase
+   * @brief Constructor, see DFRobot_IICSerialPort
+   * @param pBus IIC transport of the module, NULL makes every operation fail with DFROBOT_IICSERIAL_ERR_CHIP
+   * @param subUartChannel sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param IA1 IA1 Level(0 or 1) of DIP switch on the module
+   * @param IA0 IA0 Level(0 or 1) of DIP switch on the module
+   * @param pRxBuffer Receive buffer
+   * @param pRxError Error bitmap of the receive buffer, one bit per byte
+   * @param rxSize Size of the receive buffer, a power of 2
+   * @param pTxBuffer Transmit buffer
+   * @param txSize Size of the transmit buffer, a power of 2
+   */
+  DFRobot_IICSerialBase(DFRobot_IICSerialTransport *pBus, uint8_t subUartChannel, uint8_t IA1, uint8_t IA0,
+                        uint8_t *pRxBuffer, uint8_t *pRxError, uint16_t rxSize, uint8_t *pTxBuffer, uint16_t txSize);
+  ~DFRobot_IICSerialBase();
+
   /**
    * @fn begin(long unsigned baud, uint8_t format, eCommunicationMode_t mode, eLineBreakOutput_t opt)
    * @brief Init function, set the band rate of sub UART, data format, communication mode, and Line-Break output
@@ -350,6 +924,15 @@ protected:
    */
   int begin(long unsigned baud, uint8_t format, eCommunicationMode_t mode, eLineBreakOutput_t opt);
 
+  /**
+   * @fn reconfigure
+   * @brief Change band rate and data format without resetting the sub UART, see setBaud()
+   * @param baud Band rate, 0 keeps the current one
+   * @param format Data format
+   * @return Return 0 if it succeeds, otherwise return non-zero
+   */
+  int reconfigure(unsigned long baud, uint8_t format);
+
   /**
    * @fn subSerialConfig
    * @brief Sub UART parameter configuration 
@@ -373,17 +956,9 @@ protected:
    */
   void subSerialRegConfig(uint8_t reg, void *pValue);
 
-  /**
-   * @fn getGlobalRegType
-   * @brief Get global register address
-   * @param type Global register type, all enumeration values in eGlobalRegType_t
-   * @return Return register address
-   */
-  uint8_t getGlobalRegType(eGlobalRegType_t type);
-
   /**
    * @fn setSubSerialBaudRate
-   * @brief Set sub UART band rate
+   * @brief Set sub UART band rate, BAUD1/BAUD0/PRES are calculated by baudDivisor() and only written when they change
    * @param baud Band rate
    */
   void setSubSerialBaudRate(unsigned long baud);
@@ -406,16 +981,6 @@ protected:
    */
   void subSerialPageSwitch(ePageNumber_t page);
 
-  /**
-   * @fn updateAddr
-   * @brief Update module IIC address before starting communication
-   * @param pre The first 5 bits of IIC address, transfered from constructor DFRobot_WK2132
-   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
-   * @param obj Object to be operated: register or FIFO, fill as DFROBOT_IICSERIAL_OBJECT_REGISTER or DFROBOT_IICSERIAL_OBJECT_FIFO
-   * @return Return 8-bits IIC address
-   */
-  uint8_t updateAddr(uint8_t pre, uint8_t subUartChannel, uint8_t obj);
-
   /**
    * @fn readFIFOStateReg
    * @brief Read FIFO state register
@@ -424,24 +989,86 @@ protected:
   sFsrReg_t readFIFOStateReg();
 
   /**
-   * @fn subSerialChnnlSwitch
-   * @brief Sub UART channel switch
-   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
-   * @return Return the switched channel 
+   * @fn readRxFIFOCount
+   * @brief Read the number of bytes waiting in the receive FIFO of the sub UART
+   * @return Return the number of bytes in receive FIFO, 0~256
    */
-  uint8_t subSerialChnnlSwitch(uint8_t subUartChannel);
+  int readRxFIFOCount();
 
   /**
-   * @fn sleep
-   * @brief Sub UART enters sleep state 
+   * @fn fillRxBuffer
+   * @brief Move as many bytes as _rx_buffer can hold from the receive FIFO, reading RFCNT once and then
+   * @n bursting through the FIFO address, up to DFROBOT_IICSERIAL_IIC_BUFFER_SIZE bytes per IIC transaction.
+   * @return Return the number of bytes moved into _rx_buffer
    */
-  void sleep();
+  size_t fillRxBuffer();
 
   /**
-   * @fn wakeup
-   * @brief Sub UART wakes up from sleep 
+   * @fn fillRxBuffer
+   * @brief Move bytes from the receive FIFO into _rx_buffer when the FIFO count is already known
+   * @param num The number of bytes in receive FIFO
+   * @return Return the number of bytes moved into _rx_buffer
    */
-  void wakeup();
+  size_t fillRxBuffer(size_t num);
+
+  /**
+   * @fn fillRxBufferChecked
+   * @brief Move bytes from the receive FIFO into _rx_buffer one by one, reading LSR before each byte to
+   * @n mark the bytes with errors in _rx_error
+   * @param num The number of bytes to be moved, _rx_buffer must have room for them
+   * @return Return the number of bytes moved into _rx_buffer
+   */
+  size_t fillRxBufferChecked(size_t num);
+
+  /**
+   * @fn rxFIFOHasError
+   * @brief Whether the receive FIFO holds erroneous data, from FERR_INT in interrupt mode or FSR otherwise
+   * @return Return true if there is erroneous data
+   */
+  bool rxFIFOHasError();
+
+  /**
+   * @fn copyRxBuffer
+   * @brief Copy data from the front of _rx_buffer and delete it, no IIC transaction is involved
+   * @param pBuf Array for storing data
+   * @param size The maximum number of bytes to be copied
+   * @return Return the number of bytes copied
+   */
+  size_t copyRxBuffer(uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn rxBufferSpace
+   * @brief Get the free space of _rx_buffer
+   * @return Return the number of bytes _rx_buffer can still take
+   */
+  size_t rxBufferSpace();
+
+  /**
+   * @fn rxBufferSpan
+   * @brief Get the contiguous data at the front of _rx_buffer, no IIC transaction is involved
+   * @param ppData Return the pointer to the data
+   * @return Return the number of contiguous bytes
+   */
+  size_t rxBufferSpan(const uint8_t **ppData);
+
+  /**
+   * @fn readTxFIFOSpace
+   * @brief Read the free space of the transmit FIFO of the sub UART from TFCNT
+   * @return Return the number of bytes that can be written, 0~256
+   */
+  int readTxFIFOSpace();
+
+  /**
+   * @fn pollSleep
+   * @brief Put the sub UART to sleep once the auto sleep idle period has passed without data in either direction
+   */
+  void pollSleep();
+
+  /**
+   * @fn rxActivity
+   * @brief Note that bytes were moved out of the receive FIFO, restarts the idle timers and wakes the sub UART
+   */
+  void rxActivity();
 
   /**
    * @fn writeReg
@@ -454,11 +1081,154 @@ protected:
 
   /**
    * @fn writeFIFO
-   * @brief Write FIFO buffer 
+   * @brief Write FIFO buffer, the free space is read from TFCNT and filled back-to-back without delay
+   * @param pBuf Store buffer for the data to be written
+   * @param size Length of the data to be written
+   * @return Return the number of bytes written, stop early when the transmit FIFO is full
+   */
+  size_t writeFIFO(void *pBuf, size_t size);
+
+  /**
+   * @fn writeFIFOBurst
+   * @brief Write FIFO buffer in IIC buffer sized chunks, the caller must make sure the transmit FIFO has room
    * @param pBuf Store buffer for the data to be written
    * @param size Length of the data to be written
+   * @return Return the number of bytes written
+   */
+  size_t writeFIFOBurst(const uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn drainTxBuffer
+   * @brief Move the data of the software transmit buffer into the transmit FIFO, as much as it has room for
+   * @return Return the number of bytes moved
+   */
+  size_t drainTxBuffer();
+
+  /**
+   * @fn waitTxBuffer
+   * @brief Make room in the software transmit buffer when write() finds it full, the wait is counted in the stats
+   * @return Return the number of bytes moved into the transmit FIFO
+   */
+  size_t waitTxBuffer();
+
+  /**
+   * @fn pumpTxBuffer
+   * @brief Refill the transmit FIFO from the software transmit buffer, in interrupt mode only after the
+   * @n transmit FIFO contact interrupt reported free space
+   * @return Return the number of bytes moved
+   */
+  size_t pumpTxBuffer();
+
+  /**
+   * @fn startTx
+   * @brief Mark the start of a transmission before data is queued, in RS-485 mode wait for the inter-frame
+   * @n gap and drive the DE pin active
+   */
+  void startTx();
+
+  /**
+   * @fn checkTxComplete
+   * @brief Read FSR once the software transmit buffer is empty and finish the transmission if the line is idle
+   * @return Return true if the transmission is complete
+   */
+  bool checkTxComplete();
+
+  /**
+   * @fn pollTxComplete
+   * @brief Check for the end of a transmission in polling mode when a callback or the RS-485 DE pin waits for it
+   */
+  void pollTxComplete();
+
+#ifdef DFROBOT_IICSERIAL_ASYNC
+  /**
+   * @fn submitRxData
+   * @brief Queue the next receive FIFO burst into the contiguous free space of _rx_buffer, or end the receive pipeline
+   */
+  void submitRxData();
+
+  /**
+   * @fn submitTxData
+   * @brief Queue the next contiguous piece of _tx_buffer into the transmit FIFO, or end the transmit pipeline
+   */
+  void submitTxData();
+
+  /**
+   * @fn rxCountDone
+   * @brief Callback of the RFCNT read of pollAsync(), FSR is read as well when RFCNT is 0(null or full), and RFCNT
+   * @n again when RDAT is set
+   * @param pTransfer The finished transfer, pContext is the port
+   */
+  static void rxCountDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer);
+
+  /**
+   * @fn rxDataDone
+   * @brief Callback of a receive FIFO burst of pollAsync(), it does no register write of its own, a wakeup from
+   * @n auto sleep is left to the next pollAsync()
+   * @param pTransfer The finished transfer, pContext is the port
+   */
+  static void rxDataDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer);
+
+  /**
+   * @fn txSpaceDone
+   * @brief Callback of the TFCNT read of pollAsync(), FSR is read as well when TFCNT is 0(null or full), and TFCNT
+   * @n again when TFULL is clear
+   * @param pTransfer The finished transfer, pContext is the port
+   */
+  static void txSpaceDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer);
+
+  /**
+   * @fn txDataDone
+   * @brief Callback of a transmit FIFO burst of pollAsync()
+   * @param pTransfer The finished transfer, pContext is the port
+   */
+  static void txDataDone(DFRobot_IICSerialTransport::sTransfer_t *pTransfer);
+#endif
+
+  /**
+   * @fn enterInterruptMode
+   * @brief Keep only the receive interrupts enabled in SIER when the module enters interrupt mode
+   */
+  void enterInterruptMode();
+
+  /**
+   * @fn serviceInterrupt
+   * @brief Read SIFR after GIFR reported this sub UART, then drain the receive FIFO or release the transmit buffer
+   */
+  void serviceInterrupt();
+
+  /**
+   * @fn interruptMode
+   * @brief Whether the module of this sub UART is in interrupt mode
+   * @return Return true if an IRQ pin is attached
+   */
+  inline bool interruptMode();
+
+  /**
+   * @fn updateTxInterrupt
+   * @brief Enable the transmit FIFO contact interrupt only while the software transmit buffer holds data,
+   * @n otherwise an empty transmit FIFO would keep the IRQ line asserted. The transmit FIFO null interrupt
+   * @n takes over after that until the transmission is complete.
    */
-  void writeFIFO(void *pBuf, size_t size);
+  void updateTxInterrupt();
+
+  /**
+   * @fn readRegCached
+   * @brief Read a configuration register through the shadow copy, the bus is only accessed the first time
+   * @n GENA/GIER and SCR/LCR/FCR/SIER/BAUD1/BAUD0/PRES/RFTL/TFTL of the current page are shadowed,
+   * @n other registers are always read from the chip.
+   * @param reg Register address
+   * @return Return the register value
+   */
+  uint8_t readRegCached(uint8_t reg);
+
+  /**
+   * @fn writeRegCached
+   * @brief Write a configuration register in a single transaction and update its shadow copy,
+   * @n the write is skipped if the shadow copy already holds the value.
+   * @param reg Register address
+   * @param val Value to be written
+   */
+  void writeRegCached(uint8_t reg, uint8_t val);
 
   /**
    * @fn readReg
@@ -477,17 +1247,462 @@ protected:
    * @param size Length of the data to be read
    * @return Return the actual length, 0 means failed to read
    */
-  uint8_t readFIFO(void* pBuf, size_t size);
+  size_t readFIFO(void* pBuf, size_t size);
 
 protected:
-  volatile rx_buffer_index_t _rx_buffer_head;
-  volatile rx_buffer_index_t _rx_buffer_tail;
-  unsigned char _rx_buffer[SERIAL_RX_BUFFER_SIZE];
-
+  //Single producer single consumer rings: the bus side owns _rx_buffer_head and _tx_buffer_tail, the application
+  //side _rx_buffer_tail and _tx_buffer_head. With DFROBOT_IICSERIAL_THREAD_SAFE each side stores its own index
+  //with release and loads the other one with acquire ordering, so the data is visible before the index.
+  volatile uint16_t _rx_buffer_head;
+  volatile uint16_t _rx_buffer_tail;
+  uint16_t _rxMask;           //< Size of _rx_buffer - 1, the indices wrap by masking
+  unsigned char *_rx_buffer;
+  uint8_t *_rx_error;         //< One bit per byte of _rx_buffer, set if it was received with a line error
+  volatile uint16_t _tx_buffer_head;
+  volatile uint16_t _tx_buffer_tail;
+  uint16_t _txMask;           //< Size of _tx_buffer - 1
+  unsigned char *_tx_buffer;
+  bool _txDeferred;
+  bool _rxFIFOPending;
+  bool _txWaitIRQ;
+  uint8_t _sier;
+  bool _txActive;
+  uint32_t _txQueuedUs;
+  uint32_t _txTurnaroundUs;
+  txCompleteCallback_t _txCallback;
+  uint32_t _txIdleUs;
+  int _rs485Pin;
+  bool _rs485ActiveHigh;
+  uint8_t _format;
+  uint32_t _baud;
+  uint32_t _actualBaud;
+  bool _rxErrorTracking;
+  bool _rxErrorPending;
+  uint8_t _lineErrors;
+  uint32_t _rxLastUs;         //< micros() when the last byte was moved out of the receive FIFO
+  bool _rxIdle;               //< Set by the receive FIFO timeout interrupt, cleared by the next byte
+  bool _sleeping;             //< SLEEPEN is set
+  uint32_t _autoSleepMs;      //< Idle period of the auto sleep, 0 if disabled
+  uint32_t _activityMs;       //< millis() of the last write() or the last byte moved out of the receive FIFO
+#ifdef DFROBOT_IICSERIAL_ASYNC
+  DFRobot_IICSerialTransport::sTransfer_t _rxTransfer;
+  DFRobot_IICSerialTransport::sTransfer_t _txTransfer;
+  volatile bool _rxAsyncBusy; //< The receive pipeline owns _rx_buffer_head
+  volatile bool _txAsyncBusy; //< The transmit pipeline owns _tx_buffer_tail
+  volatile bool _rxWakePending; //< Data arrived while sleeping, wakeup() is left to the next pollAsync()
+  uint16_t _rxAsyncLeft;      //< Bytes of the receive FIFO still to be read
+  uint16_t _txAsyncLeft;      //< Free space of the transmit FIFO still to be filled
+  uint8_t _rxAsyncReg;        //< Register address written by the receive pipeline
+  uint8_t _rxAsyncVal;        //< Register value read by the receive pipeline
+  uint8_t _txAsyncReg;
+  uint8_t _txAsyncVal;
+  bool _rxAsyncRecount;       //< RFCNT is read again after FSR, 0 now means a full receive FIFO
+  bool _txAsyncRecount;       //< TFCNT is read again after FSR, 0 now means an empty transmit FIFO
+#endif
+#ifdef DFROBOT_IICSERIAL_STATS
+  sStats_t _stats;
+#endif
 
 private:
-  TwoWire *_pWire;
-  uint8_t _addr;
+  friend class DFRobot_IICSerialChip;
+  DFRobot_IICSerialChip *_pChip;
   uint8_t _subSerialChannel;
 };
+
+/**
+ * @brief One WK2132 chip, selected by the IA1/IA0 DIP switch, shared by the ports of its two sub UARTs.
+ * @n It owns the bus access, the global registers, the page state and the IRQ line, so both sub UARTs
+ * @n can be serviced with one GIFR read. Instances live in a static pool and are created by the
+ * @n port constructor, the pool has no constructor so it is ready before any global port.
+ */
+class DFRobot_IICSerialChip{
+public:
+  /**
+   * @fn poll
+   * @brief Service both sub UARTs of the module in one cycle: in interrupt mode read GIFR once and only
+   * @n touch the sub UART that needs work, otherwise drain every receive FIFO. Then refill the transmit FIFOs.
+   * @return Return the number of bytes moved
+   */
+  size_t poll();
+
+  /**
+   * @fn service
+   * @brief Read GIFR once if the IRQ line is asserted and service the sub UARTs that raised it
+   * @return Return the GIFR bits that were set, bit0 for sub UART1, bit1 for sub UART2, 0 if the line is idle
+   */
+  uint8_t service();
+
+  /**
+   * @fn pollAll
+   * @brief Service every module on every bus, up to DFROBOT_IICSERIAL_CHIP_MAX modules(8 sub UARTs).
+   * @n Receive FIFOs are drained fullest first, using RFCNT in polling mode and a pending interrupt
+   * @n in interrupt mode, so the port closest to overrun is served first. Transmit FIFOs are then
+   * @n refilled round-robin so no port is starved. Call it as often as possible from loop().
+   * @return Return the number of bytes moved
+   */
+  static size_t pollAll();
+
+protected:
+  friend class DFRobot_IICSerialBase;
+
+  /**
+   * @fn getChip
+   * @brief Find the chip at an IIC address on a bus, or take a free one from the pool
+   * @param pBus IIC transport of the bus
+   * @param addr IIC address of sub UART1 register object
+   * @return Return the chip, NULL if all DFROBOT_IICSERIAL_CHIP_MAX chips are used
+   */
+  static DFRobot_IICSerialChip *getChip(DFRobot_IICSerialTransport *pBus, uint8_t addr);
+
+  /**
+   * @fn attachPort
+   * @brief Register the port of a sub UART
+   * @param pPort Port object
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   */
+  void attachPort(DFRobot_IICSerialBase *pPort, uint8_t subUartChannel);
+
+  /**
+   * @fn detachPort
+   * @brief Unregister the port of a sub UART, the chip goes back to the pool when no port is left
+   * @param pPort Port object
+   */
+  void detachPort(DFRobot_IICSerialBase *pPort);
+
+  /**
+   * @fn begin
+   * @brief Init the IIC bus and check the module through GENA
+   * @return Return 0 if it succeeds, otherwise return non-zero
+   */
+  int begin();
+
+  /**
+   * @fn attachInterruptPin
+   * @brief Enter interrupt mode for both sub UARTs of the module
+   * @param pin MCU pin connected to the IRQ pin of the module
+   * @return Return 0 if it succeeds
+   */
+  int attachInterruptPin(uint8_t pin);
+
+  /**
+   * @fn detachInterruptPin
+   * @brief Leave interrupt mode, the external interrupt is released when no other module shares the pin
+   */
+  void detachInterruptPin();
+
+  /**
+   * @fn irqHandler
+   * @brief External interrupt handler, only marks the modules in interrupt mode as pending
+   */
+  static void irqHandler();
+
+  /**
+   * @fn globalRegEnable
+   * @brief Set the bits of sub UARTs in a global register, GRST is written without reading it back
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1, SUBUART_CHANNEL_2 or SUBUART_CHANNEL_ALL
+   * @param type Global register type, all enumeration values in eGlobalRegType_t
+   */
+  void globalRegEnable(uint8_t subUartChannel, DFRobot_IICSerialBase::eGlobalRegType_t type);
+
+  /**
+   * @fn getGlobalRegType
+   * @brief Get global register address
+   * @param type Global register type, all enumeration values in eGlobalRegType_t
+   * @return Return register address
+   */
+  uint8_t getGlobalRegType(DFRobot_IICSerialBase::eGlobalRegType_t type);
+
+  /**
+   * @fn pageSwitch
+   * @brief Sub UART register page switch, SPAGE is only written when the tracked page changes
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param page Page number, all enumeration values in ePageNumber_t
+   */
+  void pageSwitch(uint8_t subUartChannel, DFRobot_IICSerialBase::ePageNumber_t page);
+
+  /**
+   * @fn readRegCached
+   * @brief Read a configuration register through the shadow copy, the bus is only accessed the first time
+   * @n GENA/GIER and SCR/LCR/FCR/SIER/BAUD1/BAUD0/PRES/RFTL/TFTL of the current page are shadowed,
+   * @n other registers are always read from the chip.
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param reg Register address
+   * @return Return the register value
+   */
+  uint8_t readRegCached(uint8_t subUartChannel, uint8_t reg);
+
+  /**
+   * @fn writeRegCached
+   * @brief Write a configuration register in a single transaction and update its shadow copy,
+   * @n the write is skipped if the shadow copy already holds the value.
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param reg Register address
+   * @param val Value to be written
+   */
+  void writeRegCached(uint8_t subUartChannel, uint8_t reg, uint8_t val);
+
+  /**
+   * @fn resetRegCache
+   * @brief Load the reset values of the sub UART registers into the shadow copy after a software reset
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   */
+  void resetRegCache(uint8_t subUartChannel);
+
+  /**
+   * @fn updateAddr
+   * @brief Get the IIC address of an object of a sub UART
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param obj Object to be operated: register or FIFO, fill as DFROBOT_IICSERIAL_OBJECT_REGISTER or DFROBOT_IICSERIAL_OBJECT_FIFO
+   * @return Return 7-bits IIC address
+   */
+  uint8_t updateAddr(uint8_t subUartChannel, uint8_t obj);
+
+  /**
+   * @fn writeReg
+   * @brief Write register function
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param reg  Register address  8bits
+   * @param pBuf Store buffer for the data to be written
+   * @param size Length of the data to be written
+   */
+  void writeReg(uint8_t subUartChannel, uint8_t reg, const void* pBuf, size_t size);
+
+  /**
+   * @fn readReg
+   * @brief Read register function
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param reg  Register address 8bits
+   * @param pBuf Store buffer for the data to be read
+   * @param size Length of the data to be read
+   * @return Return the actual length, 0 means failed to read
+   */
+  uint8_t readReg(uint8_t subUartChannel, uint8_t reg, void* pBuf, size_t size);
+
+  /**
+   * @fn readFIFO
+   * @brief Read FIFO buffer, one read transaction per IIC buffer sized chunk
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param pBuf Store buffer for the data to be read
+   * @param size Length of the data to be read
+   * @return Return the actual length, 0 means failed to read
+   */
+  size_t readFIFO(uint8_t subUartChannel, void* pBuf, size_t size);
+
+  /**
+   * @fn writeFIFO
+   * @brief Write FIFO buffer, one write transaction per IIC buffer sized chunk
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param pBuf Store buffer for the data to be written
+   * @param size Length of the data to be written
+   * @return Return the number of bytes written
+   */
+  size_t writeFIFO(uint8_t subUartChannel, const uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn submit
+   * @brief Queue a transfer to a register or the FIFO of a sub UART through the transport
+   * @param subUartChannel Sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param obj Object to be operated: DFROBOT_IICSERIAL_OBJECT_REGISTER or DFROBOT_IICSERIAL_OBJECT_FIFO
+   * @param pTransfer The transfer, addr is filled in
+   * @return Return 0 if the transfer was queued, otherwise non-zero
+   */
+  int submit(uint8_t subUartChannel, uint8_t obj, DFRobot_IICSerialTransport::sTransfer_t *pTransfer);
+
+private:
+  DFRobot_IICSerialTransport *_pBus;
+  uint8_t _addrPre;
+  DFRobot_IICSerialBase *_ports[2];
+  int _irqPin;
+  volatile bool _irqPending;
+  uint8_t _page[2];
+  uint8_t _regShadow[2][DFRobot_IICSerialBase::pageTotal][DFROBOT_IICSERIAL_SHADOW_REG_NUM];
+  uint8_t _regShadowValid[2][DFRobot_IICSerialBase::pageTotal];
+  uint8_t _gena;
+  uint8_t _gier;
+  uint8_t _globalShadowValid;
+  uint32_t _fosc;
+  static DFRobot_IICSerialChip _chips[DFROBOT_IICSERIAL_CHIP_MAX];
+  static uint8_t _rrStart;
+};
+
+/**
+ * @brief Sub UART port with its own receive and transmit buffers, sized at compile time.
+ * @n Small-RAM boards can keep 16~64 bytes, 32-bit boards can take a whole 256 bytes FIFO burst or more.
+ * @tparam RX_SIZE Receive buffer size, a power of 2, 2~32768
+ * @tparam TX_SIZE Transmit buffer size, a power of 2, 2~32768
+ */
+template<uint16_t RX_SIZE, uint16_t TX_SIZE = DFROBOT_IICSERIAL_TX_BUFFER_SIZE>
+class DFRobot_IICSerialPort : public DFRobot_IICSerialBase{
+  static_assert((RX_SIZE >= 2) && ((RX_SIZE & (RX_SIZE - 1)) == 0), "RX_SIZE must be a power of 2");
+  static_assert((TX_SIZE >= 2) && ((TX_SIZE & (TX_SIZE - 1)) == 0), "TX_SIZE must be a power of 2");
+public:
+  /**
+   * @fn DFRobot_IICSerialPort
+   * @brief Constructor
+   * @param wire I2C bus pointer object, default Wire
+   * @param subUartChannel sub UART channel, WK2132 has two sub UARTs: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param IA1 corresponds with IA1 Level(0 or 1) of DIP switch on the module, and is used for configuring 
+   * @n the IIC address of the 6th bit value(default: 1).
+   * @param IA0 corresponds with IA0 Level(0 or 1) of DIP switch on the module, and is used for configuring
+   * @n IIC address of the 5th bit value(default: 1).
+   * @n IIC address configuration: 
+   * @n 7   6   5   4   3   2   1   0
+   * @n 0  IA1 IA0  1   0  C1  C0  0/1
+   * @n IIC address only has 7 bits, while there are 8 bits for one byte, so the extra one bit will be filled as 0. 
+   * @n The 6th bit corresponds with IA1 Level of DIP switch, can be configured manually.
+   * @n The 5th bit corresponds with IA0 Level of DIP switch, can be configured manually. 
+   * @n The 4th and 3rd bits are fixed, value 1 and 0 respectively.
+   * @n The values of the 2nd and 1st bits are the sub UART channels, 00 for sub UART 1, 01 for sub UART 2. 
+   * @n The 0 bit represents the operation object: 0 for register, 1 for FIFO cache.
+   */
+  DFRobot_IICSerialPort(TwoWire &wire = Wire, uint8_t subUartChannel = SUBUART_CHANNEL_1, uint8_t IA1 = 1, uint8_t IA0 = 1)
+    :DFRobot_IICSerialBase(DFRobot_IICSerialWireTransport::get(&wire), subUartChannel, IA1, IA0,
+                           _rxStorage, _rxErrorStorage, RX_SIZE, _txStorage, TX_SIZE){}
+
+  /**
+   * @fn DFRobot_IICSerialPort
+   * @brief Constructor for a module on another IIC driver than TwoWire
+   * @param bus IIC transport, see DFRobot_IICSerialTransport
+   * @param subUartChannel sub UART channel: SUBUART_CHANNEL_1 or SUBUART_CHANNEL_2
+   * @param IA1 IA1 Level(0 or 1) of DIP switch on the module
+   * @param IA0 IA0 Level(0 or 1) of DIP switch on the module
+   */
+  DFRobot_IICSerialPort(DFRobot_IICSerialTransport &bus, uint8_t subUartChannel = SUBUART_CHANNEL_1, uint8_t IA1 = 1, uint8_t IA0 = 1)
+    :DFRobot_IICSerialBase(&bus, subUartChannel, IA1, IA0, _rxStorage, _rxErrorStorage, RX_SIZE, _txStorage, TX_SIZE){}
+
+private:
+  unsigned char _rxStorage[RX_SIZE];
+  uint8_t _rxErrorStorage[(RX_SIZE + 7) / 8];
+  unsigned char _txStorage[TX_SIZE];
+};
+
+/**
+ * @brief Sub UART port with DFROBOT_IICSERIAL_RX_BUFFER_SIZE/DFROBOT_IICSERIAL_TX_BUFFER_SIZE bytes buffers
+ */
+typedef DFRobot_IICSerialPort<DFROBOT_IICSERIAL_RX_BUFFER_SIZE, DFROBOT_IICSERIAL_TX_BUFFER_SIZE> DFRobot_IICSerial;
+
+/**
+ * @brief Splits the received data of a sub UART into frames and hands every complete frame to a callback.
+ * @n The receive buffer is scanned in place through peekSpan()/consume(), a frame is only copied once into
+ * @n the frame buffer given to the constructor. Frames longer than that buffer and, with setRxErrorTracking(true),
+ * @n frames containing a byte with a line error are dropped and counted by getDropped().
+ */
+class DFRobot_IICSerialFrame{
+public:
+  /**
+   * @brief Called for every complete frame
+   * @param pPort The sub UART that received the frame
+   * @param pFrame The frame, including the delimiter or the length header, valid until the callback returns
+   * @param size Length of the frame
+   */
+  typedef void (*frameCallback_t)(DFRobot_IICSerialBase *pPort, const uint8_t *pFrame, size_t size);
+
+  /**
+   * @fn DFRobot_IICSerialFrame
+   * @brief Constructor, the default framing is a '\\n' delimiter
+   * @param port The sub UART to be framed
+   * @param pBuf Frame buffer, it limits the length of a frame
+   * @param size Size of the frame buffer
+   */
+  DFRobot_IICSerialFrame(DFRobot_IICSerialBase &port, uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn setDelimiter
+   * @brief A frame ends with the delimiter byte, the delimiter is part of the frame
+   * @param delimiter Delimiter byte
+   */
+  void setDelimiter(uint8_t delimiter);
+
+  /**
+   * @fn setLengthPrefix
+   * @brief A frame carries the length of its payload in a header byte: offset + 1 + length + extra bytes in total
+   * @param offset Position of the length byte in the frame, it must be smaller than the frame buffer
+   * @param extra Bytes following the payload that the length does not count, e.g. 2 for a CRC16
+   */
+  void setLengthPrefix(uint8_t offset, uint8_t extra = 0);
+
+  /**
+   * @fn setIdleGap
+   * @brief A frame ends when the receive line goes idle, see DFRobot_IICSerialBase::isRxIdle(). In interrupt mode
+   * @n it needs the receive FIFO timeout interrupt, which is enabled by default.
+   */
+  void setIdleGap();
+
+  /**
+   * @fn setCallback
+   * @brief Set the function called for every complete frame, it must not read from the sub UART
+   * @param cb Callback, NULL to remove it
+   */
+  void setCallback(frameCallback_t cb){_callback = cb;}
+
+  /**
+   * @fn poll
+   * @brief Take the received data of the sub UART and call the callback for every complete frame. Call it from
+   * @n loop() instead of read().
+   * @return Return the number of frames delivered
+   */
+  size_t poll();
+
+  /**
+   * @fn reset
+   * @brief Throw away the partially received frame, e.g. after a timeout of the protocol above
+   */
+  void reset();
+
+  /**
+   * @fn getDropped
+   * @brief Get the number of frames dropped because they were too long or had a line error
+   * @return Return the number of frames
+   */
+  uint32_t getDropped(){return _dropped;}
+
+protected:
+  /**
+   * @fn onFrame
+   * @brief Called for every complete frame that was not dropped, calls the callback. Protocol classes built on
+   * @n the framer override it.
+   * @param pFrame The frame
+   * @param size Length of the frame
+   */
+  virtual void onFrame(const uint8_t *pFrame, size_t size);
+
+  typedef enum{
+      eFrameDelimiter = 0, /**< A frame ends with a delimiter byte, e.g. '\\n' */
+      eFrameLength,        /**< A frame carries its length in a header byte */
+      eFrameIdle           /**< A frame ends when the receive line goes idle, e.g. Modbus RTU */
+  }eFrameMode_t;
+
+  /**
+   * @fn append
+   * @brief Append received data to the current frame, data beyond the frame buffer drops the frame
+   * @param pData Received data
+   * @param size Length of the data
+   */
+  void append(const uint8_t *pData, size_t size);
+
+  /**
+   * @fn endFrame
+   * @brief Deliver or drop the current frame and start a new one
+   * @return Return 1 if the frame was delivered, otherwise 0
+   */
+  size_t endFrame();
+
+  DFRobot_IICSerialBase *_pPort;
+  uint8_t *_pBuf;
+  size_t _size;
+  size_t _len;               //< Bytes of the current frame received so far, also counted once it is dropped
+  size_t _total;             //< Length of the current frame in length prefix mode, known after the length byte
+  uint8_t _lenByte;          //< The length byte of the current frame, also taken when the frame is dropped
+  bool _drop;
+  uint8_t _mode;
+  uint8_t _delimiter;
+  uint8_t _lenOffset;
+  uint8_t _lenExtra;
+  frameCallback_t _callback;
+  uint32_t _dropped;
+};
+
+inline bool DFRobot_IICSerialBase::interruptMode(){
+  return (_pChip != NULL) && (_pChip->_irqPin >= 0);
+}
 #endif
@@ -0,0 +1,82 @@
+/*!
+ * @file DFRobot_IICSerialLinux.cpp
+ * @brief Define the basic structure of class DFRobot_IICSerialLinuxTransport
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerialLinux.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+DFRobot_IICSerialLinuxTransport::DFRobot_IICSerialLinuxTransport(const char *device){
+  _device = device;
+  _fd = -1;
+}
+
+DFRobot_IICSerialLinuxTransport::~DFRobot_IICSerialLinuxTransport(){
+  if(_fd >= 0){
+      close(_fd);
+  }
+}
+
+void DFRobot_IICSerialLinuxTransport::begin(){
+  if(_fd < 0){
+      _fd = open(_device, O_RDWR);
+  }
+}
+
+uint8_t DFRobot_IICSerialLinuxTransport::write(uint8_t addr, const uint8_t *pBuf, size_t size){
+  struct i2c_msg msg;
+  msg.addr = addr;
+  msg.flags = 0;
+  msg.len = (uint16_t)size;
+  msg.buf = (uint8_t *)pBuf;
+  //2 as TwoWire reports an address that was not acknowledged
+  return (transfer(&msg, 1) == 1) ? 0 : 2;
+}
+
+size_t DFRobot_IICSerialLinuxTransport::read(uint8_t addr, uint8_t *pBuf, size_t size){
+  struct i2c_msg msg;
+  msg.addr = addr;
+  msg.flags = I2C_M_RD;
+  msg.len = (uint16_t)size;
+  msg.buf = pBuf;
+  return (transfer(&msg, 1) == 1) ? size : 0;
+}
+
+size_t DFRobot_IICSerialLinuxTransport::writeRead(uint8_t addr, const uint8_t *pTx, size_t txSize, uint8_t *pRx, size_t rxSize){
+  if(txSize == 0){
+      return read(addr, pRx, rxSize);
+  }
+  struct i2c_msg msgs[2];
+  msgs[0].addr = addr;
+  msgs[0].flags = 0;
+  msgs[0].len = (uint16_t)txSize;
+  msgs[0].buf = (uint8_t *)pTx;
+  msgs[1].addr = addr;
+  msgs[1].flags = I2C_M_RD;
+  msgs[1].len = (uint16_t)rxSize;
+  msgs[1].buf = pRx;
+  return (transfer(msgs, 2) == 2) ? rxSize : 0;
+}
+
+int DFRobot_IICSerialLinuxTransport::transfer(struct i2c_msg *pMsgs, uint32_t num){
+  if(_fd < 0){
+      return -1;
+  }
+  struct i2c_rdwr_ioctl_data data;
+  data.msgs = pMsgs;
+  data.nmsgs = num;
+  return ioctl(_fd, I2C_RDWR, &data);
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*!
+ * @file DFRobot_IICSerialLinux.h
+ * @brief Define the basic structure of class DFRobot_IICSerialLinuxTransport
+ * @n IIC transport of a Linux /dev/i2c-N adapter, e.g. on a Raspberry Pi with an Arduino compatible core. Every
+ * @n transaction is one I2C_RDWR ioctl, a register read writes the address and reads the value in one combined
+ * @n transfer with a repeated start, and the FIFO is moved in blocks of up to 256 bytes. Only built on Linux.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __DFRobot_IICSERIALLINUX_H
+#define __DFRobot_IICSERIALLINUX_H
+
+#include "DFRobot_IICSerial.h"
+
+#if defined(__linux__)
+#include <linux/i2c.h>
+
+/**
+ * @brief Transport of a /dev/i2c-N adapter through I2C_RDWR, pass it to DFRobot_IICSerialPort instead of TwoWire
+ */
+class DFRobot_IICSerialLinuxTransport : public DFRobot_IICSerialTransport{
+public:
+  /**
+   * @fn DFRobot_IICSerialLinuxTransport
+   * @brief Constructor, the adapter is opened by begin()
+   * @param device Path of the adapter, e.g. "/dev/i2c-1" on a Raspberry Pi
+   */
+  DFRobot_IICSerialLinuxTransport(const char *device = "/dev/i2c-1");
+  virtual ~DFRobot_IICSerialLinuxTransport();
+
+  /**
+   * @fn begin
+   * @brief Open the adapter, transactions fail if it can not be opened
+   */
+  virtual void begin();
+  virtual uint8_t write(uint8_t addr, const uint8_t *pBuf, size_t size);
+  virtual size_t read(uint8_t addr, uint8_t *pBuf, size_t size);
+
+  /**
+   * @fn writeRead
+   * @brief Write the register address and read the register in one I2C_RDWR ioctl, with a repeated start
+   */
+  virtual size_t writeRead(uint8_t addr, const uint8_t *pTx, size_t txSize, uint8_t *pRx, size_t rxSize);
+
+  /**
+   * @fn getMaxTransfer
+   * @brief The kernel takes longer messages than the 256 bytes of a FIFO
+   * @return Return 256
+   */
+  virtual size_t getMaxTransfer(){return 256;}
+
+  /**
+   * @fn isOpen
+   * @brief Whether begin() opened the adapter
+   * @return Return true if it is open
+   */
+  bool isOpen(){return _fd >= 0;}
+
+protected:
+  /**
+   * @fn transfer
+   * @brief Run the messages as one I2C_RDWR ioctl
+   * @param pMsgs The messages, I2C_M_RD in flags for a read
+   * @param num The number of messages
+   * @return Return the number of messages transferred, negative on error
+   */
+  virtual int transfer(struct i2c_msg *pMsgs, uint32_t num);
+
+private:
+  const char *_device;
+  int _fd;
+};
+
+#endif
+#endif
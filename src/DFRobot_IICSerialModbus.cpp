@@ -0,0 +1,246 @@
+/*!
+ * @file DFRobot_IICSerialModbus.cpp
+ * @brief Define the basic structure of class DFRobot_IICSerialModbus
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#include <DFRobot_IICSerialModbus.h>
+
+#define MODBUS_EXCEPTION_FLAG   0x80
+#define MODBUS_MIN_FRAME        4       //< Slave address, function code and CRC
+
+/**
+ * @brief CRC16 of every byte value, polynomial 0xA001(reflected 0x8005)
+ */
+static const uint16_t modbusCRCTable[256] PROGMEM = {
+  0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+  0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+  0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+  0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+  0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+  0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+  0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+  0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+  0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+  0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+  0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+  0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+  0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+  0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+  0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+  0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+  0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+  0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+  0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+  0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+  0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+  0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+  0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+  0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+  0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+  0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+  0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+  0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+  0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+  0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+  0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+  0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+DFRobot_IICSerialModbus::DFRobot_IICSerialModbus(DFRobot_IICSerialBase &port)
+  :DFRobot_IICSerialFrame(port, _adu, sizeof(_adu)){
+  _aduLen = 0;
+  _result = eModbusIdle;
+  _slave = 0;
+  _function = 0;
+  _exception = 0;
+  _timeoutMs = 1000;
+  _sentMs = 0;
+  _txMs = 0;
+  _droppedAtSend = 0;
+  _modbusCallback = NULL;
+  setIdleGap();
+}
+
+uint16_t DFRobot_IICSerialModbus::crc16(const void *pBuf, size_t size, uint16_t crc){
+  const uint8_t *_pBuf = (const uint8_t *)pBuf;
+  while(size--){
+      crc = (crc >> 8) ^ pgm_read_word(&modbusCRCTable[(crc ^ *_pBuf++) & 0xFF]);
+  }
+  return crc;
+}
+
+int DFRobot_IICSerialModbus::readHoldingRegisters(uint8_t slave, uint16_t addr, uint16_t count){
+  if((count == 0) || (count > 125)){
+      return -1;
+  }
+  uint8_t data[4] = {(uint8_t)(addr >> 8), (uint8_t)addr, (uint8_t)(count >> 8), (uint8_t)count};
+  return request(slave, MODBUS_READ_HOLDING_REGISTERS, data, sizeof(data));
+}
+
+int DFRobot_IICSerialModbus::readInputRegisters(uint8_t slave, uint16_t addr, uint16_t count){
+  if((count == 0) || (count > 125)){
+      return -1;
+  }
+  uint8_t data[4] = {(uint8_t)(addr >> 8), (uint8_t)addr, (uint8_t)(count >> 8), (uint8_t)count};
+  return request(slave, MODBUS_READ_INPUT_REGISTERS, data, sizeof(data));
+}
+
+int DFRobot_IICSerialModbus::writeSingleRegister(uint8_t slave, uint16_t addr, uint16_t value){
+  uint8_t data[4] = {(uint8_t)(addr >> 8), (uint8_t)addr, (uint8_t)(value >> 8), (uint8_t)value};
+  return request(slave, MODBUS_WRITE_SINGLE_REGISTER, data, sizeof(data));
+}
+
+int DFRobot_IICSerialModbus::writeMultipleRegisters(uint8_t slave, uint16_t addr, const uint16_t *pValues, uint16_t count){
+  if((pValues == NULL) || (count == 0) || (count > 123) || (9 + count * 2 > DFROBOT_IICSERIAL_MODBUS_ADU_SIZE)){
+      return -1;
+  }
+  if(_result == eModbusBusy){
+      return -1;
+  }
+  //The values are put in place in _adu, request() only adds the header and the CRC around them
+  uint8_t *pData = _adu + 2;
+  pData[0] = (uint8_t)(addr >> 8);
+  pData[1] = (uint8_t)addr;
+  pData[2] = (uint8_t)(count >> 8);
+  pData[3] = (uint8_t)count;
+  pData[4] = (uint8_t)(count * 2);
+  for(uint16_t i = 0; i < count; i++){
+      pData[5 + i * 2] = (uint8_t)(pValues[i] >> 8);
+      pData[6 + i * 2] = (uint8_t)pValues[i];
+  }
+  return request(slave, MODBUS_WRITE_MULTIPLE_REGISTERS, pData, 5 + count * 2);
+}
+
+int DFRobot_IICSerialModbus::request(uint8_t slave, uint8_t function, const void *pData, size_t size){
+  if((_result == eModbusBusy) || (size > DFROBOT_IICSERIAL_MODBUS_ADU_SIZE - MODBUS_MIN_FRAME)){
+      return -1;
+  }
+  if((pData == NULL) && size){
+      DBG("pData ERROR!! : null pointer");
+      return -1;
+  }
+  //Whatever arrived before the request cannot be the answer
+  const uint8_t *pOld = NULL;
+  size_t n = 0;
+  while((n = _pPort->peekSpan(&pOld)) != 0){
+      _pPort->consume(n);
+  }
+  reset();
+  _adu[0] = slave;
+  _adu[1] = function;
+  if(pData != _adu + 2){
+      memmove(_adu + 2, pData, size);
+  }
+  uint16_t crc = crc16(_adu, size + 2);
+  _adu[size + 2] = (uint8_t)crc;
+  _adu[size + 3] = (uint8_t)(crc >> 8);
+  _slave = slave;
+  _function = function;
+  _exception = 0;
+  _aduLen = 0;
+  _droppedAtSend = getDropped();
+  _txMs = ((size + MODBUS_MIN_FRAME) * _pPort->getCharTime()) / 1000 + 1;
+  //A transmit buffer that stays full takes only a part, no slave answers a truncated request
+  if(_pPort->write(_adu, size + MODBUS_MIN_FRAME) != size + MODBUS_MIN_FRAME){
+      DBG("write ERROR!");
+      _result = eModbusIdle;
+      return -1;
+  }
+  _result = eModbusBusy;
+  _sentMs = millis();
+  return 0;
+}
+
+DFRobot_IICSerialModbus::eModbusResult_t DFRobot_IICSerialModbus::poll(){
+  if(_result != eModbusBusy){
+      return _result;
+  }
+  if(_slave == MODBUS_BROADCAST_ADDR){
+      //No slave answers a broadcast, it is done once it has left the TX pin
+      if(_pPort->isTxComplete()){
+          finish(eModbusOK);
+      }
+      return _result;
+  }
+  DFRobot_IICSerialFrame::poll();
+  if(_result != eModbusBusy){
+      return _result;
+  }
+  if(getDropped() != _droppedAtSend){
+      finish(eModbusFrameError);
+  }else if(millis() - _sentMs > _txMs + _timeoutMs){
+      DBG("MODBUS TIMEOUT!");
+      finish(eModbusTimeout);
+  }
+  return _result;
+}
+
+void DFRobot_IICSerialModbus::onFrame(const uint8_t *pFrame, size_t size){
+  if(_result != eModbusBusy){
+      return;
+  }
+  if(size < MODBUS_MIN_FRAME){
+      finish(eModbusFrameError);
+      return;
+  }
+  if(crc16(pFrame, size) != 0){
+      finish(eModbusCRCError);
+      return;
+  }
+  if(pFrame[0] != _slave){
+      //Answer of another slave to a request of another master, keep waiting
+      return;
+  }
+  if((pFrame[1] == (_function | MODBUS_EXCEPTION_FLAG)) && (size == 5)){
+      _exception = pFrame[2];
+      finish(eModbusException);
+      return;
+  }
+  if(pFrame[1] != _function){
+      finish(eModbusFrameError);
+      return;
+  }
+  if((_function <= MODBUS_READ_INPUT_REGISTERS) && ((size < 5) || (pFrame[2] != size - 5))){
+      //The byte count of a read answer must match the frame
+      finish(eModbusFrameError);
+      return;
+  }
+  _aduLen = size;
+  finish(eModbusOK);
+}
+
+void DFRobot_IICSerialModbus::finish(eModbusResult_t result){
+  _result = result;
+  if(_modbusCallback != NULL){
+      _modbusCallback(this, result);
+  }
+}
+
+uint16_t DFRobot_IICSerialModbus::getRegister(uint8_t index){
+  if((_result != eModbusOK) || (_function < MODBUS_READ_HOLDING_REGISTERS) || (_function > MODBUS_READ_INPUT_REGISTERS)){
+      return 0;
+  }
+  if((size_t)index * 2 + 2 > _adu[2]){
+      return 0;
+  }
+  return ((uint16_t)_adu[3 + index * 2] << 8) | _adu[4 + index * 2];
+}
+
+size_t DFRobot_IICSerialModbus::getResponse(const uint8_t **ppData){
+  if(ppData == NULL){
+      DBG("ppData ERROR!! : null pointer");
+      return 0;
+  }
+  if((_result != eModbusOK) || (_aduLen < MODBUS_MIN_FRAME)){
+      *ppData = NULL;
+      return 0;
+  }
+  *ppData = _adu + 2;
+  return _aduLen - MODBUS_MIN_FRAME;
+}
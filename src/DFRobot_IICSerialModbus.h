@@ -0,0 +1,214 @@
+/*!
+ * @file DFRobot_IICSerialModbus.h
+ * @brief Define the basic structure of class DFRobot_IICSerialModbus
+ * @n Modbus RTU master on a sub UART of the IIC to UART module. Requests are non-blocking, so a master on
+ * @n every sub UART of every module can wait for its answer at the same time, see DFRobot_IICSerialChip::pollAll().
+ * @n The end of an answer is the 3.5 characters idle gap, detected through the receive FIFO timeout interrupt in
+ * @n interrupt mode. Call enableRS485() of the port for a RS-485 transceiver.
+ *
+ * @copyright   Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license     The MIT License (MIT)
+ * @author [Arya](xue.peng@dfrobot.com)
+ * @version  V1.0
+ * @date  2019-07-28
+ * @https://github.com/DFRobot/DFRobot_IICSerial
+ */
+#ifndef __DFRobot_IICSERIALMODBUS_H
+#define __DFRobot_IICSERIALMODBUS_H
+
+#include "DFRobot_IICSerial.h"
+
+#if !defined(DFROBOT_IICSERIAL_MODBUS_ADU_SIZE)
+#define DFROBOT_IICSERIAL_MODBUS_ADU_SIZE 256   //< Longest request or answer, 256 bytes for every Modbus RTU frame
+#endif
+
+/**
+ * @brief Modbus RTU master of one sub UART. The request and the answer share one DFROBOT_IICSERIAL_MODBUS_ADU_SIZE
+ * @n bytes buffer, the answer is collected by DFRobot_IICSerialFrame in idle gap mode.
+ */
+class DFRobot_IICSerialModbus : protected DFRobot_IICSerialFrame{
+public:
+  #define MODBUS_READ_COILS                0x01
+  #define MODBUS_READ_DISCRETE_INPUTS      0x02
+  #define MODBUS_READ_HOLDING_REGISTERS    0x03
+  #define MODBUS_READ_INPUT_REGISTERS      0x04
+  #define MODBUS_WRITE_SINGLE_COIL         0x05
+  #define MODBUS_WRITE_SINGLE_REGISTER     0x06
+  #define MODBUS_WRITE_MULTIPLE_REGISTERS  0x10
+  #define MODBUS_BROADCAST_ADDR            0x00    //< Every slave executes the request, none answers
+
+  typedef enum{
+      eModbusIdle = 0,   /**< No request has been sent yet, or the last one could not be sent */
+      eModbusBusy,       /**< Waiting for the answer */
+      eModbusOK,         /**< The answer is valid, read it through getRegister() or getResponse() */
+      eModbusTimeout,    /**< No answer in time */
+      eModbusCRCError,   /**< The answer has a wrong CRC */
+      eModbusFrameError, /**< The answer is too short, too long, has a line error or does not match the request */
+      eModbusException   /**< The slave answered with an exception, see getException() */
+  }eModbusResult_t;
+
+  /**
+   * @brief Called once when a request is finished
+   * @param pMaster The master that sent the request
+   * @param result Result of the request
+   */
+  typedef void (*modbusCallback_t)(DFRobot_IICSerialModbus *pMaster, eModbusResult_t result);
+
+  /**
+   * @fn DFRobot_IICSerialModbus
+   * @brief Constructor
+   * @param port The sub UART the slaves are connected to, call its begin() before the first request
+   */
+  DFRobot_IICSerialModbus(DFRobot_IICSerialBase &port);
+
+  /**
+   * @fn setTimeout
+   * @brief Set how long to wait for an answer after the request has been transmitted(default 1000ms)
+   * @param ms Timeout in milliseconds
+   */
+  void setTimeout(uint16_t ms){_timeoutMs = ms;}
+
+  /**
+   * @fn setCallback
+   * @brief Set the function called when a request is finished, it is called from poll()
+   * @param cb Callback, NULL to remove it
+   */
+  void setCallback(modbusCallback_t cb){_modbusCallback = cb;}
+
+  /**
+   * @fn readHoldingRegisters
+   * @brief Send a read holding registers(0x03) request
+   * @param slave Slave address, 1~247
+   * @param addr Address of the first register
+   * @param count The number of registers, 1~125
+   * @return Return 0 if the request was sent, -1 if a request is still waiting, the parameters are invalid or
+   * @n the sub UART did not take the whole request, see request()
+   */
+  int readHoldingRegisters(uint8_t slave, uint16_t addr, uint16_t count);
+
+  /**
+   * @fn readInputRegisters
+   * @brief Send a read input registers(0x04) request
+   * @param slave Slave address, 1~247
+   * @param addr Address of the first register
+   * @param count The number of registers, 1~125
+   * @return Return 0 if the request was sent, -1 if a request is still waiting, the parameters are invalid or
+   * @n the sub UART did not take the whole request, see request()
+   */
+  int readInputRegisters(uint8_t slave, uint16_t addr, uint16_t count);
+
+  /**
+   * @fn writeSingleRegister
+   * @brief Send a write single register(0x06) request
+   * @param slave Slave address, 1~247, or MODBUS_BROADCAST_ADDR
+   * @param addr Register address
+   * @param value Value to be written
+   * @return Return 0 if the request was sent, -1 if a request is still waiting or the sub UART did not take the
+   * @n whole request, see request()
+   */
+  int writeSingleRegister(uint8_t slave, uint16_t addr, uint16_t value);
+
+  /**
+   * @fn writeMultipleRegisters
+   * @brief Send a write multiple registers(0x10) request
+   * @param slave Slave address, 1~247, or MODBUS_BROADCAST_ADDR
+   * @param addr Address of the first register
+   * @param pValues Values to be written
+   * @param count The number of registers, 1~123
+   * @return Return 0 if the request was sent, -1 if a request is still waiting, the parameters are invalid or
+   * @n the sub UART did not take the whole request, see request()
+   */
+  int writeMultipleRegisters(uint8_t slave, uint16_t addr, const uint16_t *pValues, uint16_t count);
+
+  /**
+   * @fn request
+   * @brief Send any request, the slave address and the CRC are added
+   * @param slave Slave address, 0~247
+   * @param function Function code
+   * @param pData Data following the function code
+   * @param size Length of the data, at most DFROBOT_IICSERIAL_MODBUS_ADU_SIZE - 4
+   * @return Return 0 if the request was sent, -1 if a request is still waiting, the data is too long or the sub UART
+   * @n did not take the whole request(its transmit buffer stayed full). Nothing is waited for then and getResult()
+   * @n returns eModbusIdle.
+   */
+  int request(uint8_t slave, uint8_t function, const void *pData, size_t size);
+
+  /**
+   * @fn poll
+   * @brief Check for the answer without waiting, call it from loop() together with the poll() of the
+   * @n other masters
+   * @return Return eModbusBusy while waiting, otherwise the result of the last request
+   */
+  eModbusResult_t poll();
+
+  /**
+   * @fn getResult
+   * @brief Get the result of the last request without checking for the answer
+   * @return Return the result, all enumeration values in eModbusResult_t
+   */
+  eModbusResult_t getResult(){return _result;}
+
+  /**
+   * @fn getRegister
+   * @brief Get a register of the answer to a read holding/input registers request
+   * @param index Index of the register in the answer, from 0
+   * @return Return the register value, 0 if the answer has no such register
+   */
+  uint16_t getRegister(uint8_t index);
+
+  /**
+   * @fn getResponse
+   * @brief Get the data of the answer following the function code, without the CRC
+   * @param ppData Return the pointer to the data, valid until the next request
+   * @return Return the length of the data, 0 if there is no valid answer
+   */
+  size_t getResponse(const uint8_t **ppData);
+
+  /**
+   * @fn getException
+   * @brief Get the exception code of an eModbusException answer
+   * @return Return the exception code, e.g. 0x02 for an illegal data address
+   */
+  uint8_t getException(){return _exception;}
+
+  /**
+   * @fn crc16
+   * @brief Calculate the Modbus CRC16, one table lookup per byte. The CRC over a frame including its CRC is 0.
+   * @param pBuf Data
+   * @param size Length of the data
+   * @param crc Initial value, or the result of the previous piece
+   * @return Return the CRC, the low byte is transmitted first
+   */
+  static uint16_t crc16(const void *pBuf, size_t size, uint16_t crc = 0xFFFF);
+
+protected:
+  /**
+   * @fn onFrame
+   * @brief Check the answer: CRC, slave address, function code and length
+   * @param pFrame The frame received after the request
+   * @param size Length of the frame
+   */
+  virtual void onFrame(const uint8_t *pFrame, size_t size);
+
+  /**
+   * @fn finish
+   * @brief Finish the request and call the callback
+   * @param result Result of the request
+   */
+  void finish(eModbusResult_t result);
+
+private:
+  uint8_t _adu[DFROBOT_IICSERIAL_MODBUS_ADU_SIZE];  //< The request, then the answer
+  size_t _aduLen;            //< Length of a valid answer
+  eModbusResult_t _result;
+  uint8_t _slave;
+  uint8_t _function;
+  uint8_t _exception;
+  uint16_t _timeoutMs;
+  uint32_t _sentMs;
+  uint32_t _txMs;            //< Time the request needs on the line
+  uint32_t _droppedAtSend;   //< getDropped() when the request was sent
+  modbusCallback_t _modbusCallback;
+};
+
+#endif